@@ -14,12 +14,13 @@ void AabbSize(const glm::vec3* min_pos, const glm::vec3* max_pos,
   *size = *max_pos - *min_pos;
 }
 
-void AabbMinMaxPositions(const glm::vec3* positions, uint position_count,
-                         glm::vec3* min_pos, glm::vec3* max_pos) {
+void AabbMinMaxPositions(const glm::vec3* positions,
+                         std::size_t position_count, glm::vec3* min_pos,
+                         glm::vec3* max_pos) {
   *min_pos = glm::vec3(std::numeric_limits<glm::vec3::value_type>::max());
   *max_pos = glm::vec3(std::numeric_limits<glm::vec3::value_type>::min());
 
-  for (uint i = 0; i < position_count; ++i) {
+  for (std::size_t i = 0; i < position_count; ++i) {
     auto& p = positions[i];
     if (p.x < min_pos->x) {
       min_pos->x = p.x;
@@ -44,8 +45,9 @@ void AabbMinMaxPositions(const glm::vec3* positions, uint position_count,
   }
 }
 
-void AabbCenterAndSize(const glm::vec3* positions, uint position_count,
-                       glm::vec3* center, glm::vec3* size) {
+void AabbCenterAndSize(const glm::vec3* positions,
+                       std::size_t position_count, glm::vec3* center,
+                       glm::vec3* size) {
   glm::vec3 min_pos;
   glm::vec3 max_pos;
   AabbMinMaxPositions(positions, position_count, &min_pos, &max_pos);
@@ -1,6 +1,7 @@
 #ifndef RCOASTER_AABB_HPP
 #define RCOASTER_AABB_HPP
 
+#include <cstddef>
 #include <glm/glm.hpp>
 
 #include "types.hpp"
@@ -11,10 +12,12 @@ void AabbCenter(const glm::vec3* min_pos, const glm::vec3* max_pos,
 void AabbSize(const glm::vec3* min_pos, const glm::vec3* max_pos,
               glm::vec3* size);
 
-void AabbMinMaxPositions(const glm::vec3* positions, uint position_count,
-                         glm::vec3* min_pos, glm::vec3* max_pos);
+void AabbMinMaxPositions(const glm::vec3* positions,
+                         std::size_t position_count, glm::vec3* min_pos,
+                         glm::vec3* max_pos);
 
-void AabbCenterAndSize(const glm::vec3* positions, uint position_count,
-                       glm::vec3* center, glm::vec3* size);
+void AabbCenterAndSize(const glm::vec3* positions,
+                       std::size_t position_count, glm::vec3* center,
+                       glm::vec3* size);
 
 #endif  // RCOASTER_AABB_HPP
\ No newline at end of file
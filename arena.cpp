@@ -0,0 +1,152 @@
+#include "arena.hpp"
+
+#include <sys/mman.h>
+
+#include <cassert>
+#include <cstdio>
+#include <new>
+
+#define ARENA_PAGE_SIZE 4096
+#define ARENA_HUGE_PAGE_SIZE (2 << 20)
+
+static std::size_t AlignUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Returns null if the block cannot be mapped.
+static ArenaBlock *MapBlock(std::size_t size, int is_huge_page_backed) {
+  size = AlignUp(size, is_huge_page_backed ? ARENA_HUGE_PAGE_SIZE
+                                           : ARENA_PAGE_SIZE);
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map arena block of %zu bytes.\n", size);
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  if (is_huge_page_backed) {
+    // Fewer page faults and TLB misses while the block is first written.
+    madvise(data, size, MADV_HUGEPAGE);
+  }
+#endif
+
+  ArenaBlock *block = (ArenaBlock *)data;
+  block->prev = NULL;
+  block->size = size;
+  block->used = sizeof(ArenaBlock);
+  return block;
+}
+
+static void UnmapBlocks(Arena *arena) {
+  assert(arena);
+
+  ArenaBlock *block = arena->block;
+  while (block) {
+    ArenaBlock *prev = block->prev;
+    munmap(block, block->size);
+    block = prev;
+  }
+  arena->block = NULL;
+  arena->mapped_size = 0;
+}
+
+void InitArena(std::size_t block_size, int is_huge_page_backed, Arena *arena) {
+  assert(block_size > 0);
+  assert(arena);
+
+  arena->block = NULL;
+  arena->block_size = block_size;
+  arena->is_huge_page_backed = is_huge_page_backed;
+  arena->alloc_count = 0;
+  arena->used_size = 0;
+  arena->high_water_size = 0;
+  arena->mapped_size = 0;
+}
+
+void *ArenaAlloc(Arena *arena, std::size_t size, std::size_t alignment) {
+  assert(arena);
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  std::lock_guard<std::mutex> lock(arena->mutex);
+
+  ArenaBlock *block = arena->block;
+  std::size_t offset = 0;
+  if (block) {
+    offset = AlignUp(block->used, alignment);
+  }
+  if (!block || offset + size > block->size) {
+    // Allocations larger than a block get a block of their own.
+    std::size_t min_size = AlignUp(sizeof(ArenaBlock), alignment) + size;
+    std::size_t block_size =
+        min_size > arena->block_size ? min_size : arena->block_size;
+    ArenaBlock *new_block = MapBlock(block_size, arena->is_huge_page_backed);
+    if (!new_block) {
+      throw std::bad_alloc();
+    }
+    new_block->prev = block;
+    arena->block = new_block;
+    arena->mapped_size += new_block->size;
+
+    block = new_block;
+    offset = AlignUp(block->used, alignment);
+  }
+
+  block->used = offset + size;
+  ++arena->alloc_count;
+  arena->used_size += size;
+  if (arena->used_size > arena->high_water_size) {
+    arena->high_water_size = arena->used_size;
+  }
+  return (uchar *)block + offset;
+}
+
+void ResetArena(Arena *arena) {
+  assert(arena);
+
+  std::lock_guard<std::mutex> lock(arena->mutex);
+
+  arena->alloc_count = 0;
+  arena->used_size = 0;
+  if (!arena->block) {
+    return;
+  }
+
+  std::size_t size = sizeof(ArenaBlock) + arena->high_water_size;
+  if (!arena->block->prev && arena->block->size >= size) {
+    arena->block->used = sizeof(ArenaBlock);
+    return;
+  }
+
+  // Alignment padding may not fit, in which case a block is mapped again.
+  UnmapBlocks(arena);
+  if (size < arena->block_size) {
+    size = arena->block_size;
+  }
+  arena->block = MapBlock(size, arena->is_huge_page_backed);
+  if (arena->block) {
+    arena->mapped_size = arena->block->size;
+  }
+}
+
+void FreeArena(Arena *arena) {
+  assert(arena);
+
+  std::lock_guard<std::mutex> lock(arena->mutex);
+
+  UnmapBlocks(arena);
+  arena->alloc_count = 0;
+  arena->used_size = 0;
+}
+
+void PrintArenaStats(const char *name, const Arena *arena) {
+  assert(name);
+  assert(arena);
+
+  std::printf(
+      "%s arena: %llu allocations, %.1f MiB used, %.1f MiB high water, "
+      "%.1f MiB mapped\n",
+      name, (unsigned long long)arena->alloc_count,
+      arena->used_size / (1024.0 * 1024.0),
+      arena->high_water_size / (1024.0 * 1024.0),
+      arena->mapped_size / (1024.0 * 1024.0));
+}
\ No newline at end of file
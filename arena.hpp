@@ -0,0 +1,67 @@
+#ifndef RCOASTER_ARENA_HPP
+#define RCOASTER_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "types.hpp"
+
+#define ARENA_DEFAULT_BLOCK_SIZE (16 << 20)
+
+// Header at the start of every block of an arena.
+struct ArenaBlock {
+  ArenaBlock *prev;
+  std::size_t size;
+  std::size_t used;
+};
+
+/*
+A linear allocator. Allocations are carved in order out of blocks of memory
+mapped from the operating system, and are only freed all at once, by resetting
+or freeing the arena, rather than one by one.
+
+Allocating is thread-safe, so that the thread pool can make parts of a scene
+concurrently.
+*/
+struct Arena {
+  std::mutex mutex;
+  // The block being allocated from, which links to the blocks before it.
+  ArenaBlock *block;
+  std::size_t block_size;
+  // Backs blocks with transparent huge pages where supported.
+  int is_huge_page_backed;
+
+  // Since the arena was last reset.
+  std::uint64_t alloc_count;
+  std::size_t used_size;
+  // Largest `used_size` since the arena was initialized.
+  std::size_t high_water_size;
+  // Of the blocks currently mapped.
+  std::size_t mapped_size;
+};
+
+// Blocks are mapped on first allocation.
+void InitArena(std::size_t block_size, int is_huge_page_backed, Arena *arena);
+
+// Throws `std::bad_alloc` if a block cannot be mapped.
+void *ArenaAlloc(Arena *arena, std::size_t size, std::size_t alignment);
+
+template <typename T>
+T *ArenaAllocArray(Arena *arena, std::size_t count) {
+  return (T *)ArenaAlloc(arena, count * sizeof(T), alignof(T));
+}
+
+/*
+Frees every allocation at once. The blocks are replaced by a single block large
+enough for the high-water mark, so that making the same allocations again does
+not map more blocks.
+*/
+void ResetArena(Arena *arena);
+
+// Unmaps every block.
+void FreeArena(Arena *arena);
+
+void PrintArenaStats(const char *name, const Arena *arena);
+
+#endif  // RCOASTER_ARENA_HPP
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "bc.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static constexpr uint kChannelCount = 4;
+static constexpr uint kBlockPixelCount = BC_BLOCK_W * BC_BLOCK_H;
+
+// Palette index of each step from the second endpoint to the first one.
+static constexpr uint kColorIndexOfStep[4] = {1, 3, 2, 0};
+
+// Calculates the minimum and maximum of every channel over the block.
+static void BlockBounds(const uchar *block, uchar *min, uchar *max) {
+#if defined(__SSE2__)
+  __m128i p0 = _mm_loadu_si128((const __m128i *)block);
+  __m128i p1 = _mm_loadu_si128((const __m128i *)(block + 16));
+  __m128i p2 = _mm_loadu_si128((const __m128i *)(block + 32));
+  __m128i p3 = _mm_loadu_si128((const __m128i *)(block + 48));
+
+  __m128i lo = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+  __m128i hi = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+  // Reduces the 4 pixels of each register to 1.
+  lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+  lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+  hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+  hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+
+  int lo_px = _mm_cvtsi128_si32(lo);
+  int hi_px = _mm_cvtsi128_si32(hi);
+  std::memcpy(min, &lo_px, kChannelCount);
+  std::memcpy(max, &hi_px, kChannelCount);
+#elif defined(__ARM_NEON)
+  uint8x16_t p0 = vld1q_u8(block);
+  uint8x16_t p1 = vld1q_u8(block + 16);
+  uint8x16_t p2 = vld1q_u8(block + 32);
+  uint8x16_t p3 = vld1q_u8(block + 48);
+
+  uint8x16_t lo = vminq_u8(vminq_u8(p0, p1), vminq_u8(p2, p3));
+  uint8x16_t hi = vmaxq_u8(vmaxq_u8(p0, p1), vmaxq_u8(p2, p3));
+  uint8x8_t lo2 = vmin_u8(vget_low_u8(lo), vget_high_u8(lo));
+  uint8x8_t hi2 = vmax_u8(vget_low_u8(hi), vget_high_u8(hi));
+  lo2 = vmin_u8(lo2, vreinterpret_u8_u32(vrev64_u32(vreinterpret_u32_u8(lo2))));
+  hi2 = vmax_u8(hi2, vreinterpret_u8_u32(vrev64_u32(vreinterpret_u32_u8(hi2))));
+
+  std::uint32_t lo_px = vget_lane_u32(vreinterpret_u32_u8(lo2), 0);
+  std::uint32_t hi_px = vget_lane_u32(vreinterpret_u32_u8(hi2), 0);
+  std::memcpy(min, &lo_px, kChannelCount);
+  std::memcpy(max, &hi_px, kChannelCount);
+#else
+  std::memcpy(min, block, kChannelCount);
+  std::memcpy(max, block, kChannelCount);
+  for (uint i = 1; i < kBlockPixelCount; ++i) {
+    for (uint c = 0; c < kChannelCount; ++c) {
+      min[c] = std::min(min[c], block[i * kChannelCount + c]);
+      max[c] = std::max(max[c], block[i * kChannelCount + c]);
+    }
+  }
+#endif
+}
+
+static inline uint To565(const int *c) {
+  return (c[0] * 31 + 127) / 255 << 11 | (c[1] * 63 + 127) / 255 << 5 |
+         (c[2] * 31 + 127) / 255;
+}
+
+static inline void From565(uint v, int *c) {
+  int r = v >> 11 & 31;
+  int g = v >> 5 & 63;
+  int b = v & 31;
+  c[0] = r << 3 | r >> 2;
+  c[1] = g << 2 | g >> 4;
+  c[2] = b << 3 | b >> 2;
+}
+
+/*
+Chooses the endpoints of the colors of a block.
+
+The bounding box is inset by 1/16 of its extent on each side, since the
+palette never reaches outliers anyway. Its corners are swapped along green and
+blue if they are anti-correlated with red, so that the line between the
+endpoints follows the colors.
+*/
+static void ChooseColorEndpoints(const uchar *block, int *e0, int *e1) {
+  uchar min[kChannelCount];
+  uchar max[kChannelCount];
+  BlockBounds(block, min, max);
+
+  int center[3];
+  for (uint c = 0; c < 3; ++c) {
+    center[c] = (min[c] + max[c] + 1) / 2;
+  }
+  int cov_rg = 0;
+  int cov_rb = 0;
+  int cov_gb = 0;
+  for (uint i = 0; i < kBlockPixelCount; ++i) {
+    const uchar *p = block + i * kChannelCount;
+    int r = p[0] - center[0];
+    int g = p[1] - center[1];
+    int b = p[2] - center[2];
+    cov_rg += r * g;
+    cov_rb += r * b;
+    cov_gb += g * b;
+  }
+
+  for (uint c = 0; c < 3; ++c) {
+    e0[c] = max[c];
+    e1[c] = min[c];
+  }
+  if (cov_rg < 0) {
+    std::swap(e0[1], e1[1]);
+  }
+  // Without red to pivot on, blue follows green.
+  if (min[0] == max[0] ? (cov_gb < 0) != (cov_rg < 0) : cov_rb < 0) {
+    std::swap(e0[2], e1[2]);
+  }
+
+  for (uint c = 0; c < 3; ++c) {
+    int inset = (e0[c] - e1[c]) / 16;
+    e0[c] -= inset;
+    e1[c] += inset;
+  }
+}
+
+static void EncodeColorBlock(const uchar *block, uchar *out) {
+  int e0[3];
+  int e1[3];
+  ChooseColorEndpoints(block, e0, e1);
+
+  uint c0 = To565(e0);
+  uint c1 = To565(e1);
+  // The four color mode of BC1 requires `c0 > c1`.
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  From565(c0, e0);
+  From565(c1, e1);
+
+  std::uint32_t indices = 0;
+  if (c0 != c1) {
+    int d[3] = {e0[0] - e1[0], e0[1] - e1[1], e0[2] - e1[2]};
+    int dd = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+    for (uint i = 0; i < kBlockPixelCount; ++i) {
+      const uchar *p = block + i * kChannelCount;
+      int t = (p[0] - e1[0]) * d[0] + (p[1] - e1[1]) * d[1] +
+              (p[2] - e1[2]) * d[2];
+      // Rounds `3 * t / dd` to the nearest of the 4 steps.
+      int step = t <= 0 ? 0 : std::min((6 * t + dd) / (2 * dd), 3);
+      indices |= kColorIndexOfStep[step] << (2 * i);
+    }
+  }
+
+  out[0] = c0;
+  out[1] = c0 >> 8;
+  out[2] = c1;
+  out[3] = c1 >> 8;
+  out[4] = indices;
+  out[5] = indices >> 8;
+  out[6] = indices >> 16;
+  out[7] = indices >> 24;
+}
+
+static void EncodeAlphaBlock(const uchar *block, uchar *out) {
+  int a0 = block[3];
+  int a1 = block[3];
+  for (uint i = 1; i < kBlockPixelCount; ++i) {
+    a0 = std::max<int>(a0, block[i * kChannelCount + 3]);
+    a1 = std::min<int>(a1, block[i * kChannelCount + 3]);
+  }
+
+  std::uint64_t indices = 0;
+  if (a0 != a1) {
+    int d = a0 - a1;
+    for (uint i = 0; i < kBlockPixelCount; ++i) {
+      int t = block[i * kChannelCount + 3] - a1;
+      // Rounds `7 * t / d` to the nearest of the 8 steps. Step 7 is `a0`,
+      // step 0 is `a1`, and step `k` in between is palette index `8 - k`.
+      int step = (14 * t + d) / (2 * d);
+      uint index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+      indices |= (std::uint64_t)index << (3 * i);
+    }
+  }
+
+  out[0] = a0;
+  out[1] = a1;
+  for (uint i = 0; i < 6; ++i) {
+    out[2 + i] = indices >> (8 * i);
+  }
+}
+
+void EncodeBc1Block(const uchar *block, uchar *out) {
+  assert(block);
+  assert(out);
+  EncodeColorBlock(block, out);
+}
+
+void EncodeBc3Block(const uchar *block, uchar *out) {
+  assert(block);
+  assert(out);
+  EncodeAlphaBlock(block, out);
+  EncodeColorBlock(block, out + 8);
+}
+
+std::size_t BcImageSize(uint w, uint h, int is_bc3) {
+  std::size_t block_count = (std::size_t)((w + BC_BLOCK_W - 1) / BC_BLOCK_W) *
+                            ((h + BC_BLOCK_H - 1) / BC_BLOCK_H);
+  return block_count * (is_bc3 ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE);
+}
+
+void EncodeBcRows(const uchar *rgba, uint w, uint h, int is_bc3,
+                  uint block_row_begin, uint block_row_end, uchar *out) {
+  assert(rgba);
+  assert(out);
+
+  uint block_w = (w + BC_BLOCK_W - 1) / BC_BLOCK_W;
+  std::size_t block_size = is_bc3 ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE;
+  std::size_t stride = (std::size_t)w * kChannelCount;
+
+  uchar block[kBlockPixelCount * kChannelCount];
+
+  for (uint by = block_row_begin; by < block_row_end; ++by) {
+    uchar *dst = out + (std::size_t)by * block_w * block_size;
+
+    for (uint bx = 0; bx < block_w; ++bx) {
+      uint x = bx * BC_BLOCK_W;
+      uint y = by * BC_BLOCK_H;
+
+      if (x + BC_BLOCK_W <= w && y + BC_BLOCK_H <= h) {
+        for (uint j = 0; j < BC_BLOCK_H; ++j) {
+          std::memcpy(block + j * BC_BLOCK_W * kChannelCount,
+                      rgba + (y + j) * stride + x * kChannelCount,
+                      BC_BLOCK_W * kChannelCount);
+        }
+      } else {
+        for (uint j = 0; j < BC_BLOCK_H; ++j) {
+          uint sy = std::min(y + j, h - 1);
+          for (uint i = 0; i < BC_BLOCK_W; ++i) {
+            uint sx = std::min(x + i, w - 1);
+            std::memcpy(block + (j * BC_BLOCK_W + i) * kChannelCount,
+                        rgba + sy * stride + sx * kChannelCount,
+                        kChannelCount);
+          }
+        }
+      }
+
+      if (is_bc3) {
+        EncodeBc3Block(block, dst);
+      } else {
+        EncodeBc1Block(block, dst);
+      }
+      dst += block_size;
+    }
+  }
+}
\ No newline at end of file
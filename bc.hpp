@@ -0,0 +1,47 @@
+#ifndef RCOASTER_BC_HPP
+#define RCOASTER_BC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+#define BC_BLOCK_W 4
+#define BC_BLOCK_H 4
+// Bytes per 4 x 4 block.
+#define BC1_BLOCK_SIZE 8
+#define BC3_BLOCK_SIZE 16
+
+/*
+Encoders of the BC1 (DXT1) and BC3 (DXT5) block compression formats, which
+store 4 x 4 pixel blocks in 8 and 16 bytes.
+
+Endpoints are found in a single pass: the corners of the inset bounding box of
+the block's colors, along the diagonal that matches the sign of their
+covariance. Every pixel then takes the nearest palette entry along the line
+between them.
+*/
+
+// Encodes one block of 16 RGBA pixels, row by row.
+void EncodeBc1Block(const uchar *block, uchar *out);
+
+void EncodeBc3Block(const uchar *block, uchar *out);
+
+/*
+Encodes the blocks of rows `[block_row_begin, block_row_end)` of an image.
+Blocks that extend past the right or bottom edge repeat the last column or row.
+
+Input Parameters:
+- rgba: tightly packed image with its top row first
+- is_bc3: encode BC3 instead of BC1
+
+Output Parameters:
+- out: all blocks of the image, row by row
+*/
+void EncodeBcRows(const uchar *rgba, uint w, uint h, int is_bc3,
+                  uint block_row_begin, uint block_row_end, uchar *out);
+
+// Returns the number of bytes of an image of `w` x `h` pixels.
+std::size_t BcImageSize(uint w, uint h, int is_bc3);
+
+#endif  // RCOASTER_BC_HPP
\ No newline at end of file
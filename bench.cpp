@@ -0,0 +1,738 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <new>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "aabb.hpp"
+#include "cli.hpp"
+#include "meshes.hpp"
+#include "qoi.hpp"
+#include "stb_image_write.h"
+#include "types.hpp"
+
+/*
+Microbenchmarks of the mesh pipeline over synthetic tracks, and of the
+screenshot codecs over synthetic frames.
+
+Every benchmark runs at least `repetition_count` times and until it has run for
+`kMinBenchmarkNsec`, and the fastest run is reported. Allocations are counted
+by replacing the global allocation functions, and outputs are allocated from an
+arena of each run, whose allocations are counted along with them.
+*/
+
+static constexpr std::int64_t kMinBenchmarkNsec = 100000000;
+static constexpr uint kMaxRunCount = 1000;
+
+// Distance between neighboring control points of the synthetic tracks. It is
+// shorter than the default maximum spline segment length, so every spline
+// segment is evaluated as a single line segment. Line segments do not share
+// their end vertices, so the camera path has about 2 vertices per control
+// point.
+static constexpr float kControlPointSpacing = 0.4f;
+
+// Camera path vertices per batch of the stress test, whose rails have 2^22
+// vertices, the default batch limit of `rcoaster`.
+static constexpr std::size_t kStressBatchSize = (1 << 18) - 1;
+static constexpr std::uint64_t kStressBatchVertexLimit = 1 << 22;
+
+/*************************
+ * Allocation counting
+ *************************/
+
+struct AllocStats {
+  std::atomic<std::uint64_t> count;
+  std::atomic<std::uint64_t> bytes;
+  std::atomic<std::uint64_t> live_bytes;
+  std::atomic<std::uint64_t> peak_live_bytes;
+};
+
+static AllocStats alloc_stats;
+
+// Keeps the allocation size in front of the block, so that frees can be
+// counted too.
+static constexpr std::size_t kAllocHeaderSize = alignof(std::max_align_t);
+
+static void *CountedAlloc(std::size_t size) {
+  void *block = std::malloc(size + kAllocHeaderSize);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *(std::size_t *)block = size;
+
+  ++alloc_stats.count;
+  alloc_stats.bytes += size;
+  std::uint64_t live = alloc_stats.live_bytes += size;
+  std::uint64_t peak = alloc_stats.peak_live_bytes;
+  while (live > peak &&
+         !alloc_stats.peak_live_bytes.compare_exchange_weak(peak, live)) {
+  }
+
+  return (uchar *)block + kAllocHeaderSize;
+}
+
+static void CountedFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  void *block = (uchar *)ptr - kAllocHeaderSize;
+  alloc_stats.live_bytes -= *(std::size_t *)block;
+  std::free(block);
+}
+
+void *operator new(std::size_t size) { return CountedAlloc(size); }
+void *operator new[](std::size_t size) { return CountedAlloc(size); }
+void operator delete(void *ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void *ptr) noexcept { CountedFree(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { CountedFree(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { CountedFree(ptr); }
+
+// Returns the bytes live at the time of the reset.
+static std::uint64_t ResetAllocStats() {
+  alloc_stats.count = 0;
+  alloc_stats.bytes = 0;
+  std::uint64_t live = alloc_stats.live_bytes;
+  alloc_stats.peak_live_bytes = live;
+  return live;
+}
+
+/*************************
+ * Benchmarks
+ *************************/
+
+enum Benchmark {
+  kBenchmark_EvalCatmullRomSpline,
+  kBenchmark_CalcCameraOrientation,
+  kBenchmark_MakeCameraPath,
+  kBenchmark_MakeRails,
+  kBenchmark_MakeCrossties,
+  kBenchmark_AabbMinMaxPositions,
+  kBenchmark__Count
+};
+
+const char *const kBenchmarkStrings[kBenchmark__Count] = {
+    "EvalCatmullRomSpline", "CalcCameraOrientation", "MakeCameraPath",
+    "MakeRails",            "MakeCrossties",         "AabbMinMaxPositions"};
+
+struct BenchConfig {
+  uint min_exponent;
+  uint max_exponent;
+  uint repetition_count;
+  float max_spline_segment_len;
+  int is_codec_benchmarked;
+  int is_csv;
+  // Runs the stress test instead of the benchmarks if nonzero.
+  uint stress_path_vertex_count;
+};
+
+struct Result {
+  uint control_point_count;
+  std::uint64_t vertex_count;
+  std::int64_t nsec;
+  std::uint64_t alloc_count;
+  std::uint64_t alloc_bytes;
+  // Peak of the bytes allocated during the run that were live at once.
+  std::uint64_t peak_alloc_bytes;
+};
+
+static std::int64_t NowNsec() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+// A helix that winds around a vertical axis and slowly bobs up and down.
+static void MakeSyntheticTrack(uint control_point_count,
+                               std::vector<glm::vec3> *control_points) {
+  assert(control_points);
+
+  static constexpr float kRadius = 100;
+  static constexpr float kBobAmplitude = 5;
+  static constexpr float kPitch = 0.05f;
+
+  control_points->resize(control_point_count);
+
+  float angle_step = kControlPointSpacing / kRadius;
+  for (uint i = 0; i < control_point_count; ++i) {
+    float a = i * angle_step;
+    (*control_points)[i] = {kRadius * std::cos(a),
+                            kBobAmplitude * std::sin(a * 3) + kPitch * i,
+                            kRadius * std::sin(a)};
+  }
+}
+
+/*
+Runs one iteration of a benchmark.
+
+Only the call to the benchmarked function is timed. Its inputs are prepared
+beforehand from `camera_path`, and its outputs are freed afterwards.
+*/
+static void RunOnce(Benchmark b, const BenchConfig *cfg,
+                    const std::vector<glm::vec3> *control_points,
+                    const VertexList1P1T1N1B *camera_path, Result *result) {
+  assert(cfg);
+  assert(control_points);
+  assert(camera_path);
+  assert(result);
+
+  static const glm::vec4 kRailColor = {0.5, 0.5, 0.5, 1};
+
+  std::int64_t start;
+  std::int64_t end;
+
+  Arena arena;
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, 0, &arena);
+
+  std::uint64_t live_bytes = ResetAllocStats();
+
+  switch (b) {
+    case kBenchmark_EvalCatmullRomSpline: {
+      glm::vec3 *positions;
+      glm::vec3 *tangents;
+      std::size_t count;
+      start = NowNsec();
+      EvalCatmullRomSpline(control_points->data(), control_points->size(),
+                           cfg->max_spline_segment_len, &arena, &positions,
+                           &tangents, &count);
+      end = NowNsec();
+      result->vertex_count = count;
+      break;
+    }
+    case kBenchmark_CalcCameraOrientation: {
+      std::size_t count = camera_path->count;
+      std::vector<glm::vec3> normals(count);
+      std::vector<glm::vec3> binormals(count);
+      live_bytes = ResetAllocStats();
+      start = NowNsec();
+      CalcCameraOrientation(camera_path->tangents, count, normals.data(),
+                            binormals.data());
+      end = NowNsec();
+      result->vertex_count = count;
+      break;
+    }
+    case kBenchmark_MakeCameraPath: {
+      VertexList1P1T1N1B vertices;
+      start = NowNsec();
+      MakeCameraPath(control_points->data(), control_points->size(),
+                     cfg->max_spline_segment_len, &arena, &vertices);
+      end = NowNsec();
+      result->vertex_count = vertices.count;
+      break;
+    }
+    case kBenchmark_MakeRails: {
+      Mesh left;
+      Mesh right;
+      start = NowNsec();
+      MakeRails(camera_path, &kRailColor, 0.2, 0.1, 0.1, 0.1, 2, -2, &arena,
+                &left, &right);
+      end = NowNsec();
+      result->vertex_count = left.vl1p1c.count + right.vl1p1c.count;
+      break;
+    }
+    case kBenchmark_MakeCrossties: {
+      VertexList1P1UV vertices;
+      start = NowNsec();
+      MakeCrossties(camera_path, 1, -2, &arena, &arena, &vertices);
+      end = NowNsec();
+      result->vertex_count = vertices.count;
+      break;
+    }
+    case kBenchmark_AabbMinMaxPositions: {
+      glm::vec3 min_pos;
+      glm::vec3 max_pos;
+      start = NowNsec();
+      AabbMinMaxPositions(camera_path->positions, camera_path->count, &min_pos,
+                          &max_pos);
+      end = NowNsec();
+      result->vertex_count = camera_path->count;
+      // Keeps the result observable so the call is not optimized away.
+      volatile float sink = min_pos.x + max_pos.x;
+      (void)sink;
+      break;
+    }
+    default: {
+      assert(false);
+      return;
+    }
+  }
+
+  result->nsec = end - start;
+  result->alloc_count = alloc_stats.count + arena.alloc_count;
+  result->alloc_bytes = alloc_stats.bytes + arena.used_size;
+  // Arena allocations are only freed with the arena, so they add to the peak.
+  result->peak_alloc_bytes =
+      alloc_stats.peak_live_bytes - live_bytes + arena.high_water_size;
+
+  FreeArena(&arena);
+}
+
+static void Run(Benchmark b, const BenchConfig *cfg,
+                const std::vector<glm::vec3> *control_points,
+                const VertexList1P1T1N1B *camera_path, Result *result) {
+  assert(cfg);
+  assert(result);
+
+  std::int64_t total_nsec = 0;
+  for (uint i = 0; i < kMaxRunCount; ++i) {
+    if (i >= cfg->repetition_count && total_nsec >= kMinBenchmarkNsec) {
+      break;
+    }
+
+    Result r = {};
+    r.control_point_count = control_points->size();
+    RunOnce(b, cfg, control_points, camera_path, &r);
+    total_nsec += r.nsec;
+
+    if (i == 0 || r.nsec < result->nsec) {
+      *result = r;
+    }
+  }
+}
+
+static void PrintResults(Benchmark b, const std::vector<Result> *results,
+                         int is_csv) {
+  assert(b < kBenchmark__Count);
+  assert(results);
+
+  if (!is_csv) {
+    std::printf("\n%s\n", kBenchmarkStrings[b]);
+    std::printf("%14s %14s %12s %10s %8s %14s %14s %8s\n", "control_points",
+                "vertices", "time_ms", "ns/vertex", "allocs", "alloc_bytes",
+                "peak_bytes", "scaling");
+  }
+
+  for (std::size_t i = 0; i < results->size(); ++i) {
+    const Result &r = (*results)[i];
+
+    double ns_per_vertex = 0;
+    if (r.vertex_count) {
+      ns_per_vertex = (double)r.nsec / r.vertex_count;
+    }
+
+    // Exponent k of the fitted curve time ~ control_points^k between this
+    // size and the previous one. 1 is linear scaling.
+    double scaling = 0;
+    if (i > 0) {
+      const Result &p = (*results)[i - 1];
+      scaling = std::log((double)r.nsec / p.nsec) /
+                std::log((double)r.control_point_count / p.control_point_count);
+    }
+
+    if (is_csv) {
+      std::printf("%s,%u,%llu,%.6f,%.3f,%llu,%llu,%llu,%.3f\n",
+                  kBenchmarkStrings[b], r.control_point_count,
+                  (unsigned long long)r.vertex_count, r.nsec / 1e6,
+                  ns_per_vertex, (unsigned long long)r.alloc_count,
+                  (unsigned long long)r.alloc_bytes,
+                  (unsigned long long)r.peak_alloc_bytes, scaling);
+    } else if (i > 0) {
+      std::printf("%14u %14llu %12.3f %10.3f %8llu %14llu %14llu %8.2f\n",
+                  r.control_point_count, (unsigned long long)r.vertex_count,
+                  r.nsec / 1e6, ns_per_vertex,
+                  (unsigned long long)r.alloc_count,
+                  (unsigned long long)r.alloc_bytes,
+                  (unsigned long long)r.peak_alloc_bytes, scaling);
+    } else {
+      std::printf("%14u %14llu %12.3f %10.3f %8llu %14llu %14llu %8s\n",
+                  r.control_point_count, (unsigned long long)r.vertex_count,
+                  r.nsec / 1e6, ns_per_vertex,
+                  (unsigned long long)r.alloc_count,
+                  (unsigned long long)r.alloc_bytes,
+                  (unsigned long long)r.peak_alloc_bytes, "-");
+    }
+  }
+}
+
+/*************************
+ * Codec benchmarks
+ *************************/
+
+enum Codec { kCodec_Jpg, kCodec_Qoi, kCodec__Count };
+
+const char *const kCodecStrings[kCodec__Count] = {"jpg_q95", "qoi"};
+
+struct Resolution {
+  uint w;
+  uint h;
+};
+
+const Resolution kCodecResolutions[] = {{1280, 720}, {3840, 2160}};
+
+struct CodecResult {
+  std::int64_t nsec;
+  std::uint64_t size;
+};
+
+/*
+Makes an RGBA frame that resembles a rendered one: a smooth sky gradient above
+noisy ground, crossed by the flat colored bars of a track.
+*/
+static void MakeSyntheticFrame(uint w, uint h, std::vector<uchar> *pixels) {
+  assert(pixels);
+
+  pixels->resize((std::size_t)w * h * 4);
+
+  std::uint32_t seed = 1;
+  for (uint y = 0; y < h; ++y) {
+    for (uint x = 0; x < w; ++x) {
+      uchar *p = pixels->data() + ((std::size_t)y * w + x) * 4;
+
+      // Linear congruential generator.
+      seed = seed * 1664525 + 1013904223;
+      int noise = (int)(seed >> 28) - 8;
+
+      if (y < h / 2) {
+        float t = (float)y / (h / 2);
+        p[0] = 60 + 120 * t;
+        p[1] = 130 + 90 * t;
+        p[2] = 230;
+      } else if ((x + y) % (w / 16) < w / 64 && x > w / 3 && x < 2 * w / 3) {
+        p[0] = 120;
+        p[1] = 80;
+        p[2] = 40;
+      } else {
+        p[0] = 70 + noise;
+        p[1] = 120 + 2 * noise;
+        p[2] = 40 + noise;
+      }
+      p[3] = 255;
+    }
+  }
+}
+
+static void CountJpgBytes(void *context, void *, int size) {
+  *(std::uint64_t *)context += size;
+}
+
+static Status CountQoiBytes(const void *, std::size_t size, void *context) {
+  *(std::uint64_t *)context += size;
+  return kStatus_Ok;
+}
+
+// Encodes the frame in memory, so that file I/O is not timed.
+static void RunCodecOnce(Codec c, const uchar *pixels, uint w, uint h,
+                         CodecResult *result) {
+  assert(pixels);
+  assert(result);
+
+  std::uint64_t size = 0;
+  std::int64_t start = NowNsec();
+
+  switch (c) {
+    case kCodec_Jpg: {
+      stbi_write_jpg_to_func(CountJpgBytes, &size, w, h, 4, pixels, 95);
+      break;
+    }
+    case kCodec_Qoi: {
+      QoiEncoder *enc = new QoiEncoder;
+      BeginQoi(w, h, 3, CountQoiBytes, &size, enc);
+      EncodeQoiRows(pixels, (std::ptrdiff_t)w * 4, h, enc);
+      EndQoi(enc);
+      delete enc;
+      break;
+    }
+    default: {
+      assert(false);
+    }
+  }
+
+  result->nsec = NowNsec() - start;
+  result->size = size;
+}
+
+static void RunCodecs(const BenchConfig *cfg) {
+  assert(cfg);
+
+  if (cfg->is_csv) {
+    std::printf("\ncodec,w,h,time_ms,megapixels_per_sec,size_bytes,ratio\n");
+  } else {
+    std::printf("\nScreenshot codecs\n");
+    std::printf("%10s %12s %12s %14s %14s %8s\n", "codec", "resolution",
+                "time_ms", "megapixels/s", "size_bytes", "ratio");
+  }
+
+  for (const Resolution &res : kCodecResolutions) {
+    std::vector<uchar> pixels;
+    MakeSyntheticFrame(res.w, res.h, &pixels);
+
+    for (int c = 0; c < kCodec__Count; ++c) {
+      CodecResult best = {};
+      std::int64_t total_nsec = 0;
+      for (uint i = 0; i < kMaxRunCount; ++i) {
+        if (i >= cfg->repetition_count && total_nsec >= kMinBenchmarkNsec) {
+          break;
+        }
+
+        CodecResult r;
+        RunCodecOnce((Codec)c, pixels.data(), res.w, res.h, &r);
+        total_nsec += r.nsec;
+        if (i == 0 || r.nsec < best.nsec) {
+          best = r;
+        }
+      }
+
+      double pixel_count = (double)res.w * res.h;
+      double megapixels_per_sec = pixel_count / best.nsec * 1e3;
+      // Compared to the raw RGB frame.
+      double ratio = best.size / (pixel_count * 3);
+
+      if (cfg->is_csv) {
+        std::printf("%s,%u,%u,%.6f,%.3f,%llu,%.4f\n", kCodecStrings[c], res.w,
+                    res.h, best.nsec / 1e6, megapixels_per_sec,
+                    (unsigned long long)best.size, ratio);
+      } else {
+        char resolution[32];
+        std::snprintf(resolution, sizeof(resolution), "%ux%u", res.w, res.h);
+        std::printf("%10s %12s %12.3f %14.1f %14llu %8.4f\n", kCodecStrings[c],
+                    resolution, best.nsec / 1e6, megapixels_per_sec,
+                    (unsigned long long)best.size, ratio);
+      }
+    }
+  }
+}
+
+/*************************
+ * Stress test
+ *************************/
+
+/*
+Makes the rails and crossties of a synthetic track of about
+`stress_path_vertex_count` camera path vertices in batches, as `rcoaster` makes
+a track too large to draw in one batch, and prints the totals, which may exceed
+32 bits. Each batch is made in a scratch arena that is reset for the next one,
+so memory use is bounded by the camera path and one batch.
+
+Fails if the totals are not those of the rail cross sections, or if a batch
+exceeds the batch limit or has an index that does not fit in 32 bits.
+*/
+static Status RunStress(const BenchConfig *cfg) {
+  assert(cfg);
+
+  static const glm::vec4 kRailColor = {0.5, 0.5, 0.5, 1};
+
+  std::int64_t start = NowNsec();
+
+  Arena path_arena;
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, 0, &path_arena);
+  VertexList1P1T1N1B camera_path;
+  {
+    std::vector<glm::vec3> control_points;
+    // Each segment of the synthetic track is evaluated into 2 vertices.
+    MakeSyntheticTrack(cfg->stress_path_vertex_count / 2 + 3, &control_points);
+    MakeCameraPath(control_points.data(), control_points.size(),
+                   cfg->max_spline_segment_len, &path_arena, &camera_path);
+  }
+
+  std::int64_t path_end = NowNsec();
+
+  Arena scratch_arena;
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, 0, &scratch_arena);
+  std::uint64_t batch_count = 0;
+  std::uint64_t rail_vertex_count = 0;
+  std::uint64_t rail_index_count = 0;
+  std::uint64_t crosstie_vertex_count = 0;
+  std::uint64_t vertex_bytes = 0;
+  // Over all batches, as if the rails of each shared their buffers, left rail
+  // first, as in `rcoaster`.
+  std::uint64_t max_batch_index = 0;
+  std::uint64_t max_batch_rail_vertex_count = 0;
+  // Neighboring batches share a camera path vertex.
+  for (std::size_t begin = 0; begin + 1 < camera_path.count;
+       begin += kStressBatchSize) {
+    std::size_t end = std::min(begin + kStressBatchSize + 1, camera_path.count);
+    VertexList1P1T1N1B batch = SliceCameraPath(&camera_path, begin, end);
+
+    Mesh left;
+    Mesh right;
+    MakeRails(&batch, &kRailColor, 0.2, 0.1, 0.1, 0.1, 2, -2, &scratch_arena,
+              &left, &right);
+    VertexList1P1UV crossties;
+    MakeCrossties(&batch, 1, -2, &scratch_arena, &scratch_arena, &crossties);
+
+    std::uint64_t batch_rail_vertex_count =
+        left.vl1p1c.count + right.vl1p1c.count;
+    for (std::size_t i = 0; i < left.index_count; ++i) {
+      max_batch_index = std::max<std::uint64_t>(max_batch_index,
+                                                left.indices[i]);
+    }
+    for (std::size_t i = 0; i < right.index_count; ++i) {
+      max_batch_index = std::max<std::uint64_t>(
+          max_batch_index, left.vl1p1c.count + right.indices[i]);
+    }
+    max_batch_rail_vertex_count =
+        std::max(max_batch_rail_vertex_count, batch_rail_vertex_count);
+
+    ++batch_count;
+    rail_vertex_count += batch_rail_vertex_count;
+    rail_index_count += left.index_count + right.index_count;
+    crosstie_vertex_count += crossties.count;
+    vertex_bytes += (left.vl1p1c.count + right.vl1p1c.count) *
+                        (sizeof(glm::vec3) + sizeof(glm::vec4)) +
+                    (left.index_count + right.index_count) * sizeof(uint) +
+                    crossties.count * (sizeof(glm::vec3) + sizeof(glm::vec2));
+    ResetArena(&scratch_arena);
+  }
+
+  std::int64_t end = NowNsec();
+
+  std::uint64_t vertex_count = rail_vertex_count + crosstie_vertex_count;
+  std::printf("Camera path vertices:  %llu (%.3f msec)\n",
+              (unsigned long long)camera_path.count, (path_end - start) / 1e6);
+  std::printf("Batches:               %llu\n", (unsigned long long)batch_count);
+  std::printf("Rail vertices:         %llu\n",
+              (unsigned long long)rail_vertex_count);
+  std::printf("Rail indices:          %llu\n",
+              (unsigned long long)rail_index_count);
+  std::printf("Crosstie vertices:     %llu\n",
+              (unsigned long long)crosstie_vertex_count);
+  std::printf("Vertex and index data: %.1f MiB\n",
+              vertex_bytes / (1024.0 * 1024.0));
+  std::printf("Batch time:            %.3f msec (%.1f M vertices/sec)\n",
+              (end - path_end) / 1e6, vertex_count / ((end - path_end) / 1e3));
+  std::printf("Largest batch:         %llu rail vertices, index %llu\n",
+              (unsigned long long)max_batch_rail_vertex_count,
+              (unsigned long long)max_batch_index);
+  PrintArenaStats("Camera path", &path_arena);
+  PrintArenaStats("Batch scratch", &scratch_arena);
+
+  Status status = kStatus_Ok;
+  // Each camera path vertex has a cross section of 8 vertices in each rail,
+  // and each camera path segment 16 triangles in each rail. The camera path
+  // vertex shared by neighboring batches is in both.
+  std::uint64_t expected_rail_vertex_count =
+      16 * ((std::uint64_t)camera_path.count + batch_count - 1);
+  std::uint64_t expected_rail_index_count =
+      96 * ((std::uint64_t)camera_path.count - 1);
+  if (rail_vertex_count != expected_rail_vertex_count) {
+    std::fprintf(stderr, "Expected %llu rail vertices, made %llu.\n",
+                 (unsigned long long)expected_rail_vertex_count,
+                 (unsigned long long)rail_vertex_count);
+    status = kStatus_UnspecifiedError;
+  }
+  if (rail_index_count != expected_rail_index_count) {
+    std::fprintf(stderr, "Expected %llu rail indices, made %llu.\n",
+                 (unsigned long long)expected_rail_index_count,
+                 (unsigned long long)rail_index_count);
+    status = kStatus_UnspecifiedError;
+  }
+  if (max_batch_index > UINT32_MAX) {
+    std::fprintf(stderr, "Batch index %llu does not fit in 32 bits.\n",
+                 (unsigned long long)max_batch_index);
+    status = kStatus_UnspecifiedError;
+  }
+  if (max_batch_rail_vertex_count > kStressBatchVertexLimit) {
+    std::fprintf(stderr, "Batch of %llu rail vertices exceeds %llu.\n",
+                 (unsigned long long)max_batch_rail_vertex_count,
+                 (unsigned long long)kStressBatchVertexLimit);
+    status = kStatus_UnspecifiedError;
+  }
+
+  FreeArena(&scratch_arena);
+  FreeArena(&path_arena);
+
+  return status;
+}
+
+int main(int argc, char **argv) {
+  BenchConfig cfg;
+  cfg.min_exponent = 2;
+  cfg.max_exponent = 7;
+  cfg.repetition_count = 3;
+  cfg.max_spline_segment_len = 0.5;
+  cfg.is_csv = 0;
+  cfg.is_codec_benchmarked = 1;
+  cfg.stress_path_vertex_count = 0;
+
+  cli::Opt opts[] = {
+      {"min-exponent", cli::kOptArgType_Uint, &cfg.min_exponent},
+      {"max-exponent", cli::kOptArgType_Uint, &cfg.max_exponent},
+      {"repetition-count", cli::kOptArgType_Uint, &cfg.repetition_count},
+      {"max-spline-segment-len", cli::kOptArgType_Float,
+       &cfg.max_spline_segment_len},
+      {"codecs", cli::kOptArgType_Int, &cfg.is_codec_benchmarked},
+      {"csv", cli::kOptArgType_Int, &cfg.is_csv},
+      {"stress-path-vertex-count", cli::kOptArgType_Uint,
+       &cfg.stress_path_vertex_count}};
+
+  uint size = sizeof(opts) / sizeof(opts[0]);
+  uint argi;
+  cli::Status st = cli::ParseOpts(argc, argv, opts, size, &argi);
+  if (st != cli::kStatus_Ok || argi != (uint)argc) {
+    std::fprintf(stderr, "Failed to parse options: %s\n",
+                 cli::StatusMessage(st));
+    std::fprintf(stderr,
+                 "usage: %s [--min-exponent <e>] [--max-exponent <e>] "
+                 "[--repetition-count <n>] [--max-spline-segment-len <len>] "
+                 "[--codecs <0|1>] [--csv <0|1>] "
+                 "[--stress-path-vertex-count <n>]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (cfg.min_exponent < 1 || cfg.max_exponent > 9 ||
+      cfg.min_exponent > cfg.max_exponent) {
+    std::fprintf(stderr, "Exponents must satisfy 1 <= min <= max <= 9.\n");
+    return EXIT_FAILURE;
+  }
+
+  if (cfg.stress_path_vertex_count > 0) {
+    Status status = RunStress(&cfg);
+    return status == kStatus_Ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  std::vector<Result> results[kBenchmark__Count];
+
+  uint control_point_count = 1;
+  for (uint i = 0; i < cfg.min_exponent; ++i) {
+    control_point_count *= 10;
+  }
+
+  for (uint e = cfg.min_exponent; e <= cfg.max_exponent; ++e) {
+    std::vector<glm::vec3> control_points;
+    MakeSyntheticTrack(control_point_count, &control_points);
+
+    Arena arena;
+    InitArena(ARENA_DEFAULT_BLOCK_SIZE, 0, &arena);
+
+    VertexList1P1T1N1B camera_path;
+    MakeCameraPath(control_points.data(), control_points.size(),
+                   cfg.max_spline_segment_len, &arena, &camera_path);
+
+    for (int b = 0; b < kBenchmark__Count; ++b) {
+      Result r;
+      Run((Benchmark)b, &cfg, &control_points, &camera_path, &r);
+      results[b].push_back(r);
+    }
+
+    FreeArena(&arena);
+
+    if (!cfg.is_csv) {
+      std::fprintf(stderr, "Finished %u control points.\n",
+                   control_point_count);
+    }
+
+    control_point_count *= 10;
+  }
+
+  if (cfg.is_csv) {
+    std::printf(
+        "benchmark,control_points,vertices,time_ms,ns_per_vertex,allocs,"
+        "alloc_bytes,peak_bytes,scaling\n");
+  }
+  for (int b = 0; b < kBenchmark__Count; ++b) {
+    PrintResults((Benchmark)b, &results[b], cfg.is_csv);
+  }
+
+  if (cfg.is_codec_benchmarked) {
+    RunCodecs(&cfg);
+  }
+
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
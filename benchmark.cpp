@@ -0,0 +1,116 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static void WriteJsonString(const char *str, std::FILE *file) {
+  std::fputc('"', file);
+  for (const char *c = str; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      std::fputc('\\', file);
+      std::fputc(*c, file);
+    } else if ((uchar)*c < 0x20) {
+      std::fprintf(file, "\\u%04x", (uint)(uchar)*c);
+    } else {
+      std::fputc(*c, file);
+    }
+  }
+  std::fputc('"', file);
+}
+
+// Nearest-rank method. `sorted` must not be empty.
+static double PercentileMsec(const std::vector<std::int64_t> *sorted, uint p) {
+  assert(sorted);
+  assert(!sorted->empty());
+
+  std::size_t count = sorted->size();
+  std::size_t rank = (p * count + 99) / 100;
+  return (*sorted)[std::max<std::size_t>(rank, 1) - 1] / 1e6;
+}
+
+Status WriteBenchmarkReport(const BenchmarkReport *report, std::FILE *file) {
+  assert(report);
+  assert(file);
+
+  std::vector<std::int64_t> sorted = report->frame_times_nsec;
+  std::sort(sorted.begin(), sorted.end());
+
+  std::int64_t total_nsec = 0;
+  for (std::int64_t t : sorted) {
+    total_nsec += t;
+  }
+
+  double mean_msec = 0;
+  double stddev_msec = 0;
+  if (!sorted.empty()) {
+    mean_msec = total_nsec / 1e6 / sorted.size();
+    for (std::int64_t t : sorted) {
+      double d = t / 1e6 - mean_msec;
+      stddev_msec += d * d;
+    }
+    stddev_msec = std::sqrt(stddev_msec / sorted.size());
+  }
+
+  double total_sec = total_nsec / 1e9;
+  double frames_per_sec = 0;
+  double triangles_per_sec = 0;
+  if (total_sec > 0) {
+    frames_per_sec = sorted.size() / total_sec;
+    triangles_per_sec =
+        report->triangles_per_frame * (double)sorted.size() / total_sec;
+  }
+
+  std::fprintf(file, "{\n  \"gl_renderer\": ");
+  WriteJsonString(report->gl_renderer, file);
+  std::fprintf(file, ",\n  \"gl_version\": ");
+  WriteJsonString(report->gl_version, file);
+  std::fprintf(file,
+               ",\n  \"resolution\": [%u, %u],\n"
+               "  \"camera_path_vertex_count\": %llu,\n"
+               "  \"camera_path_step\": %u,\n",
+               report->w, report->h,
+               (unsigned long long)report->camera_path_vertex_count,
+               report->camera_path_step);
+
+  std::fprintf(file, "  \"startup_msec\": {\n    \"total\": %.3f",
+               report->startup_nsec / 1e6);
+  for (int i = 0; i < kProfilePhase_Frame; ++i) {
+    std::fprintf(file, ",\n    \"%s\": %.3f", String((ProfilePhase)i),
+                 report->phase_nsec[i] / 1e6);
+  }
+  std::fprintf(file, "\n  },\n");
+
+  std::fprintf(file, "  \"frame_count\": %zu,\n", sorted.size());
+  if (!sorted.empty()) {
+    std::fprintf(file,
+                 "  \"frame_time_msec\": {\n"
+                 "    \"min\": %.3f,\n"
+                 "    \"mean\": %.3f,\n"
+                 "    \"stddev\": %.3f,\n"
+                 "    \"p50\": %.3f,\n"
+                 "    \"p90\": %.3f,\n"
+                 "    \"p95\": %.3f,\n"
+                 "    \"p99\": %.3f,\n"
+                 "    \"max\": %.3f\n"
+                 "  },\n",
+                 sorted.front() / 1e6, mean_msec, stddev_msec,
+                 PercentileMsec(&sorted, 50), PercentileMsec(&sorted, 90),
+                 PercentileMsec(&sorted, 95), PercentileMsec(&sorted, 99),
+                 sorted.back() / 1e6);
+  }
+
+  std::fprintf(file,
+               "  \"frames_per_sec\": %.3f,\n"
+               "  \"triangles_per_frame\": %llu,\n"
+               "  \"triangles_per_sec\": %.0f\n}\n",
+               frames_per_sec, (unsigned long long)report->triangles_per_frame,
+               triangles_per_sec);
+
+  if (std::ferror(file)) {
+    std::fprintf(stderr, "Failed to write benchmark report.\n");
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef RCOASTER_BENCHMARK_HPP
+#define RCOASTER_BENCHMARK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "profiler.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+struct BenchmarkReport {
+  const char *gl_renderer;
+  const char *gl_version;
+
+  uint w;
+  uint h;
+  std::uint64_t camera_path_vertex_count;
+  uint camera_path_step;
+
+  // Indexed by `ProfilePhase`. Only the startup phases are reported.
+  std::int64_t phase_nsec[kProfilePhase__Count];
+  std::int64_t startup_nsec;
+
+  std::uint64_t triangles_per_frame;
+  std::vector<std::int64_t> frame_times_nsec;
+};
+
+// Writes the report as a JSON object, including the frame time distribution
+// and the triangle throughput calculated from the frame times.
+Status WriteBenchmarkReport(const BenchmarkReport *report, std::FILE *file);
+
+#endif  // RCOASTER_BENCHMARK_HPP
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "cache_file.hpp"
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+Status InitCacheDir(const char *cache_dir) {
+  assert(cache_dir);
+
+  if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+    std::fprintf(stderr, "Failed to create directory %s.\n", cache_dir);
+    return kStatus_IoError;
+  }
+  return kStatus_Ok;
+}
+
+std::uint64_t ExtendHash(std::uint64_t hash, const void *data,
+                         std::size_t size) {
+  assert(data || size == 0);
+
+  const uchar *p = (const uchar *)data;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+std::uint64_t HashBytes(const uchar *data, std::size_t size) {
+  return ExtendHash(CACHE_HASH_SEED, data, size);
+}
+
+std::int64_t MtimeNsec(const struct stat *st) {
+  assert(st);
+
+#ifdef __APPLE__
+  return (std::int64_t)st->st_mtimespec.tv_sec * 1000000000 +
+         st->st_mtimespec.tv_nsec;
+#else
+  return (std::int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static Status WriteAll(int fd, const void *data, std::size_t size) {
+  const uchar *p = (const uchar *)data;
+  while (size > 0) {
+    ssize_t rc = write(fd, p, size);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return kStatus_IoError;
+    }
+    p += rc;
+    size -= rc;
+  }
+  return kStatus_Ok;
+}
+
+Status WriteCacheFile(const char *filepath, const CacheFileChunk *chunks,
+                      uint chunk_count) {
+  assert(filepath);
+  assert(chunks || chunk_count == 0);
+
+  char tmp_filepath[CACHE_FILEPATH_BUFFER_SIZE + 8];
+  int rc = std::snprintf(tmp_filepath, sizeof(tmp_filepath), "%s.XXXXXX",
+                         filepath);
+  if (rc < 0 || rc >= (int)sizeof(tmp_filepath)) {
+    std::fprintf(stderr, "Failed to make temporary filepath of %s.\n",
+                 filepath);
+    return kStatus_UnspecifiedError;
+  }
+
+  int fd = mkstemp(tmp_filepath);
+  if (fd < 0) {
+    std::fprintf(stderr, "Failed to create file %s.\n", tmp_filepath);
+    return kStatus_IoError;
+  }
+  fchmod(fd, 0644);
+
+  Status status = kStatus_Ok;
+  for (uint i = 0; i < chunk_count && status == kStatus_Ok; ++i) {
+    status = WriteAll(fd, chunks[i].data, chunks[i].size);
+  }
+  if (close(fd) != 0 && status == kStatus_Ok) {
+    status = kStatus_IoError;
+  }
+  if (status == kStatus_Ok && std::rename(tmp_filepath, filepath) != 0) {
+    status = kStatus_IoError;
+  }
+
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    unlink(tmp_filepath);
+  }
+
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef RCOASTER_CACHE_FILE_HPP
+#define RCOASTER_CACHE_FILE_HPP
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "status.hpp"
+#include "types.hpp"
+
+// Of the paths of cache files, including the terminator.
+#define CACHE_FILEPATH_BUFFER_SIZE 4096
+// Hash of no bytes, to be extended with `ExtendHash`.
+#define CACHE_HASH_SEED 14695981039346656037ull
+
+// Part of the content of a cache file.
+struct CacheFileChunk {
+  const void *data;
+  std::size_t size;
+};
+
+// Creates a cache directory if it does not exist. Its parent must exist.
+Status InitCacheDir(const char *cache_dir);
+
+// FNV-1a, continued from `hash`.
+std::uint64_t ExtendHash(std::uint64_t hash, const void *data,
+                         std::size_t size);
+
+std::uint64_t HashBytes(const uchar *data, std::size_t size);
+
+std::int64_t MtimeNsec(const struct stat *st);
+
+/*
+Writes a cache file from consecutive chunks. It is written next to `filepath`
+and renamed over it, so that concurrent readers see either the old or the new
+file, never a partial one. `filepath` must fit in
+`CACHE_FILEPATH_BUFFER_SIZE`.
+*/
+Status WriteCacheFile(const char *filepath, const CacheFileChunk *chunks,
+                      uint chunk_count);
+
+#endif  // RCOASTER_CACHE_FILE_HPP
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "capture.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "profiler.hpp"
+
+#define CAPTURE_WAIT_TIMEOUT_NSEC 1000000000
+
+static constexpr uint kChannelCount = 4;
+
+const char *const kCaptureQueuePolicyStrings[kCaptureQueuePolicy__Count] = {
+    "block", "drop"};
+
+const char *String(CaptureQueuePolicy p) {
+  assert(p < kCaptureQueuePolicy__Count);
+  return kCaptureQueuePolicyStrings[p];
+}
+
+Status ParseCaptureQueuePolicy(const char *s, CaptureQueuePolicy *p) {
+  assert(s);
+  assert(p);
+
+  for (int i = 0; i < kCaptureQueuePolicy__Count; ++i) {
+    if (std::strcmp(s, kCaptureQueuePolicyStrings[i]) == 0) {
+      *p = (CaptureQueuePolicy)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown capture queue policy \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
+}
+
+const uchar *CapturedFrameTopRow(const CapturedFrame *frame) {
+  assert(frame);
+  assert(frame->pixels);
+  assert(frame->h > 0);
+
+  return frame->pixels + (std::size_t)(frame->h - 1) * frame->w * kChannelCount;
+}
+
+std::ptrdiff_t CapturedFrameStride(const CapturedFrame *frame) {
+  assert(frame);
+
+  return -(std::ptrdiff_t)frame->w * kChannelCount;
+}
+
+static void RunWorker(Capture *c) {
+  assert(c);
+
+  for (;;) {
+    CapturedFrame frame;
+    {
+      std::unique_lock<std::mutex> lock(c->mutex);
+      c->queue_not_empty.wait(
+          lock, [c] { return !c->queue.empty() || c->is_stopping; });
+      if (c->queue.empty()) {
+        return;
+      }
+      frame = c->queue.front();
+      c->queue.pop_front();
+    }
+    c->queue_not_full.notify_one();
+
+    Status status;
+    {
+      ProfileScope scope(kProfilePhase_Encode);
+      status = c->config.encode(&frame, c->config.user_data);
+    }
+    if (status == kStatus_Ok) {
+      ++c->encoded_frame_count;
+    } else {
+      ++c->failed_frame_count;
+    }
+
+    std::lock_guard<std::mutex> lock(c->mutex);
+    c->free_frames.push_back(frame);
+  }
+}
+
+Status InitCapture(const CaptureConfig *cfg, Capture *c) {
+  assert(cfg);
+  assert(cfg->queue_policy < kCaptureQueuePolicy__Count);
+  assert(cfg->encode);
+  assert(c);
+
+  c->config = *cfg;
+  if (c->config.thread_count == 0) {
+    uint hardware_thread_count = std::thread::hardware_concurrency();
+    c->config.thread_count = std::max(hardware_thread_count, 2u) - 1;
+  }
+
+  for (uint i = 0; i < CAPTURE_PBO_COUNT; ++i) {
+    c->slots[i] = {};
+    glGenBuffers(1, &c->slots[i].pbo);
+  }
+  c->oldest_slot = 0;
+  c->pending_slot_count = 0;
+
+  c->is_stopping = 0;
+  c->encoded_frame_count = 0;
+  c->dropped_frame_count = 0;
+  c->failed_frame_count = 0;
+
+  c->threads.reserve(c->config.thread_count);
+  for (uint i = 0; i < c->config.thread_count; ++i) {
+    c->threads.emplace_back(RunWorker, c);
+  }
+
+  return kStatus_Ok;
+}
+
+// Returns whether the readback into the slot has completed. Waits for at most
+// `timeout_nsec`.
+static int IsSlotReady(CaptureSlot *slot, GLuint64 timeout_nsec) {
+  assert(slot);
+  assert(slot->fence);
+
+  GLenum result =
+      glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_nsec);
+  // On `GL_WAIT_FAILED` the mapping of the buffer synchronizes instead.
+  return result != GL_TIMEOUT_EXPIRED;
+}
+
+// Copies the oldest pending readback into a frame buffer and queues it.
+static void ReadBackOldestSlot(Capture *c) {
+  assert(c);
+  assert(c->pending_slot_count > 0);
+
+  CaptureSlot *slot = &c->slots[c->oldest_slot];
+
+  glDeleteSync(slot->fence);
+  slot->fence = 0;
+  c->oldest_slot = (c->oldest_slot + 1) % CAPTURE_PBO_COUNT;
+  --c->pending_slot_count;
+
+  CapturedFrame frame = {};
+  {
+    std::unique_lock<std::mutex> lock(c->mutex);
+    if (c->config.queue_policy == kCaptureQueuePolicy_Block) {
+      c->queue_not_full.wait(
+          lock, [c] { return c->queue.size() < CAPTURE_QUEUE_CAPACITY; });
+    } else if (c->queue.size() >= CAPTURE_QUEUE_CAPACITY) {
+      ++c->dropped_frame_count;
+      return;
+    }
+
+    // The queue is bounded, so at most `CAPTURE_QUEUE_CAPACITY` plus the
+    // thread count frames are ever allocated.
+    if (!c->free_frames.empty()) {
+      frame = c->free_frames.back();
+      c->free_frames.pop_back();
+    }
+  }
+
+  std::size_t row_size = (std::size_t)slot->w * kChannelCount;
+  std::size_t size = row_size * slot->h;
+  if (frame.capacity < size) {
+    delete[] frame.pixels;
+    frame.pixels = new uchar[size];
+    frame.capacity = size;
+  }
+  frame.w = slot->w;
+  frame.h = slot->h;
+  frame.index = slot->index;
+  frame.camera_path_index = slot->camera_path_index;
+  frame.capture_nsec = slot->capture_nsec;
+
+  ProfileScope scope(kProfilePhase_Readback);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+  const uchar *mapped = (const uchar *)glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+  int is_mapped = mapped != NULL;
+  if (is_mapped) {
+    // Bottom row first, as OpenGL returns it. The encoders flip it as they
+    // read it.
+    std::memcpy(frame.pixels, mapped, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  std::lock_guard<std::mutex> lock(c->mutex);
+  if (!is_mapped) {
+    std::fprintf(stderr, "Failed to map capture pixel buffer.\n");
+    ++c->failed_frame_count;
+    c->free_frames.push_back(frame);
+    return;
+  }
+  c->queue.push_back(frame);
+  c->queue_not_empty.notify_one();
+}
+
+static void ReadBackReadySlots(Capture *c) {
+  assert(c);
+
+  // Readbacks complete in order, so the first one still in flight ends the
+  // scan.
+  while (c->pending_slot_count > 0 &&
+         IsSlotReady(&c->slots[c->oldest_slot], 0)) {
+    ReadBackOldestSlot(c);
+  }
+}
+
+void PollCapture(Capture *c) {
+  assert(c);
+
+  if (c->pending_slot_count == 0) {
+    return;
+  }
+
+  ProfileScope scope(kProfilePhase_Capture);
+  ReadBackReadySlots(c);
+}
+
+void CaptureFramebuffer(Capture *c, uint w, uint h, std::uint64_t index,
+                        std::uint64_t camera_path_index) {
+  assert(c);
+
+  ProfileScope scope(kProfilePhase_Capture);
+
+  ReadBackReadySlots(c);
+
+  if (c->pending_slot_count == CAPTURE_PBO_COUNT) {
+    if (c->config.queue_policy == kCaptureQueuePolicy_Drop) {
+      ++c->dropped_frame_count;
+      return;
+    }
+    while (!IsSlotReady(&c->slots[c->oldest_slot],
+                        CAPTURE_WAIT_TIMEOUT_NSEC)) {
+    }
+    ReadBackOldestSlot(c);
+  }
+
+  uint i = (c->oldest_slot + c->pending_slot_count) % CAPTURE_PBO_COUNT;
+  CaptureSlot *slot = &c->slots[i];
+  slot->w = w;
+  slot->h = h;
+  slot->index = index;
+  slot->camera_path_index = camera_path_index;
+  slot->capture_nsec = ProfileNowNsec();
+
+  std::size_t size = (std::size_t)w * h * kChannelCount;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+  if (slot->capacity < size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    slot->capacity = size;
+  }
+  // Returns immediately because the pixels are written into the bound buffer
+  // instead of client memory.
+  glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ++c->pending_slot_count;
+}
+
+void FreeCapture(Capture *c) {
+  assert(c);
+
+  while (c->pending_slot_count > 0) {
+    while (!IsSlotReady(&c->slots[c->oldest_slot],
+                        CAPTURE_WAIT_TIMEOUT_NSEC)) {
+    }
+    ReadBackOldestSlot(c);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(c->mutex);
+    c->is_stopping = 1;
+  }
+  c->queue_not_empty.notify_all();
+
+  for (std::thread &t : c->threads) {
+    t.join();
+  }
+  c->threads.clear();
+
+  for (CapturedFrame &frame : c->free_frames) {
+    delete[] frame.pixels;
+  }
+  c->free_frames.clear();
+
+  for (uint i = 0; i < CAPTURE_PBO_COUNT; ++i) {
+    glDeleteBuffers(1, &c->slots[i].pbo);
+    c->slots[i] = {};
+  }
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef RCOASTER_CAPTURE_HPP
+#define RCOASTER_CAPTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "opengl.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+// Number of pixel buffer objects the framebuffer is read back into. A readback
+// is mapped `CAPTURE_PBO_COUNT - 1` captures after it was issued at the latest.
+#define CAPTURE_PBO_COUNT 3
+
+// Maximum number of read back frames waiting to be encoded.
+#define CAPTURE_QUEUE_CAPACITY 8
+
+// What to do with a frame when all pixel buffer objects are in flight or the
+// queue is full.
+enum CaptureQueuePolicy {
+  // Stall the render thread until there is room.
+  kCaptureQueuePolicy_Block,
+  // Discard the frame and keep rendering.
+  kCaptureQueuePolicy_Drop,
+  kCaptureQueuePolicy__Count
+};
+
+const char *String(CaptureQueuePolicy p);
+
+Status ParseCaptureQueuePolicy(const char *s, CaptureQueuePolicy *p);
+
+struct CapturedFrame {
+  // Tightly packed RGBA rows, bottom row first, as OpenGL reads them back.
+  // Encoders read them top row first with `CapturedFrameTopRow` and
+  // `CapturedFrameStride`.
+  uchar *pixels;
+  std::size_t capacity;
+  uint w;
+  uint h;
+  std::uint64_t index;
+  std::uint64_t camera_path_index;
+  // When the readback was issued, on the profiler clock.
+  std::int64_t capture_nsec;
+};
+
+// First pixel of the top row of a frame.
+const uchar *CapturedFrameTopRow(const CapturedFrame *frame);
+
+// Signed distance in bytes from a row of a frame to the row below it.
+std::ptrdiff_t CapturedFrameStride(const CapturedFrame *frame);
+
+// Called on a worker thread for every captured frame. Must not call OpenGL.
+typedef Status (*CaptureEncodeFunc)(const CapturedFrame *frame,
+                                    void *user_data);
+
+struct CaptureConfig {
+  // Frames are encoded concurrently, and possibly out of order, by more than
+  // one worker thread. Zero uses every hardware thread but one.
+  uint thread_count;
+  CaptureQueuePolicy queue_policy;
+  CaptureEncodeFunc encode;
+  void *user_data;
+};
+
+struct CaptureSlot {
+  GLuint pbo;
+  std::size_t capacity;
+  // Null unless a readback into the PBO is in flight.
+  GLsync fence;
+  uint w;
+  uint h;
+  std::uint64_t index;
+  std::uint64_t camera_path_index;
+  std::int64_t capture_nsec;
+};
+
+/*
+Captures the framebuffer without stalling the render thread.
+
+The framebuffer is read into a ring of pixel buffer objects, and a fence is
+inserted after every readback. Readbacks whose fences have signaled are copied
+into pooled frame buffers as they are, and queued for the worker threads, which
+flip them as they encode them.
+*/
+struct Capture {
+  CaptureConfig config;
+
+  CaptureSlot slots[CAPTURE_PBO_COUNT];
+  // Slots are filled and read back in ring order.
+  uint oldest_slot;
+  uint pending_slot_count;
+
+  std::mutex mutex;
+  std::condition_variable queue_not_empty;
+  std::condition_variable queue_not_full;
+  std::deque<CapturedFrame> queue;
+  std::vector<CapturedFrame> free_frames;
+  int is_stopping;
+  std::vector<std::thread> threads;
+
+  std::atomic<std::uint64_t> encoded_frame_count;
+  std::atomic<std::uint64_t> dropped_frame_count;
+  std::atomic<std::uint64_t> failed_frame_count;
+};
+
+Status InitCapture(const CaptureConfig *cfg, Capture *c);
+
+/*
+Issues a readback of the lower left `w` x `h` pixels of the bound read
+framebuffer. The frame is passed to the encoder along with `index` and
+`camera_path_index`.
+
+Input Parameters:
+- index: identifies the frame to the encoder, e.g. to name its file
+*/
+void CaptureFramebuffer(Capture *c, uint w, uint h, std::uint64_t index,
+                        std::uint64_t camera_path_index);
+
+// Queues the readbacks that have completed without waiting for the others.
+// Call once per frame.
+void PollCapture(Capture *c);
+
+// Waits for all readbacks and encodes to complete, stops the worker threads,
+// and frees all resources. The OpenGL context must be current.
+void FreeCapture(Capture *c);
+
+#endif  // RCOASTER_CAPTURE_HPP
\ No newline at end of file
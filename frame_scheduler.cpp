@@ -0,0 +1,102 @@
+#include "frame_scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+static constexpr double kSleepOvershootWeight = 0.1;
+static constexpr double kMinSleepOvershootNsec = 50000;
+static constexpr double kMaxSleepOvershootNsec = 2000000;
+
+static std::int64_t NowNsec() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+static void AddJitterSample(double jitter_usec, JitterStats *stats) {
+  assert(stats);
+
+  // Welford's online algorithm.
+  ++stats->sample_count;
+  double delta = jitter_usec - stats->mean_usec;
+  stats->mean_usec += delta / stats->sample_count;
+  stats->m2_usec += delta * (jitter_usec - stats->mean_usec);
+
+  if (jitter_usec > stats->max_usec) {
+    stats->max_usec = jitter_usec;
+  }
+}
+
+void ResetJitterStats(JitterStats *stats) {
+  assert(stats);
+  *stats = {};
+}
+
+double JitterStddevUsec(const JitterStats *stats) {
+  assert(stats);
+
+  if (stats->sample_count < 2) {
+    return 0;
+  }
+  return std::sqrt(stats->m2_usec / (stats->sample_count - 1));
+}
+
+void InitFrameScheduler(float target_fps, FrameScheduler *s) {
+  assert(target_fps >= 0);
+  assert(s);
+
+  s->frame_period_nsec = 0;
+  if (target_fps > 0) {
+    s->frame_period_nsec = (std::int64_t)(1e9 / target_fps);
+  }
+  s->sleep_overshoot_nsec = kMinSleepOvershootNsec;
+
+  ResetJitterStats(&s->interval_jitter);
+  ResetJitterStats(&s->total_jitter);
+  ResetFrameDeadline(s);
+}
+
+void ResetFrameDeadline(FrameScheduler *s) {
+  assert(s);
+  s->next_deadline_nsec = NowNsec() + s->frame_period_nsec;
+}
+
+void WaitForNextFrame(FrameScheduler *s) {
+  assert(s);
+
+  if (s->frame_period_nsec == 0) {
+    return;
+  }
+
+  std::int64_t now = NowNsec();
+  std::int64_t remaining = s->next_deadline_nsec - now;
+
+  double spin_threshold = 2 * s->sleep_overshoot_nsec;
+  if (remaining > spin_threshold) {
+    std::int64_t sleep_duration = remaining - (std::int64_t)spin_threshold;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_duration));
+
+    std::int64_t woke = NowNsec();
+    double overshoot = (double)(woke - now - sleep_duration);
+    overshoot = std::clamp(overshoot, kMinSleepOvershootNsec,
+                           kMaxSleepOvershootNsec);
+    s->sleep_overshoot_nsec += kSleepOvershootWeight *
+                               (overshoot - s->sleep_overshoot_nsec);
+    now = woke;
+  }
+
+  while (now < s->next_deadline_nsec) {
+    now = NowNsec();
+  }
+
+  double jitter_usec = (now - s->next_deadline_nsec) / 1000.0;
+  AddJitterSample(jitter_usec, &s->interval_jitter);
+  AddJitterSample(jitter_usec, &s->total_jitter);
+
+  s->next_deadline_nsec += s->frame_period_nsec;
+  if (s->next_deadline_nsec + s->frame_period_nsec < now) {
+    s->next_deadline_nsec = now + s->frame_period_nsec;
+  }
+}
\ No newline at end of file
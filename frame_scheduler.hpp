@@ -0,0 +1,49 @@
+#ifndef RCOASTER_FRAME_SCHEDULER_HPP
+#define RCOASTER_FRAME_SCHEDULER_HPP
+
+#include <cstdint>
+
+#include "types.hpp"
+
+struct JitterStats {
+  std::uint64_t sample_count;
+  double mean_usec;
+  double m2_usec;
+  double max_usec;
+};
+
+struct FrameScheduler {
+  // Zero disables pacing.
+  std::int64_t frame_period_nsec;
+  std::int64_t next_deadline_nsec;
+
+  // Exponentially weighted average of how late the OS wakes the thread from a
+  // sleep. The remainder of every wait shorter than twice this value is spun.
+  double sleep_overshoot_nsec;
+
+  // Deviation of the actual frame start from its deadline.
+  JitterStats interval_jitter;
+  JitterStats total_jitter;
+};
+
+void InitFrameScheduler(float target_fps, FrameScheduler *s);
+
+/*
+Blocks until the deadline of the next frame.
+
+Sleeps for most of the remaining time and spins for the rest, so the frame
+starts close to its deadline even when the OS sleep granularity is coarse. If
+the deadline has already passed by more than a frame period, pacing restarts
+from now instead of rendering a burst of frames to catch up.
+*/
+void WaitForNextFrame(FrameScheduler *s);
+
+// Restarts pacing from now. Call after idling so that the frames not rendered
+// while idle are not counted as jitter.
+void ResetFrameDeadline(FrameScheduler *s);
+
+double JitterStddevUsec(const JitterStats *stats);
+
+void ResetJitterStats(JitterStats *stats);
+
+#endif  // RCOASTER_FRAME_SCHEDULER_HPP
\ No newline at end of file
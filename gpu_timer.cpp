@@ -0,0 +1,92 @@
+#include "gpu_timer.hpp"
+
+#include <cassert>
+
+void InitGpuTimers(GpuTimers *t) {
+  assert(t);
+
+  *t = {};
+
+#ifdef __APPLE__
+  t->is_supported = 1;
+#else
+  t->is_supported = glewIsSupported("GL_VERSION_3_3") ||
+                    glewIsSupported("GL_ARB_timer_query");
+#endif
+
+  if (!IsProfilerEnabled() || !t->is_supported) {
+    t->is_supported = 0;
+    return;
+  }
+
+  glGenQueries(GPU_TIMER_FRAME_LATENCY * kProfilePhase__Count,
+               &t->queries[0][0]);
+}
+
+void CollectGpuTimers(GpuTimers *t) {
+  assert(t);
+
+  if (!t->is_supported) {
+    return;
+  }
+
+  ++t->frame_index;
+  uint set = t->frame_index % GPU_TIMER_FRAME_LATENCY;
+
+  for (int i = 0; i < kProfilePhase__Count; ++i) {
+    if (!t->is_pending[set][i]) {
+      continue;
+    }
+    t->is_pending[set][i] = 0;
+
+    GLuint query = t->queries[set][i];
+    GLint is_available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (!is_available) {
+      continue;
+    }
+
+    GLuint64 elapsed_nsec;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_nsec);
+    RecordProfileEvent((ProfilePhase)i, kProfileClock_Gpu,
+                       t->submit_nsec[set][i], (std::int64_t)elapsed_nsec);
+  }
+}
+
+void BeginGpuTimer(GpuTimers *t, ProfilePhase phase) {
+  assert(t);
+  assert(phase < kProfilePhase__Count);
+
+  if (!t->is_supported) {
+    return;
+  }
+
+  uint set = t->frame_index % GPU_TIMER_FRAME_LATENCY;
+  t->submit_nsec[set][phase] = ProfileNowNsec();
+  glBeginQuery(GL_TIME_ELAPSED, t->queries[set][phase]);
+}
+
+void EndGpuTimer(GpuTimers *t, ProfilePhase phase) {
+  assert(t);
+  assert(phase < kProfilePhase__Count);
+
+  if (!t->is_supported) {
+    return;
+  }
+
+  uint set = t->frame_index % GPU_TIMER_FRAME_LATENCY;
+  glEndQuery(GL_TIME_ELAPSED);
+  t->is_pending[set][phase] = 1;
+}
+
+void FreeGpuTimers(GpuTimers *t) {
+  assert(t);
+
+  if (!t->is_supported) {
+    return;
+  }
+
+  glDeleteQueries(GPU_TIMER_FRAME_LATENCY * kProfilePhase__Count,
+                  &t->queries[0][0]);
+  t->is_supported = 0;
+}
\ No newline at end of file
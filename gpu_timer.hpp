@@ -0,0 +1,39 @@
+#ifndef RCOASTER_GPU_TIMER_HPP
+#define RCOASTER_GPU_TIMER_HPP
+
+#include <cstdint>
+
+#include "opengl.hpp"
+#include "profiler.hpp"
+
+#define GPU_TIMER_FRAME_LATENCY 2
+
+/*
+Measures the GPU time of profile phases with `GL_TIME_ELAPSED` queries.
+
+Queries are double-buffered: the queries issued in a frame are read back
+`GPU_TIMER_FRAME_LATENCY` frames later, by which time their results are almost
+always available. A result that is still unavailable is discarded instead of
+stalling the pipeline.
+*/
+struct GpuTimers {
+  int is_supported;
+  uint frame_index;
+  GLuint queries[GPU_TIMER_FRAME_LATENCY][kProfilePhase__Count];
+  std::int64_t submit_nsec[GPU_TIMER_FRAME_LATENCY][kProfilePhase__Count];
+  int is_pending[GPU_TIMER_FRAME_LATENCY][kProfilePhase__Count];
+};
+
+void InitGpuTimers(GpuTimers *t);
+
+// Records the results of the queries issued `GPU_TIMER_FRAME_LATENCY` frames
+// ago as GPU profile events. Call once at the start of every frame.
+void CollectGpuTimers(GpuTimers *t);
+
+void BeginGpuTimer(GpuTimers *t, ProfilePhase phase);
+
+void EndGpuTimer(GpuTimers *t, ProfilePhase phase);
+
+void FreeGpuTimers(GpuTimers *t);
+
+#endif  // RCOASTER_GPU_TIMER_HPP
\ No newline at end of file
@@ -1,29 +1,63 @@
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <limits>
 #include <string>
 #include <vector>
 
-#define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include "benchmark.hpp"
+#include "cache_file.hpp"
+#include "capture.hpp"
 #include "cli.hpp"
+#include "frame_scheduler.hpp"
+#include "gpu_timer.hpp"
 #include "main.hpp"
 #include "meshes.hpp"
+#include "offscreen.hpp"
 #include "opengl.hpp"
+#include "profiler.hpp"
+#include "program_cache.hpp"
+#include "qoi.hpp"
 #include "scene.hpp"
 #include "shader.hpp"
+#include "shm_ring.hpp"
 #include "status.hpp"
-#include "stb_image.h"
+#include "task_graph.hpp"
 #include "stb_image_write.h"
+#include "texture_cache.hpp"
+#include "texture_loader.hpp"
+#include "thread_pool.hpp"
+#include "tiled_capture.hpp"
+#include "track_cache.hpp"
+#include "track_edit.hpp"
+#include "track_stream.hpp"
 #include "types.hpp"
+#include "video.hpp"
 
-static const char *String(VertexFormat f) {
-  assert(f < kVertexFormat__Count);
-  return kVertexFormatStrings[f];
+static const char *String(ScreenshotFormat f) {
+  assert(f < kScreenshotFormat__Count);
+  return kScreenshotFormatStrings[f];
+}
+
+static Status ParseScreenshotFormat(const char *s, ScreenshotFormat *f) {
+  assert(s);
+  assert(f);
+
+  for (int i = 0; i < kScreenshotFormat__Count; ++i) {
+    if (std::strcmp(s, kScreenshotFormatStrings[i]) == 0) {
+      *f = (ScreenshotFormat)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown screenshot format \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
 }
 
 static void PressButton(MouseState *s, Button b) {
@@ -58,64 +92,131 @@ static Button FromGlButton(int button) {
   }
 }
 
-static Status InitTexture(const char *img_filepath, GLuint texture_name,
-                          GLfloat anisotropy_degree) {
-  assert(img_filepath);
+static Status MakeScreenshotFilepath(const Config *cfg, std::uint64_t index,
+                                     ScreenshotFormat format,
+                                     char filepath[FILEPATH_BUFFER_SIZE]) {
+  assert(cfg);
+  assert(filepath);
 
-  int w;
-  int h;
-  int channel_count;
-  uchar *data =
-      stbi_load(img_filepath, &w, &h, &channel_count, kRgbaChannel__Count);
-  if (!data) {
-    std::fprintf(stderr, "Failed to load image file %s.\n", img_filepath);
-    return kStatus_IoError;
+  int rc = std::snprintf(filepath, FILEPATH_BUFFER_SIZE, "%s/%s_%03llu.%s",
+                         cfg->screenshot_directory_path,
+                         cfg->screenshot_filename_prefix,
+                         (unsigned long long)index, String(format));
+  if (rc < 0 || rc >= FILEPATH_BUFFER_SIZE) {
+    std::fprintf(stderr, "Failed to make screenshot filepath.\n");
+    return kStatus_UnspecifiedError;
   }
-
-  glBindTexture(GL_TEXTURE_2D, texture_name);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-               data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                  GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
-                  anisotropy_degree);
-
-  stbi_image_free(data);
-
   return kStatus_Ok;
 }
 
-Status SaveScreenshot(const char *filepath, uint window_w, uint window_h) {
-  assert(filepath);
+// Writes a captured frame to an image file. Called on a capture worker thread.
+static Status EncodeScreenshot(const CapturedFrame *frame, void *user_data) {
+  assert(frame);
+  assert(user_data);
 
-  uchar *buffer = new uchar[window_w * window_h * kRgbChannel__Count];
+  const Config *cfg = (const Config *)user_data;
 
-  glReadPixels(0, 0, window_w, window_h, GL_RGB, GL_UNSIGNED_BYTE, buffer);
-  stbi_flip_vertically_on_write(1);
-  int rc = stbi_write_jpg(filepath, window_w, window_h, kRgbChannel__Count,
-                          buffer, 95);
+  char filepath[FILEPATH_BUFFER_SIZE];
+  Status status = MakeScreenshotFilepath(cfg, frame->index,
+                                         cfg->screenshot_format, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
 
-  delete[] buffer;
+  // The alpha channel is ignored.
+  switch (cfg->screenshot_format) {
+    case kScreenshotFormat_Jpg: {
+      int rc = stbi_write_jpg(filepath, frame->w, frame->h,
+                              kRgbaChannel__Count, frame->pixels, 95);
+      if (rc == 0) {
+        std::fprintf(stderr, "Could not write data to JPEG file %s.\n",
+                     filepath);
+        return kStatus_IoError;
+      }
+      break;
+    }
+    case kScreenshotFormat_Qoi: {
+      status = WriteQoiFile(filepath, CapturedFrameTopRow(frame),
+                            CapturedFrameStride(frame), frame->w, frame->h,
+                            kRgbChannel__Count);
+      if (status != kStatus_Ok) {
+        return status;
+      }
+      break;
+    }
+    default: {
+      assert(false);
+    }
+  }
 
-  if (rc == 0) {
-    std::fprintf(stderr, "Could not write data to JPEG file %s.\n", filepath);
-    return kStatus_IoError;
+  if (cfg->is_verbose) {
+    std::printf("Saved screenshot to file %s.\n", filepath);
   }
 
   return kStatus_Ok;
 }
 
+// Appends a captured frame to the video stream. There is only one video
+// capture worker thread, so frames arrive in order.
+static Status EncodeVideoFrame(const CapturedFrame *frame, void *user_data) {
+  assert(frame);
+  assert(user_data);
+  return WriteVideoFrame(frame, (VideoWriter *)user_data);
+}
+
+// Copies a captured frame into the shared memory ring. There is only one
+// shared memory capture worker thread, so frames are published in order.
+static Status PublishFrame(const CapturedFrame *frame, void *user_data) {
+  assert(frame);
+  assert(user_data);
+
+  ShmFrameInfo info;
+  info.frame_index = frame->index;
+  info.camera_path_index = frame->camera_path_index;
+  info.capture_nsec = frame->capture_nsec;
+  info.w = frame->w;
+  info.h = frame->h;
+  return PublishShmFrame(&info, CapturedFrameTopRow(frame),
+                         CapturedFrameStride(frame), (ShmRing *)user_data);
+}
+
 static Config config;
 static Scene scene;
 
 static uint screenshot_count;
 static uint record_video;
+static int is_screenshot_requested;
+static int is_hires_screenshot_requested;
+
+static Capture capture;
+
+static Capture video_capture;
+static VideoWriter video_writer;
+static std::uint64_t video_frame_count;
+
+static Capture shm_capture;
+static ShmRing shm_ring;
+static std::uint64_t shm_frame_count;
+
+static int IsVideoStreamed() {
+  return config.video_output_filepath[0] != '\0';
+}
+
+static int IsShmPublished() { return config.shm_output_name[0] != '\0'; }
+
+// Whether the track is configured to be streamed. A track too large to be
+// drawn in one batch is streamed regardless.
+static int IsTrackStreamConfigured() {
+  return config.track_stream_window_size > 0 || config.is_startup_progressive;
+}
+
+// Valid once the track has been made.
+static int IsTrackStreamed() { return scene.is_track_streamed; }
+
+// Valid once the track has been made. Streamed tracks are not watched.
+static int IsTrackWatched() {
+  return config.is_track_watched && !IsTrackStreamed();
+}
 
 static uint window_w = 1280;
 static uint window_h = 720;
@@ -128,21 +229,52 @@ static WorldStateOp world_state_op = kWorldStateOp_Rotate;
 
 static WorldState world_state = {{}, {}, {1, 1, 1}};
 
-static uint camera_path_index;
+static std::size_t camera_path_index;
+static int is_ride_paused;
+
+static FrameScheduler frame_scheduler;
+static int is_window_visible = 1;
+static int is_idle_func_set;
+static uint previous_idle_callback_time;
+
+static GpuTimers gpu_timers;
+
+static ThreadPool worker_pool;
+
+static TrackStream track_stream;
+
+static TrackEditor track_editor;
+
+static int exit_status = EXIT_SUCCESS;
 
 static GLuint program_names[kVertexFormat__Count];
-static GLuint textures[kTexture__Count];
+static TextureLayer texture_layers[kTexture__Count];
 static GLuint vao_names[kVao__Count];
 static GLuint vbo_names[kVbo__Count];
 
 static glm::mat4 view_mat;
 static glm::mat4 projection_mat;
 
+static void UpdateProjection() {
+  assert(window_h > 0);
+  float aspect = (float)window_w / window_h;
+  projection_mat =
+      glm::perspective(glm::radians(config.view_frustum.fov_y), aspect,
+                       config.view_frustum.near_z, config.view_frustum.far_z);
+}
+
 static void OnWindowReshape(int w, int h) {
   window_w = w;
   window_h = h;
 
   glViewport(0, 0, w, h);
+
+  // A minimized window has no height and is not drawn.
+  if (h > 0) {
+    // The window is drawn again even while idling, with its new aspect ratio.
+    UpdateProjection();
+    glutPostRedisplay();
+  }
 }
 
 static void OnPassiveMouseMotion(int x, int y) {
@@ -232,16 +364,163 @@ static void OnMousePressOrRelease(int button, int state, int x, int y) {
   mouse_state.position.y = y;
 }
 
+static Status ExportProfile(const char *output_prefix) {
+  assert(output_prefix);
+
+  char filepath[FILEPATH_BUFFER_SIZE];
+
+  int rc =
+      std::snprintf(filepath, FILEPATH_BUFFER_SIZE, "%s.json", output_prefix);
+  if (rc < 0 || rc >= FILEPATH_BUFFER_SIZE) {
+    std::fprintf(stderr, "Failed to make profile trace filepath.\n");
+    return kStatus_UnspecifiedError;
+  }
+  Status status = ExportProfileTrace(filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  rc = std::snprintf(filepath, FILEPATH_BUFFER_SIZE, "%s.csv", output_prefix);
+  if (rc < 0 || rc >= FILEPATH_BUFFER_SIZE) {
+    std::fprintf(stderr, "Failed to make profile CSV filepath.\n");
+    return kStatus_UnspecifiedError;
+  }
+  return ExportProfileCsv(filepath);
+}
+
+static void OnExit() {
+  static int has_exited;
+
+  if (has_exited) {
+    return;
+  }
+  has_exited = 1;
+
+  // Finishes encoding the captured frames, so their events are in the profile.
+  FreeCapture(&capture);
+  if (capture.dropped_frame_count != 0 || capture.failed_frame_count != 0) {
+    std::fprintf(stderr, "Captured frames: %llu dropped, %llu failed\n",
+                 (unsigned long long)capture.dropped_frame_count,
+                 (unsigned long long)capture.failed_frame_count);
+  }
+
+  if (IsVideoStreamed()) {
+    FreeCapture(&video_capture);
+    if (video_capture.dropped_frame_count != 0 ||
+        video_capture.failed_frame_count != 0) {
+      std::fprintf(stderr, "Video frames: %llu dropped, %llu failed\n",
+                   (unsigned long long)video_capture.dropped_frame_count,
+                   (unsigned long long)video_capture.failed_frame_count);
+    }
+
+    Status status = CloseVideoWriter(&video_writer);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to close video output.\n");
+      exit_status = EXIT_FAILURE;
+    }
+  }
+
+  if (IsShmPublished()) {
+    FreeCapture(&shm_capture);
+    if (shm_capture.dropped_frame_count != 0 ||
+        shm_capture.failed_frame_count != 0) {
+      std::fprintf(stderr, "Shared memory frames: %llu dropped, %llu failed\n",
+                   (unsigned long long)shm_capture.dropped_frame_count,
+                   (unsigned long long)shm_capture.failed_frame_count);
+    }
+
+    CloseShmRing(&shm_ring);
+  }
+
+  if (IsTrackStreamed()) {
+    FreeTrackStream(&track_stream);
+  }
+  if (IsTrackWatched()) {
+    FreeTrackEditor(&track_editor);
+  }
+  FreeScene(&scene);
+
+  FreeThreadPool(&worker_pool);
+
+  if (config.is_profiling) {
+    FrameTimePercentiles percentiles;
+    CalcFrameTimePercentiles(&percentiles);
+    std::printf("Frame time: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms\n",
+                percentiles.p50_msec, percentiles.p95_msec,
+                percentiles.p99_msec);
+
+    Status status = ExportProfile(config.profile_output_prefix);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to export profile.\n");
+    }
+
+    FreeGpuTimers(&gpu_timers);
+  }
+
+  if (frame_scheduler.frame_period_nsec != 0) {
+    const JitterStats *jitter = &frame_scheduler.total_jitter;
+    std::printf(
+        "Frame pacing: %.1f fps target, %llu frames, jitter mean %.1f us, "
+        "stddev %.1f us, max %.1f us\n",
+        config.target_fps, (unsigned long long)jitter->sample_count,
+        jitter->mean_usec, JitterStddevUsec(jitter), jitter->max_usec);
+  }
+}
+
 static void ExitGlutMainLoop(int status_code) {
+  exit_status = status_code;
 #ifdef __APPLE__
+  OnExit();
   std::exit(status_code);
 #elif defined(linux)
+  // `OnExit` is called back when the window is destroyed.
   glutLeaveMainLoop();
 #else
 #error Unsupported platform.
 #endif
 }
 
+static int IsRideOver() {
+  return camera_path_index + 1 >= scene.camspl.mesh->vl1p1t1n1b.count;
+}
+
+static void Idle();
+
+// Whether a captured frame is still being read back. Finished readbacks are
+// only collected after a frame is drawn.
+static int IsCapturePending() {
+  return capture.pending_slot_count > 0 ||
+         video_capture.pending_slot_count > 0 ||
+         shm_capture.pending_slot_count > 0;
+}
+
+// Unregisters the idle callback while nothing on screen would change, so that
+// GLUT blocks on window events instead of rendering frames nobody sees.
+static void UpdateIdleFunc() {
+  // Chunks of a streamed track are uploaded, and captured frames are
+  // collected, while idling.
+  int should_idle =
+      config.is_adaptive_idle && !record_video &&
+      (!is_window_visible || is_ride_paused || IsRideOver()) &&
+      (!IsTrackStreamed() || IsTrackStreamWindowResident(&track_stream)) &&
+      !IsCapturePending();
+
+  if (should_idle && is_idle_func_set) {
+    glutIdleFunc(NULL);
+    is_idle_func_set = 0;
+  } else if (!should_idle && !is_idle_func_set) {
+    previous_idle_callback_time = glutGet(GLUT_ELAPSED_TIME);
+    ResetFrameDeadline(&frame_scheduler);
+    glutIdleFunc(Idle);
+    is_idle_func_set = 1;
+  }
+}
+
+static void OnVisibilityChange(int state) {
+  is_window_visible = state == GLUT_VISIBLE;
+  UpdateIdleFunc();
+}
+
 static void OnKeyPress(uchar key, int x, int y) {
   switch (key) {
     case 27: {  // ESC key
@@ -249,33 +528,42 @@ static void OnKeyPress(uchar key, int x, int y) {
       break;
     }
     case 'i': {
-      char filepath[FILEPATH_BUFFER_SIZE];
-      int rc =
-          std::snprintf(filepath, FILEPATH_BUFFER_SIZE, "%s/%s_%03u.jpg",
-                        config.screenshot_directory_path,
-                        config.screenshot_filename_prefix, screenshot_count);
-
-      if (rc < 0 || rc >= FILEPATH_BUFFER_SIZE) {
-        std::fprintf(stderr, "Failed to make screenshot filepath.\n");
-        ExitGlutMainLoop(EXIT_FAILURE);
+      // The next frame is captured once it has been drawn.
+      is_screenshot_requested = 1;
+      glutPostRedisplay();
+      break;
+    }
+    case 'I': {
+      is_hires_screenshot_requested = 1;
+      glutPostRedisplay();
+      break;
+    }
+    case 'v': {
+      record_video = !record_video;
+      UpdateIdleFunc();
+      break;
+    }
+    case 'p': {
+      is_ride_paused = !is_ride_paused;
+      UpdateIdleFunc();
+      break;
+    }
+    case 't': {
+      if (!config.is_profiling) {
+        break;
       }
 
-      Status status = SaveScreenshot(filepath, window_w, window_h);
+      Status status = ExportProfile(config.profile_output_prefix);
       if (status != kStatus_Ok) {
-        std::fprintf(stderr, "Failed to save screenshot.\n");
-        ExitGlutMainLoop(EXIT_FAILURE);
+        std::fprintf(stderr, "Failed to export profile.\n");
+        break;
       }
 
       if (config.is_verbose) {
-        std::printf("Saved screenshot to file %s.\n", filepath);
+        std::printf("Exported profile to files %s.json and %s.csv.\n",
+                    config.profile_output_prefix,
+                    config.profile_output_prefix);
       }
-
-      ++screenshot_count;
-
-      break;
-    }
-    case 'v': {
-      record_video = !record_video;
       break;
     }
   }
@@ -283,11 +571,12 @@ static void OnKeyPress(uchar key, int x, int y) {
 
 static Status UpdateWindowTitle(uint update_period, uint current_time,
                                 const char *title_prefix, uint w, uint h,
-                                uint *frame_count) {
+                                uint *frame_count, FrameScheduler *scheduler) {
   static uint previous_fps_display_time;
 
   assert(title_prefix);
   assert(frame_count);
+  assert(scheduler);
 
   uint delta_time = current_time - previous_fps_display_time;
 
@@ -299,9 +588,31 @@ static Status UpdateWindowTitle(uint update_period, uint current_time,
 
   char window_title_buffer[512];
 
-  int rc =
-      std::snprintf(window_title_buffer, 512, "%s: %u fps , %u x %u resolution",
-                    title_prefix, fps, w, h);
+  int rc = std::snprintf(window_title_buffer, 512, "%s: %u fps", title_prefix,
+                         fps);
+
+  if (scheduler->frame_period_nsec != 0 && rc >= 0 && rc < 512) {
+    const JitterStats *jitter = &scheduler->interval_jitter;
+    rc += std::snprintf(window_title_buffer + rc, 512 - rc,
+                        " , %.0f us mean jitter , %.0f us max jitter",
+                        jitter->mean_usec, jitter->max_usec);
+    ResetJitterStats(&scheduler->interval_jitter);
+  }
+
+  if (IsProfilerEnabled() && rc >= 0 && rc < 512) {
+    FrameTimePercentiles percentiles;
+    CalcFrameTimePercentiles(&percentiles);
+    rc += std::snprintf(window_title_buffer + rc, 512 - rc,
+                        " , %.1f / %.1f / %.1f ms p50 / p95 / p99",
+                        percentiles.p50_msec, percentiles.p95_msec,
+                        percentiles.p99_msec);
+  }
+
+  if (rc >= 0 && rc < 512) {
+    rc += std::snprintf(window_title_buffer + rc, 512 - rc,
+                        " , %u x %u resolution", w, h);
+  }
+
   if (rc < 0 || rc >= 512) {
     std::fprintf(stderr, "Failed to form window title.\n");
     return kStatus_UnspecifiedError;
@@ -315,62 +626,69 @@ static Status UpdateWindowTitle(uint update_period, uint current_time,
   return kStatus_Ok;
 }
 
+static void UpdateCamera() {
+  view_mat =
+      glm::lookAt(scene.camspl.mesh->vl1p1t1n1b.positions[camera_path_index],
+                  scene.camspl.mesh->vl1p1t1n1b.positions[camera_path_index] +
+                      scene.camspl.mesh->vl1p1t1n1b.tangents[camera_path_index],
+                  scene.camspl.mesh->vl1p1t1n1b.normals[camera_path_index]);
+
+  UpdateProjection();
+}
+
 static void Idle() {
-  static uint previous_idle_callback_time;
+  WaitForNextFrame(&frame_scheduler);
 
   int current_time = glutGet(GLUT_ELAPSED_TIME);
 
-  Status status =
-      UpdateWindowTitle(WINDOW_TITLE_UPDATE_PERIOD_MSEC, current_time,
-                        kWindowTitlePrefix, window_w, window_h, &frame_count);
+  Status status = UpdateWindowTitle(WINDOW_TITLE_UPDATE_PERIOD_MSEC,
+                                    current_time, kWindowTitlePrefix, window_w,
+                                    window_h, &frame_count, &frame_scheduler);
   if (status != kStatus_Ok) {
     std::fprintf(stderr, "Failed to update window title.\n");
     ExitGlutMainLoop(EXIT_FAILURE);
   }
 
-  if (camera_path_index < scene.camspl.mesh->vl1p1t1n1b.count) {
+  if (!is_ride_paused && !IsRideOver()) {
     float delta_time = (current_time - previous_idle_callback_time) / 1000.0f;
     camera_path_index += config.camera_speed * delta_time;
-  }
-
-  view_mat =
-      glm::lookAt(scene.camspl.mesh->vl1p1t1n1b.positions[camera_path_index],
-                  scene.camspl.mesh->vl1p1t1n1b.positions[camera_path_index] +
-                      scene.camspl.mesh->vl1p1t1n1b.tangents[camera_path_index],
-                  scene.camspl.mesh->vl1p1t1n1b.normals[camera_path_index]);
-
-  assert(window_h > 0);
-  float aspect = (float)window_w / window_h;
-  projection_mat =
-      glm::perspective(glm::radians(config.view_frustum.fov_y), aspect,
-                       config.view_frustum.near_z, config.view_frustum.far_z);
-
-  if (record_video) {
-    char filepath[FILEPATH_BUFFER_SIZE];
-    int rc = std::snprintf(filepath, FILEPATH_BUFFER_SIZE, "%s/%s_%03u.jpg",
-                           config.screenshot_directory_path,
-                           config.screenshot_filename_prefix, screenshot_count);
-    if (rc < 0 || rc >= FILEPATH_BUFFER_SIZE) {
-      std::fprintf(stderr, "Failed to make screenshot filepath.\n");
-      ExitGlutMainLoop(EXIT_FAILURE);
-    }
 
-    Status status = SaveScreenshot(filepath, window_w, window_h);
-    if (status != kStatus_Ok) {
-      std::fprintf(stderr, "Failed to save screenshot.\n");
-      ExitGlutMainLoop(EXIT_FAILURE);
+    std::size_t last_index = scene.camspl.mesh->vl1p1t1n1b.count - 1;
+    if (camera_path_index > last_index) {
+      camera_path_index = last_index;
     }
+  }
 
-    ++screenshot_count;
+  if (IsTrackStreamed()) {
+    UpdateTrackStream(&track_stream, camera_path_index, 0);
   }
 
+  UpdateCamera();
+
   previous_idle_callback_time = current_time;
 
   glutPostRedisplay();
+
+  UpdateIdleFunc();
 }
 
-static void Display() {
-  ++frame_count;
+// Binds the texture array of a layer unless it is already bound, and selects
+// the layer.
+static void UseTextureLayer(const TextureLayer *layer, GLint layer_loc,
+                            GLuint *bound_texture) {
+  assert(layer);
+  assert(bound_texture);
+
+  if (layer->texture != *bound_texture) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, layer->texture);
+    *bound_texture = layer->texture;
+  }
+  glUniform1i(layer_loc, layer->layer);
+}
+
+// Draws the scene with the draw phases timed on the GPU by `timers`.
+static void DrawScene(GpuTimers *timers) {
+  assert(timers);
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -390,7 +708,11 @@ static void Display() {
 
   glBindVertexArray(vao_names[kVao_Colored]);
 
-  {
+  if (IsTrackStreamed()) {
+    ProfileScope scope(kProfilePhase_DrawRails);
+    BeginGpuTimer(timers, kProfilePhase_DrawRails);
+
+    // Both rails have the same transform.
     glm::mat4 model_view = view_mat * scene.left_rail.world_transform;
 
     glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
@@ -398,20 +720,36 @@ static void Display() {
     glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
                        glm::value_ptr(projection_mat));
 
-    glDrawElements(GL_TRIANGLES, scene.left_rail.mesh->index_count,
-                   GL_UNSIGNED_INT, BUFFER_OFFSET(0));
-  }
-  {
-    glm::mat4 model_view = view_mat * scene.right_rail.world_transform;
+    DrawTrackStreamRails(&track_stream);
 
-    glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
-                       glm::value_ptr(model_view));
-    glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
-                       glm::value_ptr(projection_mat));
+    EndGpuTimer(timers, kProfilePhase_DrawRails);
+  } else {
+    ProfileScope scope(kProfilePhase_DrawRails);
+    BeginGpuTimer(timers, kProfilePhase_DrawRails);
+    {
+      glm::mat4 model_view = view_mat * scene.left_rail.world_transform;
+
+      glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
+                         glm::value_ptr(model_view));
+      glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
+                         glm::value_ptr(projection_mat));
+
+      glDrawElements(GL_TRIANGLES, scene.left_rail.mesh->index_count,
+                     GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+    }
+    {
+      glm::mat4 model_view = view_mat * scene.right_rail.world_transform;
 
-    glDrawElements(
-        GL_TRIANGLES, scene.right_rail.mesh->index_count, GL_UNSIGNED_INT,
-        BUFFER_OFFSET(scene.left_rail.mesh->index_count * sizeof(GLuint)));
+      glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
+                         glm::value_ptr(model_view));
+      glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
+                         glm::value_ptr(projection_mat));
+
+      glDrawElements(
+          GL_TRIANGLES, scene.right_rail.mesh->index_count, GL_UNSIGNED_INT,
+          BUFFER_OFFSET(scene.left_rail.mesh->index_count * sizeof(GLuint)));
+    }
+    EndGpuTimer(timers, kProfilePhase_DrawRails);
   }
 
   glBindVertexArray(0);
@@ -422,15 +760,22 @@ static void Display() {
   prog = program_names[kVertexFormat_Textured];
   model_view_mat_loc = glGetUniformLocation(prog, "model_view");
   proj_mat_loc = glGetUniformLocation(prog, "projection");
+  GLint tex_layer_loc = glGetUniformLocation(prog, "tex_layer");
 
   glUseProgram(prog);
 
   glBindVertexArray(vao_names[kVao_IndexedTextured]);
 
-  GLuint buf_offset = 0;
+  // Textures of the same layout share an array, which is bound only once.
+  GLuint bound_texture = 0;
+
+  GLintptr buf_offset = 0;
 
   // Ground
   {
+    ProfileScope scope(kProfilePhase_DrawGround);
+    BeginGpuTimer(timers, kProfilePhase_DrawGround);
+
     glm::mat4 model_view = view_mat * scene.ground.world_transform;
 
     glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
@@ -438,16 +783,22 @@ static void Display() {
     glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
                        glm::value_ptr(projection_mat));
 
-    glBindTexture(GL_TEXTURE_2D, textures[kTexture_Ground]);
+    UseTextureLayer(&texture_layers[kTexture_Ground], tex_layer_loc,
+                    &bound_texture);
 
     glDrawElements(GL_TRIANGLES, scene.ground.mesh->index_count,
                    GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 
+    EndGpuTimer(timers, kProfilePhase_DrawGround);
+
     buf_offset += scene.ground.mesh->index_count * sizeof(GLuint);
   }
 
   // Sky
   {
+    ProfileScope scope(kProfilePhase_DrawSky);
+    BeginGpuTimer(timers, kProfilePhase_DrawSky);
+
     glm::mat4 model_view = view_mat * scene.sky.world_transform;
 
     glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
@@ -455,10 +806,13 @@ static void Display() {
     glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
                        glm::value_ptr(projection_mat));
 
-    glBindTexture(GL_TEXTURE_2D, textures[kTexture_Sky]);
+    UseTextureLayer(&texture_layers[kTexture_Sky], tex_layer_loc,
+                    &bound_texture);
 
     glDrawElements(GL_TRIANGLES, scene.sky.mesh->index_count, GL_UNSIGNED_INT,
                    BUFFER_OFFSET(buf_offset));
+
+    EndGpuTimer(timers, kProfilePhase_DrawSky);
   }
 
   glBindVertexArray(0);
@@ -467,16 +821,13 @@ static void Display() {
    * Textured models
    *******************/
 
-  prog = program_names[kVertexFormat_Textured];
-  model_view_mat_loc = glGetUniformLocation(prog, "model_view");
-  proj_mat_loc = glGetUniformLocation(prog, "projection");
-
-  glUseProgram(prog);
-
   glBindVertexArray(vao_names[kVao_Textured]);
 
   // Crossties
   {
+    ProfileScope scope(kProfilePhase_DrawCrossties);
+    BeginGpuTimer(timers, kProfilePhase_DrawCrossties);
+
     glm::mat4 model_view = view_mat * scene.crossties.world_transform;
 
     glUniformMatrix4fv(model_view_mat_loc, 1, kIsRowMajor,
@@ -484,84 +835,323 @@ static void Display() {
     glUniformMatrix4fv(proj_mat_loc, 1, kIsRowMajor,
                        glm::value_ptr(projection_mat));
 
-    glBindTexture(GL_TEXTURE_2D, textures[kTexture_Crossties]);
-    for (uint offset = 0; offset < scene.crossties.mesh->vl1p1uv.count;
-         offset += 36) {
-      glDrawArrays(GL_TRIANGLES, offset, 36);
+    UseTextureLayer(&texture_layers[kTexture_Crossties], tex_layer_loc,
+                    &bound_texture);
+
+    if (IsTrackStreamed()) {
+      DrawTrackStreamCrossties(&track_stream);
+    } else {
+      // The crossties are contiguous and share their state, so they are drawn
+      // at once.
+      glDrawArrays(GL_TRIANGLES, 0, scene.crossties.mesh->vl1p1uv.count);
     }
+
+    EndGpuTimer(timers, kProfilePhase_DrawCrossties);
   }
 
   glBindVertexArray(0);
-
-  glutSwapBuffers();
 }
 
-static void InitSceneConfig(const Config *cfg, SceneConfig *scene_cfg) {
-  assert(cfg);
-  assert(scene_cfg);
-
-  scene_cfg->aabb_side_len = 256;
+// Captures the drawn frame if a screenshot was requested or video is being
+// recorded, and hands completed captures to the encoder threads.
+static void CaptureScene() {
+  int is_video_saved = !IsVideoStreamed() && !IsShmPublished();
 
-  scene_cfg->ground_position = {0, -scene_cfg->aabb_side_len * (1.0f / 8), 0};
-  scene_cfg->ground_tex_repeat_count = 36;
+  if (record_video && IsVideoStreamed()) {
+    CaptureFramebuffer(&video_capture, window_w, window_h, video_frame_count,
+                       camera_path_index);
+    ++video_frame_count;
+  }
+  if (record_video && IsShmPublished()) {
+    CaptureFramebuffer(&shm_capture, window_w, window_h, shm_frame_count,
+                       camera_path_index);
+    ++shm_frame_count;
+  }
+  if (is_screenshot_requested || (record_video && is_video_saved)) {
+    CaptureFramebuffer(&capture, window_w, window_h, screenshot_count,
+                       camera_path_index);
+    ++screenshot_count;
+    is_screenshot_requested = 0;
+  }
+  PollCapture(&capture);
+  PollCapture(&video_capture);
+  PollCapture(&shm_capture);
+}
 
-  scene_cfg->sky_position = {};
-  scene_cfg->sky_tex_repeat_count = 1;
+static void DrawFrame() {
+  ProfileScope frame_scope(kProfilePhase_Frame);
+  CollectGpuTimers(&gpu_timers);
+  DrawScene(&gpu_timers);
+}
 
-  scene_cfg->rails_position = {};
-  scene_cfg->rails_color = {0.5, 0.5, 0.5, 1};
-  scene_cfg->rails_head_w = 0.2;
-  scene_cfg->rails_head_h = 0.1;
-  scene_cfg->rails_web_w = 0.1;
-  scene_cfg->rails_web_h = 0.1;
-  scene_cfg->rails_gauge = 2;
-  scene_cfg->rails_pos_offset_in_camspl_norm_dir = -2;
+static void DrawTile(const glm::mat4 *projection, void *user_data) {
+  assert(projection);
+  (void)user_data;
 
-  scene_cfg->crossties_position = {};
-  scene_cfg->crossties_separation_dist = 1;
-  scene_cfg->crossties_pos_offset_in_camspl_norm_dir = -2;
+  // Tiles are not frames. Their timers are unsupported, so that they neither
+  // issue queries nor record GPU events.
+  static GpuTimers tile_gpu_timers = {};
 
-  scene_cfg->track_filepath = cfg->track_filepath;
-  scene_cfg->max_spline_segment_len = cfg->max_spline_segment_len;
-  scene_cfg->is_verbose = cfg->is_verbose;
+  projection_mat = *projection;
+  DrawScene(&tile_gpu_timers);
 }
 
-void ConfigureGlut(int argc, char **argv, uint window_w, uint window_h,
-                   uint window_x, uint window_y, const char *window_title) {
-  glutInit(&argc, argv);
+// Renders the current view at `hires_screenshot_scale` times the window size in
+// tiles and saves it as a QOI file. Blocks until the file is written.
+static Status TakeHiresScreenshot() {
+  char filepath[FILEPATH_BUFFER_SIZE];
+  Status status = MakeScreenshotFilepath(&config, screenshot_count,
+                                         kScreenshotFormat_Qoi, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+  ++screenshot_count;
 
-#ifdef __APPLE__
-  glutInitDisplayMode(GLUT_3_2_CORE_PROFILE | GLUT_DOUBLE | GLUT_RGB |
-                      GLUT_DEPTH | GLUT_STENCIL);
-#else
-  glutInitContextVersion(3, 2);
-  glutInitContextProfile(GLUT_CORE_PROFILE);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_STENCIL);
-#endif
+  TiledCaptureConfig cfg;
+  cfg.w = window_w * config.hires_screenshot_scale;
+  cfg.h = window_h * config.hires_screenshot_scale;
+  cfg.supersample_factor = config.hires_screenshot_supersample_factor;
+  cfg.max_tile_size = config.hires_screenshot_tile_size;
+  cfg.projection = projection_mat;
+  cfg.draw = DrawTile;
+  cfg.user_data = NULL;
 
-  glutInitWindowSize(window_w, window_h);
-  glutInitWindowPosition(window_x, window_y);
-  glutCreateWindow(window_title);
+  std::int64_t start_nsec = ProfileNowNsec();
 
-  glutDisplayFunc(Display);
-  glutIdleFunc(Idle);
-  glutMotionFunc(OnMouseDrag);
-  glutPassiveMotionFunc(OnPassiveMouseMotion);
-  glutMouseFunc(OnMousePressOrRelease);
-  glutReshapeFunc(OnWindowReshape);
-  glutKeyboardFunc(OnKeyPress);
-}
+  status = WriteTiledQoiFile(filepath, &cfg);
+  projection_mat = cfg.projection;
+  if (status != kStatus_Ok) {
+    return status;
+  }
 
-void DefaultInit(Config *cfg) {
-  assert(cfg);
+  if (config.is_verbose) {
+    std::printf("Saved %u x %u screenshot to file %s in %.3f s.\n", cfg.w,
+                cfg.h, filepath, (ProfileNowNsec() - start_nsec) / 1e9);
+  }
+
+  return kStatus_Ok;
+}
+
+static void Display() {
+  static std::int64_t previous_frame_start_nsec;
+
+  ++frame_count;
+
+  std::int64_t frame_start_nsec = ProfileNowNsec();
+  if (previous_frame_start_nsec != 0) {
+    RecordFrameTime(frame_start_nsec - previous_frame_start_nsec);
+  }
+  previous_frame_start_nsec = frame_start_nsec;
+
+  DrawFrame();
+  CaptureScene();
+
+  if (is_hires_screenshot_requested) {
+    is_hires_screenshot_requested = 0;
+    Status status = TakeHiresScreenshot();
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to take high-resolution screenshot.\n");
+    }
+  }
+
+  glutSwapBuffers();
+
+  // A frame captured while idle is only collected by later frames.
+  UpdateIdleFunc();
+}
+
+static std::uint64_t TrianglesPerFrame() {
+  std::uint64_t index_count = scene.left_rail.mesh->index_count +
+                              scene.right_rail.mesh->index_count +
+                              scene.ground.mesh->index_count +
+                              scene.sky.mesh->index_count;
+  std::uint64_t triangle_count =
+      index_count / 3 + scene.crossties.mesh->vl1p1uv.count / 3;
+  if (IsTrackStreamed()) {
+    triangle_count += TrackStreamTriangleCount(&track_stream);
+  }
+  return triangle_count;
+}
+
+/*
+Renders frames into the bound framebuffer as fast as possible while advancing
+the camera by a fixed number of camera path vertices per frame, so that every
+run renders the same frames regardless of timing.
+
+Each frame is timed until the GPU has finished rendering it.
+*/
+static Status RunBenchmark(std::int64_t startup_nsec) {
+  std::size_t vertex_count = scene.camspl.mesh->vl1p1t1n1b.count;
+  uint step = config.benchmark_camera_path_step;
+
+  std::size_t frame_total = config.benchmark_frame_count;
+  if (frame_total == 0) {
+    // One full lap.
+    frame_total = (vertex_count - 1 + step - 1) / step + 1;
+  }
+
+  BenchmarkReport report = {};
+  report.gl_renderer = (const char *)glGetString(GL_RENDERER);
+  report.gl_version = (const char *)glGetString(GL_VERSION);
+  report.w = window_w;
+  report.h = window_h;
+  report.camera_path_vertex_count = vertex_count;
+  report.camera_path_step = step;
+  report.startup_nsec = startup_nsec;
+  for (int i = 0; i < kProfilePhase_Frame; ++i) {
+    report.phase_nsec[i] = TotalPhaseNsec((ProfilePhase)i, kProfileClock_Cpu);
+  }
+  if (IsTrackStreamed()) {
+    // Counts the triangles of a resident window, which a progressive startup
+    // has not uploaded yet.
+    UpdateTrackStream(&track_stream, 0, 1);
+  }
+  report.triangles_per_frame = TrianglesPerFrame();
+  report.frame_times_nsec.reserve(frame_total);
+
+  glViewport(0, 0, window_w, window_h);
+
+  record_video = config.benchmark_record_video;
+
+  for (std::size_t i = 0; i < frame_total; ++i) {
+    std::size_t index = i * step;
+    camera_path_index = index < vertex_count ? index : vertex_count - 1;
+
+    std::int64_t frame_start_nsec = ProfileNowNsec();
+
+    if (IsTrackStreamed()) {
+      // Waits for the chunks, so that every run renders the same frames.
+      UpdateTrackStream(&track_stream, camera_path_index, 1);
+    }
+    UpdateCamera();
+    DrawFrame();
+    CaptureScene();
+    glFinish();
+
+    std::int64_t frame_nsec = ProfileNowNsec() - frame_start_nsec;
+    report.frame_times_nsec.push_back(frame_nsec);
+    RecordFrameTime(frame_nsec);
+    ++frame_count;
+  }
+
+  if (config.benchmark_hires_screenshot) {
+    Status status = TakeHiresScreenshot();
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to take high-resolution screenshot.\n");
+      return status;
+    }
+  }
+
+  std::FILE *file = stdout;
+  if (config.benchmark_report_filepath[0] != '\0') {
+    file = std::fopen(config.benchmark_report_filepath, "w");
+    if (!file) {
+      std::fprintf(stderr, "Failed to open file %s.\n",
+                   config.benchmark_report_filepath);
+      return kStatus_IoError;
+    }
+  }
+
+  Status status = WriteBenchmarkReport(&report, file);
+
+  if (file != stdout) {
+    int rc = std::fclose(file);
+    if (rc != 0 && status == kStatus_Ok) {
+      std::fprintf(stderr, "Failed to write file %s.\n",
+                   config.benchmark_report_filepath);
+      status = kStatus_IoError;
+    }
+  }
+
+  return status;
+}
+
+static void InitSceneConfig(const Config *cfg, SceneConfig *scene_cfg) {
+  assert(cfg);
+  assert(scene_cfg);
+
+  scene_cfg->aabb_side_len = 256;
+
+  scene_cfg->ground_position = {0, -scene_cfg->aabb_side_len * (1.0f / 8), 0};
+  scene_cfg->ground_tex_repeat_count = 36;
+
+  scene_cfg->sky_position = {};
+  scene_cfg->sky_tex_repeat_count = 1;
+
+  scene_cfg->rails_position = {};
+  scene_cfg->rails_color = {0.5, 0.5, 0.5, 1};
+  scene_cfg->rails_head_w = 0.2;
+  scene_cfg->rails_head_h = 0.1;
+  scene_cfg->rails_web_w = 0.1;
+  scene_cfg->rails_web_h = 0.1;
+  scene_cfg->rails_gauge = 2;
+  scene_cfg->rails_pos_offset_in_camspl_norm_dir = -2;
+
+  scene_cfg->crossties_position = {};
+  scene_cfg->crossties_separation_dist = 1;
+  scene_cfg->crossties_pos_offset_in_camspl_norm_dir = -2;
+
+  scene_cfg->track_filepath = cfg->track_filepath;
+  scene_cfg->pool = &worker_pool;
+  scene_cfg->track_cache_dir = cfg->track_cache_dir;
+  scene_cfg->is_track_streamed = IsTrackStreamConfigured();
+  scene_cfg->is_track_editable = cfg->is_track_watched;
+  scene_cfg->max_batch_vertex_count = cfg->max_track_batch_vertex_count;
+  scene_cfg->max_spline_segment_len = cfg->max_spline_segment_len;
+  scene_cfg->spline_simplify_tolerance = cfg->spline_simplify_tolerance;
+  scene_cfg->max_camera_path_vertex_count = cfg->max_camera_path_vertex_count;
+  scene_cfg->is_arena_huge_page_backed = cfg->is_arena_huge_page_backed;
+  scene_cfg->is_verbose = cfg->is_verbose;
+}
+
+void ConfigureGlut(int argc, char **argv, uint window_w, uint window_h,
+                   uint window_x, uint window_y, const char *window_title) {
+  glutInit(&argc, argv);
+
+#ifdef __APPLE__
+  glutInitDisplayMode(GLUT_3_2_CORE_PROFILE | GLUT_DOUBLE | GLUT_RGB |
+                      GLUT_DEPTH | GLUT_STENCIL);
+#else
+  glutInitContextVersion(3, 2);
+  glutInitContextProfile(GLUT_CORE_PROFILE);
+  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_STENCIL);
+#endif
+
+  glutInitWindowSize(window_w, window_h);
+  glutInitWindowPosition(window_x, window_y);
+  glutCreateWindow(window_title);
+
+  glutDisplayFunc(Display);
+  glutMotionFunc(OnMouseDrag);
+  glutPassiveMotionFunc(OnPassiveMouseMotion);
+  glutMouseFunc(OnMousePressOrRelease);
+  glutReshapeFunc(OnWindowReshape);
+  glutKeyboardFunc(OnKeyPress);
+  glutVisibilityFunc(OnVisibilityChange);
+
+#ifdef __APPLE__
+  glutWMCloseFunc(OnExit);
+#else
+  glutCloseFunc(OnExit);
+  glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+#endif
+}
+
+void DefaultInit(Config *cfg) {
+  assert(cfg);
 
   cfg->view_frustum.fov_y = 60;
   cfg->view_frustum.far_z = 10000;
   cfg->view_frustum.near_z = 0.01;
 
   cfg->max_spline_segment_len = 0.5;
+  cfg->spline_simplify_tolerance = 0;
+  cfg->max_camera_path_vertex_count = 0;
   cfg->camera_speed = 100;
 
+  cfg->target_fps = 0;
+  cfg->is_adaptive_idle = 1;
+
   int rc = std::snprintf(cfg->screenshot_directory_path,
                          sizeof(cfg->screenshot_directory_path), ".");
 
@@ -572,6 +1162,47 @@ void DefaultInit(Config *cfg) {
 
   assert(rc >= 0 && rc < (int)sizeof(cfg->screenshot_filename_prefix));
 
+  cfg->screenshot_format = kScreenshotFormat_Jpg;
+
+  cfg->hires_screenshot_scale = 4;
+  cfg->hires_screenshot_supersample_factor = 1;
+  cfg->hires_screenshot_tile_size = 2048;
+
+  cfg->is_profiling = 0;
+  rc = std::snprintf(cfg->profile_output_prefix,
+                     sizeof(cfg->profile_output_prefix), "profile");
+
+  assert(rc >= 0 && rc < (int)sizeof(cfg->profile_output_prefix));
+
+  cfg->worker_thread_count = 0;
+  cfg->texture_cache_dir[0] = '\0';
+  cfg->texture_compression = kTextureCompression_None;
+  cfg->shader_cache_dir[0] = '\0';
+  cfg->track_cache_dir[0] = '\0';
+  cfg->track_stream_window_size = 0;
+  cfg->track_stream_chunk_size = 1024;
+  cfg->track_stream_upload_budget_msec = 2;
+  cfg->max_track_batch_vertex_count = 1 << 22;
+  cfg->is_startup_progressive = 0;
+  cfg->is_track_watched = 0;
+  cfg->is_arena_huge_page_backed = 0;
+
+  cfg->capture_thread_count = 0;
+  cfg->capture_queue_policy = kCaptureQueuePolicy_Block;
+
+  cfg->video_output_filepath[0] = '\0';
+  cfg->video_format = kVideoFormat_Y4m;
+
+  cfg->shm_output_name[0] = '\0';
+  cfg->shm_slot_count = 4;
+
+  cfg->is_benchmark = 0;
+  cfg->benchmark_frame_count = 0;
+  cfg->benchmark_camera_path_step = 1;
+  cfg->benchmark_report_filepath[0] = '\0';
+  cfg->benchmark_record_video = 0;
+  cfg->benchmark_hires_screenshot = 0;
+
   cfg->is_verbose = 0;
 }
 
@@ -579,14 +1210,87 @@ static Status ParseConfig(uint argc, char *argv[], Config *cfg) {
   assert(argv);
   assert(cfg);
 
+  char screenshot_format[FILENAME_BUFFER_SIZE];
+  int rc = std::snprintf(screenshot_format, FILENAME_BUFFER_SIZE, "%s",
+                         String(cfg->screenshot_format));
+  assert(rc >= 0 && rc < FILENAME_BUFFER_SIZE);
+
+  char capture_queue_policy[FILENAME_BUFFER_SIZE];
+  rc = std::snprintf(capture_queue_policy, FILENAME_BUFFER_SIZE, "%s",
+                     String(cfg->capture_queue_policy));
+  assert(rc >= 0 && rc < FILENAME_BUFFER_SIZE);
+
+  char texture_compression[FILENAME_BUFFER_SIZE];
+  rc = std::snprintf(texture_compression, FILENAME_BUFFER_SIZE, "%s",
+                     String(cfg->texture_compression));
+  assert(rc >= 0 && rc < FILENAME_BUFFER_SIZE);
+
+  char video_format[FILENAME_BUFFER_SIZE];
+  rc = std::snprintf(video_format, FILENAME_BUFFER_SIZE, "%s",
+                     String(cfg->video_format));
+  assert(rc >= 0 && rc < FILENAME_BUFFER_SIZE);
+
   cli::Opt opts[] = {
       {"max-spline-segment-len", cli::kOptArgType_Float,
        &cfg->max_spline_segment_len},
+      {"max-camera-path-vertex-count", cli::kOptArgType_Uint,
+       &cfg->max_camera_path_vertex_count},
+      {"spline-simplify-tolerance", cli::kOptArgType_Float,
+       &cfg->spline_simplify_tolerance},
       {"camera-speed", cli::kOptArgType_Float, &cfg->camera_speed},
       {"screenshot-filename-prefix", cli::kOptArgType_String,
        &cfg->screenshot_filename_prefix},
       {"screenshot-directory-path", cli::kOptArgType_String,
        &cfg->screenshot_directory_path},
+      {"screenshot-format", cli::kOptArgType_String, screenshot_format},
+      {"hires-screenshot-scale", cli::kOptArgType_Uint,
+       &cfg->hires_screenshot_scale},
+      {"hires-screenshot-supersample-factor", cli::kOptArgType_Uint,
+       &cfg->hires_screenshot_supersample_factor},
+      {"hires-screenshot-tile-size", cli::kOptArgType_Uint,
+       &cfg->hires_screenshot_tile_size},
+      {"target-fps", cli::kOptArgType_Float, &cfg->target_fps},
+      {"adaptive-idle", cli::kOptArgType_Int, &cfg->is_adaptive_idle},
+      {"worker-thread-count", cli::kOptArgType_Uint,
+       &cfg->worker_thread_count},
+      {"texture-cache-dir", cli::kOptArgType_String, &cfg->texture_cache_dir},
+      {"texture-compression", cli::kOptArgType_String, texture_compression},
+      {"shader-cache-dir", cli::kOptArgType_String, &cfg->shader_cache_dir},
+      {"track-cache-dir", cli::kOptArgType_String, &cfg->track_cache_dir},
+      {"track-stream-window-size", cli::kOptArgType_Uint,
+       &cfg->track_stream_window_size},
+      {"track-stream-chunk-size", cli::kOptArgType_Uint,
+       &cfg->track_stream_chunk_size},
+      {"track-stream-upload-budget-msec", cli::kOptArgType_Float,
+       &cfg->track_stream_upload_budget_msec},
+      {"progressive-startup", cli::kOptArgType_Int,
+       &cfg->is_startup_progressive},
+      {"max-track-batch-vertex-count", cli::kOptArgType_Uint,
+       &cfg->max_track_batch_vertex_count},
+      {"watch-track", cli::kOptArgType_Int, &cfg->is_track_watched},
+      {"arena-huge-pages", cli::kOptArgType_Int,
+       &cfg->is_arena_huge_page_backed},
+      {"capture-thread-count", cli::kOptArgType_Uint,
+       &cfg->capture_thread_count},
+      {"capture-queue-policy", cli::kOptArgType_String, capture_queue_policy},
+      {"video-output", cli::kOptArgType_String, &cfg->video_output_filepath},
+      {"video-format", cli::kOptArgType_String, video_format},
+      {"shm-output", cli::kOptArgType_String, &cfg->shm_output_name},
+      {"shm-slot-count", cli::kOptArgType_Uint, &cfg->shm_slot_count},
+      {"profile", cli::kOptArgType_Int, &cfg->is_profiling},
+      {"profile-output-prefix", cli::kOptArgType_String,
+       &cfg->profile_output_prefix},
+      {"benchmark", cli::kOptArgType_Int, &cfg->is_benchmark},
+      {"benchmark-frame-count", cli::kOptArgType_Uint,
+       &cfg->benchmark_frame_count},
+      {"benchmark-camera-path-step", cli::kOptArgType_Uint,
+       &cfg->benchmark_camera_path_step},
+      {"benchmark-report-filepath", cli::kOptArgType_String,
+       &cfg->benchmark_report_filepath},
+      {"benchmark-record-video", cli::kOptArgType_Int,
+       &cfg->benchmark_record_video},
+      {"benchmark-hires-screenshot", cli::kOptArgType_Int,
+       &cfg->benchmark_hires_screenshot},
       {"verbose", cli::kOptArgType_Int, &cfg->is_verbose}};
 
   uint size = sizeof(opts) / sizeof(opts[0]);
@@ -637,169 +1341,131 @@ static Status ParseConfig(uint argc, char *argv[], Config *cfg) {
 
   cfg->crossties_texture_filepath = argv[argi];
 
-  return kStatus_Ok;
-}
-
-int main(int argc, char **argv) {
-  ConfigureGlut(argc, argv, window_w, window_h, 0, 0, kWindowTitlePrefix);
+  if (cfg->target_fps < 0) {
+    std::fprintf(stderr, "Target frame rate must not be negative.\n");
+    return kStatus_UnspecifiedError;
+  }
 
-  DefaultInit(&config);
-  Status status = ParseConfig(argc, argv, &config);
+  Status status =
+      ParseScreenshotFormat(screenshot_format, &cfg->screenshot_format);
   if (status != kStatus_Ok) {
-    std::fprintf(stderr, "Failed to parse config.\n");
-    return EXIT_FAILURE;
+    return status;
   }
 
-  if (config.is_verbose) {
-    std::printf("OpenGL Info: \n");
-    std::printf("  Version: %s\n", glGetString(GL_VERSION));
-    std::printf("  Renderer: %s\n", glGetString(GL_RENDERER));
-    std::printf("  Shading Language Version: %s\n",
-                glGetString(GL_SHADING_LANGUAGE_VERSION));
+  status =
+      ParseCaptureQueuePolicy(capture_queue_policy, &cfg->capture_queue_policy);
+  if (status != kStatus_Ok) {
+    return status;
   }
 
-#ifdef linux
-  GLenum result = glewInit();
-  if (result != GLEW_OK) {
-    std::fprintf(stderr, "glewInit failed: %s", glewGetErrorString(result));
-    return EXIT_FAILURE;
+  status = ParseTextureCompression(texture_compression,
+                                   &cfg->texture_compression);
+  if (status != kStatus_Ok) {
+    return status;
   }
-#endif
 
-  SceneConfig scene_cfg;
-  InitSceneConfig(&config, &scene_cfg);
-  status = MakeScene(&scene_cfg, &scene);
+  status = ParseVideoFormat(video_format, &cfg->video_format);
   if (status != kStatus_Ok) {
-    std::fprintf(stderr, "Failed to make scene.\n");
-    return EXIT_FAILURE;
+    return status;
   }
 
-  /************************************
-   * Setup OpenGL state.
-   ************************************/
-
-  glClearColor(0, 0, 0, 0);
-  glEnable(GL_DEPTH_TEST);
+  if (cfg->hires_screenshot_scale == 0) {
+    std::fprintf(stderr,
+                 "High-resolution screenshot scale must be positive.\n");
+    return kStatus_UnspecifiedError;
+  }
 
-  // Setup shader programs.
-  for (int i = 0; i < kVertexFormat__Count; ++i) {
-    std::vector<GLuint> shader_names(kShaderType__Count);
-    for (int j = 0; j < kShaderType__Count; ++j) {
-      std::string content;
+  if (cfg->hires_screenshot_supersample_factor == 0 ||
+      cfg->hires_screenshot_supersample_factor >
+          TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR) {
+    std::fprintf(stderr,
+                 "High-resolution screenshot supersample factor must be "
+                 "between 1 and %d.\n",
+                 TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR);
+    return kStatus_UnspecifiedError;
+  }
 
-      Status status = LoadFile(kShaderFilepaths[i][j], &content);
-      if (status != kStatus_Ok) {
-        std::fprintf(stderr, "Failed to load shader file.\n");
-        return EXIT_FAILURE;
-      }
+  if (cfg->shm_slot_count == 0) {
+    std::fprintf(stderr, "Shared memory slot count must be positive.\n");
+    return kStatus_UnspecifiedError;
+  }
 
-      status = MakeShaderObj(&content, (ShaderType)j, &shader_names[j]);
-      if (status != kStatus_Ok) {
-        std::fprintf(stderr, "Failed to make shader object from file %s.\n",
-                     kShaderFilepaths[i][j]);
-        return EXIT_FAILURE;
-      }
-    }
+  // The rails of a chunk must fit 32-bit indices.
+  if (cfg->track_stream_chunk_size == 0 ||
+      cfg->track_stream_chunk_size > MAX_TRACK_STREAM_CHUNK_SIZE) {
+    std::fprintf(stderr, "Track stream chunk size must be between 1 and %u.\n",
+                 MAX_TRACK_STREAM_CHUNK_SIZE);
+    return kStatus_UnspecifiedError;
+  }
 
-    Status status = MakeShaderProg(&shader_names, &program_names[i]);
-    if (status != kStatus_Ok) {
-      std::fprintf(stderr,
-                   "Failed to make shader program for vertex "
-                   "format \"%s\".\n",
-                   String((VertexFormat)i));
-      return EXIT_FAILURE;
-    }
+  if (cfg->track_stream_upload_budget_msec < 0) {
+    std::fprintf(stderr,
+                 "Track stream upload budget must not be negative.\n");
+    return kStatus_UnspecifiedError;
   }
 
-  // Setup textures.
-  glGenTextures(kTexture__Count, textures);
-  {
-    GLfloat max_anisotropy_degree;
-    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy_degree);
+  // A batch holds the rails of at least one segment of the camera path.
+  if (cfg->max_track_batch_vertex_count < 32 ||
+      cfg->max_track_batch_vertex_count > MAX_TRACK_BATCH_VERTEX_COUNT) {
+    std::fprintf(stderr,
+                 "Max track batch vertex count must be between 32 and %u.\n",
+                 MAX_TRACK_BATCH_VERTEX_COUNT);
+    return kStatus_UnspecifiedError;
+  }
 
-    if (config.is_verbose) {
-      std::printf("Maximum degree of anisotropy: %f\n", max_anisotropy_degree);
-    }
+  if (!(cfg->spline_simplify_tolerance >= 0)) {
+    std::fprintf(stderr, "Spline simplify tolerance must not be negative.\n");
+    return kStatus_UnspecifiedError;
+  }
 
-    GLfloat anisotropy_degree = max_anisotropy_degree * 0.5f;
+  if (cfg->benchmark_camera_path_step == 0) {
+    std::fprintf(stderr, "Benchmark camera path step must be positive.\n");
+    return kStatus_UnspecifiedError;
+  }
 
-    status = InitTexture(config.ground_texture_filepath,
-                         textures[kTexture_Ground], anisotropy_degree);
-    if (status != kStatus_Ok) {
-      std::fprintf(stderr, "Failed to initialize ground texture.\n");
-      return EXIT_FAILURE;
-    }
+  return kStatus_Ok;
+}
 
-    status = InitTexture(config.sky_texture_filepath, textures[kTexture_Sky],
-                         anisotropy_degree);
-    if (status != kStatus_Ok) {
-      std::fprintf(stderr, "Failed to initialize sky texture.\n");
-      return EXIT_FAILURE;
-    }
+// Uploads the crossties and sets up their VAO.
+static void UploadCrossties() {
+  ProfileScope scope(kProfilePhase_Upload);
 
-    status = InitTexture(config.crossties_texture_filepath,
-                         textures[kTexture_Crossties], anisotropy_degree);
-    if (status != kStatus_Ok) {
-      std::fprintf(stderr, "Failed to initialize crosstie texture.\n");
-      return EXIT_FAILURE;
-    }
+  // The buffer and VAO are reused when the crossties are uploaded again.
+  if (vbo_names[kVbo_TexturedVertices] == 0) {
+    glGenBuffers(1, &vbo_names[kVbo_TexturedVertices]);
+    glGenVertexArrays(1, &vao_names[kVao_Textured]);
   }
 
-  glGenBuffers(kVbo__Count, vbo_names);
-  glGenVertexArrays(kVao__Count, vao_names);
-
   // textured
   VertexList1P1UV *textured_vlists[] = {&scene.crossties.mesh->vl1p1uv};
 
   uint textured_vlist_count =
       sizeof(textured_vlists) / sizeof(textured_vlists[0]);
 
-  uint textured_vertex_count = 0;
+  std::size_t textured_vertex_count = 0;
   for (uint i = 0; i < textured_vlist_count; ++i) {
     textured_vertex_count += textured_vlists[i]->count;
   }
 
-  // indexed textured
-  VertexList1P1UV *indexed_textured_vlists[] = {&scene.ground.mesh->vl1p1uv,
-                                                &scene.sky.mesh->vl1p1uv};
-  uint indexed_textured_vlist_count =
-      sizeof(indexed_textured_vlists) / sizeof(indexed_textured_vlists[0]);
-
-  uint indexed_textured_vertex_count = 0;
-  for (uint i = 0; i < indexed_textured_vlist_count; ++i) {
-    indexed_textured_vertex_count += indexed_textured_vlists[i]->count;
-  }
-
-  // indexed colored
-  VertexList1P1C *indexed_colored_vlists[] = {&scene.left_rail.mesh->vl1p1c,
-                                              &scene.right_rail.mesh->vl1p1c};
-  uint indexed_colored_vlist_count =
-      sizeof(indexed_colored_vlists) / sizeof(indexed_colored_vlists[0]);
-
-  uint indexed_colored_vertex_count = 0;
-  for (uint i = 0; i < indexed_colored_vlist_count; ++i) {
-    indexed_colored_vertex_count += indexed_colored_vlists[i]->count;
-  }
-
   // Buffer textured vertices.
   {
     glBindBuffer(GL_ARRAY_BUFFER, vbo_names[kVbo_TexturedVertices]);
 
-    uint buffer_size =
+    GLsizeiptr buffer_size =
         textured_vertex_count * (sizeof(glm::vec3) + sizeof(glm::vec2));
     glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
-    uint offset = 0;
+    GLintptr offset = 0;
 
     for (uint i = 0; i < textured_vlist_count; ++i) {
-      uint size = textured_vlists[i]->count * sizeof(glm::vec3);
+      GLsizeiptr size = textured_vlists[i]->count * sizeof(glm::vec3);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size,
                       textured_vlists[i]->positions);
       offset += size;
     }
 
     for (uint i = 0; i < textured_vlist_count; ++i) {
-      uint size = textured_vlists[i]->count * sizeof(glm::vec2);
+      GLsizeiptr size = textured_vlists[i]->count * sizeof(glm::vec2);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size, textured_vlists[i]->uv);
       offset += size;
     }
@@ -829,26 +1495,46 @@ int main(int argc, char **argv) {
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
   }
+}
+
+// Uploads the ground and sky and sets up their VAO.
+static void UploadScenery() {
+  ProfileScope scope(kProfilePhase_Upload);
+
+  glGenBuffers(1, &vbo_names[kVbo_IndexedTexturedVertices]);
+  glGenBuffers(1, &vbo_names[kVbo_TexturedIndices]);
+  glGenVertexArrays(1, &vao_names[kVao_IndexedTextured]);
+
+  // indexed textured
+  VertexList1P1UV *indexed_textured_vlists[] = {&scene.ground.mesh->vl1p1uv,
+                                                &scene.sky.mesh->vl1p1uv};
+  uint indexed_textured_vlist_count =
+      sizeof(indexed_textured_vlists) / sizeof(indexed_textured_vlists[0]);
+
+  std::size_t indexed_textured_vertex_count = 0;
+  for (uint i = 0; i < indexed_textured_vlist_count; ++i) {
+    indexed_textured_vertex_count += indexed_textured_vlists[i]->count;
+  }
 
   // Buffer indexed textured vertices.
   {
     glBindBuffer(GL_ARRAY_BUFFER, vbo_names[kVbo_IndexedTexturedVertices]);
 
-    uint buffer_size =
+    GLsizeiptr buffer_size =
         indexed_textured_vertex_count * (sizeof(glm::vec3) + sizeof(glm::vec2));
     glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
-    uint offset = 0;
+    GLintptr offset = 0;
 
     for (uint i = 0; i < indexed_textured_vlist_count; ++i) {
-      uint size = indexed_textured_vlists[i]->count * sizeof(glm::vec3);
+      GLsizeiptr size = indexed_textured_vlists[i]->count * sizeof(glm::vec3);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size,
                       indexed_textured_vlists[i]->positions);
       offset += size;
     }
 
     for (uint i = 0; i < indexed_textured_vlist_count; ++i) {
-      uint size = indexed_textured_vlists[i]->count * sizeof(glm::vec2);
+      GLsizeiptr size = indexed_textured_vlists[i]->count * sizeof(glm::vec2);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size,
                       indexed_textured_vlists[i]->uv);
       offset += size;
@@ -859,19 +1545,19 @@ int main(int argc, char **argv) {
 
   // Buffer textured indices.
   {
-    for (uint i = 0; i < scene.sky.mesh->index_count; ++i) {
+    for (std::size_t i = 0; i < scene.sky.mesh->index_count; ++i) {
       scene.sky.mesh->indices[i] += scene.ground.mesh->vl1p1uv.count;
     }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_names[kVbo_TexturedIndices]);
 
-    uint index_count =
+    std::size_t index_count =
         scene.ground.mesh->index_count + scene.sky.mesh->index_count;
-    uint buffer_size = index_count * sizeof(uint);
+    GLsizeiptr buffer_size = index_count * sizeof(uint);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
-    uint offset = 0;
-    uint size = scene.ground.mesh->index_count * sizeof(uint);
+    GLintptr offset = 0;
+    GLsizeiptr size = scene.ground.mesh->index_count * sizeof(uint);
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size,
                     scene.ground.mesh->indices);
 
@@ -908,26 +1594,49 @@ int main(int argc, char **argv) {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   }
+}
+
+// Uploads the rails and sets up their VAO.
+static void UploadRails() {
+  ProfileScope scope(kProfilePhase_Upload);
+
+  // The buffers and VAO are reused when the rails are uploaded again.
+  if (vbo_names[kVbo_ColoredVertices] == 0) {
+    glGenBuffers(1, &vbo_names[kVbo_ColoredVertices]);
+    glGenBuffers(1, &vbo_names[kVbo_RailIndices]);
+    glGenVertexArrays(1, &vao_names[kVao_Colored]);
+  }
+
+  // indexed colored
+  VertexList1P1C *indexed_colored_vlists[] = {&scene.left_rail.mesh->vl1p1c,
+                                              &scene.right_rail.mesh->vl1p1c};
+  uint indexed_colored_vlist_count =
+      sizeof(indexed_colored_vlists) / sizeof(indexed_colored_vlists[0]);
+
+  std::size_t indexed_colored_vertex_count = 0;
+  for (uint i = 0; i < indexed_colored_vlist_count; ++i) {
+    indexed_colored_vertex_count += indexed_colored_vlists[i]->count;
+  }
 
   // Buffer colored vertices.
   {
     glBindBuffer(GL_ARRAY_BUFFER, vbo_names[kVbo_ColoredVertices]);
 
-    uint buffer_size =
+    GLsizeiptr buffer_size =
         indexed_colored_vertex_count * (sizeof(glm::vec3) + sizeof(glm::vec4));
     glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
-    uint offset = 0;
+    GLintptr offset = 0;
 
     for (uint i = 0; i < indexed_colored_vlist_count; ++i) {
-      uint size = indexed_colored_vlists[i]->count * sizeof(glm::vec3);
+      GLsizeiptr size = indexed_colored_vlists[i]->count * sizeof(glm::vec3);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size,
                       indexed_colored_vlists[i]->positions);
       offset += size;
     }
 
     for (uint i = 0; i < indexed_colored_vlist_count; ++i) {
-      uint size = indexed_colored_vlists[i]->count * sizeof(glm::vec4);
+      GLsizeiptr size = indexed_colored_vlists[i]->count * sizeof(glm::vec4);
       glBufferSubData(GL_ARRAY_BUFFER, offset, size,
                       indexed_colored_vlists[i]->colors);
       offset += size;
@@ -938,25 +1647,21 @@ int main(int argc, char **argv) {
 
   // Buffer colored indices.
   {
-    for (uint i = 0; i < scene.right_rail.mesh->index_count; ++i) {
-      scene.right_rail.mesh->indices[i] += scene.left_rail.mesh->vl1p1c.count;
-    }
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_names[kVbo_RailIndices]);
 
-    uint index_count =
+    std::size_t index_count =
         scene.left_rail.mesh->index_count + scene.right_rail.mesh->index_count;
-    uint buffer_size = index_count * sizeof(uint);
+    GLsizeiptr buffer_size = index_count * sizeof(uint);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
-    uint offset = 0;
-    uint size = scene.left_rail.mesh->index_count * sizeof(uint);
+    GLintptr offset = 0;
+    GLsizeiptr size = scene.left_rail.mesh->index_count * sizeof(uint);
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size,
                     scene.left_rail.mesh->indices);
 
     offset += size;
     size = scene.right_rail.mesh->index_count * sizeof(uint);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, size, offset,
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size,
                     scene.right_rail.mesh->indices);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -986,8 +1691,541 @@ int main(int argc, char **argv) {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   }
+}
+
+// Uploads the parts of the rails and crossties that an edit of the track
+// changed over the old ones.
+static void UploadTrackPatch(const TrackPatch *patch) {
+  assert(patch);
+
+  if (patch->is_resized) {
+    UploadRails();
+    UploadCrossties();
+    return;
+  }
+
+  ProfileScope scope(kProfilePhase_Upload);
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_names[kVbo_ColoredVertices]);
+  GLsizeiptr size = patch->rail_vertex_count * sizeof(glm::vec3);
+  GLintptr offset = patch->first_rail_vertex * sizeof(glm::vec3);
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, patch->left_rail_positions);
+  offset += scene.left_rail.mesh->vl1p1c.count * sizeof(glm::vec3);
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, patch->right_rail_positions);
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_names[kVbo_TexturedVertices]);
+  size = patch->crosstie_vertex_count * sizeof(glm::vec3);
+  offset = patch->first_crosstie_vertex * sizeof(glm::vec3);
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, patch->crosstie_positions);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Edits the track with the spline files that have been modified, if any.
+static void UpdateTrackEdits() {
+  std::int64_t start_nsec = ProfileNowNsec();
+
+  int is_changed;
+  TrackPatch patch;
+  Status status = PollTrackEditor(&track_editor, &is_changed, &patch);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to update the track from its splines.\n");
+    return;
+  }
+  if (!is_changed) {
+    return;
+  }
+
+  UploadTrackPatch(&patch);
+
+  std::size_t last_index = scene.camspl.mesh->vl1p1t1n1b.count - 1;
+  if (camera_path_index > last_index) {
+    camera_path_index = last_index;
+  }
+
+  if (config.is_verbose) {
+    std::printf("Updated the track in %.3f ms.\n",
+                (ProfileNowNsec() - start_nsec) / 1e6);
+  }
+
+  // The ride may not be over anymore, and must be drawn again even if idle.
+  UpdateCamera();
+  glutPostRedisplay();
+  UpdateIdleFunc();
+}
+
+// Polls the spline files of a watched track at a low rate, independently of
+// the idle callback, so that a paused or finished ride keeps idling.
+static void OnTrackWatchTimer(int value) {
+  UpdateTrackEdits();
+  glutTimerFunc(TRACK_WATCH_PERIOD_MSEC, OnTrackWatchTimer, value);
+}
+
+// State of the startup tasks.
+struct Startup {
+  const char *texture_filepaths[kTexture__Count];
+  GLfloat anisotropy_degree;
+  TextureLoader texture_loader;
+  ShaderProgBuilder shader_prog_builder;
+  SceneConfig scene_cfg;
+};
+
+static Status BeginTexturesTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  return BeginTextureLoads(startup->texture_filepaths, kTexture__Count,
+                           startup->anisotropy_degree,
+                           config.texture_compression,
+                           config.texture_cache_dir, &worker_pool,
+                           texture_layers, &startup->texture_loader);
+}
+
+static Status UploadTextureTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  UploadDecodedTexture(&startup->texture_loader);
+  return kStatus_Ok;
+}
+
+static Status FinishTexturesTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  return FinishTextureLoads(&startup->texture_loader);
+}
+
+static Status BeginShadersTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  ProfileScope scope(kProfilePhase_Shaders);
+  return BeginShaderProgs(kShaderFilepaths, kVertexFormat__Count,
+                          config.shader_cache_dir,
+                          &startup->shader_prog_builder);
+}
+
+static Status FinishShadersTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  ProfileScope scope(kProfilePhase_Shaders);
+  return FinishShaderProgs(&startup->shader_prog_builder, program_names);
+}
+
+static Status MakeTrackTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  return MakeSceneTrack(&startup->scene_cfg, &scene);
+}
+
+static Status MakeSceneryTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+  MakeSceneScenery(&startup->scene_cfg, &scene);
+  return kStatus_Ok;
+}
+
+static Status UploadCrosstiesTask(void *) {
+  // The crossties of a track streamed in batches are uploaded with its rails.
+  if (!IsTrackStreamed()) {
+    UploadCrossties();
+  }
+  return kStatus_Ok;
+}
+
+static Status UploadSceneryTask(void *) {
+  UploadScenery();
+  return kStatus_Ok;
+}
+
+/*
+Input Parameters:
+- window_size: zero keeps every chunk once it has been uploaded
+- initial_chunk_count: chunks that are uploaded before returning
+*/
+static Status StartTrackStream(Startup *startup, uint chunk_size,
+                               uint window_size, uint initial_chunk_count) {
+  assert(startup);
+
+  GLuint colored_prog = program_names[kVertexFormat_Colored];
+  GLuint textured_prog = program_names[kVertexFormat_Textured];
+
+  TrackStreamConfig cfg;
+  cfg.chunk_size = chunk_size;
+  cfg.window_size = window_size;
+  cfg.initial_chunk_count = initial_chunk_count;
+  cfg.upload_budget_nsec =
+      (std::int64_t)(config.track_stream_upload_budget_msec * 1e6);
+  cfg.scene_cfg = &startup->scene_cfg;
+  cfg.camspl = &scene.camspl.mesh->vl1p1t1n1b;
+  cfg.piece_vertex_counts = scene.piece_vertex_counts;
+  cfg.piece_count = scene.piece_count;
+  cfg.pool = &worker_pool;
+  cfg.rail_position_loc = glGetAttribLocation(colored_prog, "vert_position");
+  cfg.rail_color_loc = glGetAttribLocation(colored_prog, "vert_color");
+  cfg.crosstie_position_loc =
+      glGetAttribLocation(textured_prog, "vert_position");
+  cfg.crosstie_tex_coord_loc =
+      glGetAttribLocation(textured_prog, "vert_tex_coord");
+
+  ProfileScope scope(kProfilePhase_Upload);
+  return InitTrackStream(&cfg, &track_stream);
+}
+
+static Status UploadRailsTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+
+  if (!IsTrackStreamed()) {
+    UploadRails();
+    return kStatus_Ok;
+  }
+
+  // The track has too many vertices for one batch, so it is uploaded in
+  // chunks of at most a batch each, all before rendering starts. Neighboring
+  // chunks share a camera path vertex.
+  uint chunk_size = config.max_track_batch_vertex_count / 16 - 1;
+  return StartTrackStream(startup, chunk_size, 0,
+                          std::numeric_limits<uint>::max());
+}
+
+static Status InitTrackStreamTask(void *arg) {
+  Startup *startup = (Startup *)arg;
+
+  // A progressive startup draws the first chunk as soon as it is uploaded.
+  uint initial_chunk_count =
+      config.is_startup_progressive ? 1 : config.track_stream_window_size;
+  return StartTrackStream(startup, config.track_stream_chunk_size,
+                          config.track_stream_window_size,
+                          initial_chunk_count);
+}
+
+/*
+Startup as a task graph. Tasks that use the OpenGL context run on the main
+thread, in the order they are added when several are ready. The track and
+scenery are made on the worker threads while the main thread makes the
+textures and compiles the shaders, and each part of the scene is uploaded as
+soon as it and the shaders are ready.
+*/
+static void AddStartupTasks(Startup *startup, TaskGraph *graph) {
+  assert(startup);
+  assert(graph);
+
+  uint begin_textures = AddGraphTask(graph, "begin_textures",
+                                     kTaskAffinity_Main, BeginTexturesTask,
+                                     startup);
+  uint begin_shaders = AddGraphTask(graph, "begin_shaders", kTaskAffinity_Main,
+                                    BeginShadersTask, startup);
+  uint make_track = AddGraphTask(graph, "make_track", kTaskAffinity_Worker,
+                                 MakeTrackTask, startup);
+  uint make_scenery = AddGraphTask(graph, "make_scenery",
+                                   kTaskAffinity_Worker, MakeSceneryTask,
+                                   startup);
+  uint finish_shaders = AddGraphTask(graph, "finish_shaders",
+                                     kTaskAffinity_Main, FinishShadersTask,
+                                     startup);
+  uint upload_scenery = AddGraphTask(graph, "upload_scenery",
+                                     kTaskAffinity_Main, UploadSceneryTask,
+                                     NULL);
+  // A streamed track is uploaded a window of chunks at a time instead, by a
+  // single task.
+  std::vector<uint> upload_track;
+  if (IsTrackStreamConfigured()) {
+    upload_track.push_back(AddGraphTask(graph, "init_track_stream",
+                                        kTaskAffinity_Main,
+                                        InitTrackStreamTask, startup));
+  } else {
+    upload_track.push_back(AddGraphTask(graph, "upload_rails",
+                                        kTaskAffinity_Main, UploadRailsTask,
+                                        startup));
+    upload_track.push_back(AddGraphTask(graph, "upload_crossties",
+                                        kTaskAffinity_Main,
+                                        UploadCrosstiesTask, NULL));
+  }
+  // Each uploads whichever texture is decoded next, so the main thread
+  // uploads textures while the worker threads make the track. They are added
+  // last, so that the other tasks of the main thread run first once ready.
+  uint upload_textures[kTexture__Count];
+  for (uint i = 0; i < kTexture__Count; ++i) {
+    upload_textures[i] = AddGraphTask(graph, "upload_texture",
+                                      kTaskAffinity_Main, UploadTextureTask,
+                                      startup);
+  }
+  uint finish_textures = AddGraphTask(graph, "finish_textures",
+                                      kTaskAffinity_Main, FinishTexturesTask,
+                                      startup);
+
+  AddGraphDependency(graph, finish_shaders, begin_shaders);
+  // Uploads set up VAOs with the attribute locations of the programs.
+  AddGraphDependency(graph, upload_scenery, make_scenery);
+  AddGraphDependency(graph, upload_scenery, finish_shaders);
+  for (uint upload : upload_track) {
+    AddGraphDependency(graph, upload, make_track);
+    AddGraphDependency(graph, upload, finish_shaders);
+  }
+  for (uint i = 0; i < kTexture__Count; ++i) {
+    AddGraphDependency(graph, upload_textures[i], begin_textures);
+    AddGraphDependency(graph, finish_textures, upload_textures[i]);
+  }
+}
+
+/*
+Frees what startup has set up by the time it fails after the thread pool has
+started, so that no thread is left joinable when `main` returns. Captures and
+outputs that were not set up are zero-initialized, and freeing them does
+nothing.
+*/
+static int FailStartup() {
+  FreeCapture(&shm_capture);
+  CloseShmRing(&shm_ring);
+  FreeCapture(&video_capture);
+  CloseVideoWriter(&video_writer);
+  FreeCapture(&capture);
+  FreeThreadPool(&worker_pool);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+  std::int64_t startup_start_nsec = ProfileNowNsec();
+
+  DefaultInit(&config);
+  Status status = ParseConfig(argc, argv, &config);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to parse config.\n");
+    return EXIT_FAILURE;
+  }
+
+  OffscreenContext offscreen_ctx;
+  Framebuffer offscreen_fb;
+  if (config.is_benchmark) {
+    status = MakeOffscreenContext(&offscreen_ctx);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to make offscreen context.\n");
+      return EXIT_FAILURE;
+    }
+  } else {
+    ConfigureGlut(argc, argv, window_w, window_h, 0, 0, kWindowTitlePrefix);
+  }
+
+  if (config.is_verbose) {
+    std::printf("OpenGL Info: \n");
+    std::printf("  Version: %s\n", glGetString(GL_VERSION));
+    std::printf("  Renderer: %s\n", glGetString(GL_RENDERER));
+    std::printf("  Shading Language Version: %s\n",
+                glGetString(GL_SHADING_LANGUAGE_VERSION));
+  }
+
+#ifdef linux
+  GLenum result = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLEW fails to initialize GLX without a display server, but the OpenGL
+  // functions needed by an EGL context have been loaded by then.
+  if (config.is_benchmark && result == GLEW_ERROR_NO_GLX_DISPLAY) {
+    result = GLEW_OK;
+  }
+#endif
+  if (result != GLEW_OK) {
+    std::fprintf(stderr, "glewInit failed: %s", glewGetErrorString(result));
+    return EXIT_FAILURE;
+  }
+#endif
+
+  if (config.is_profiling || config.is_benchmark) {
+    EnableProfiler(MAX_PROFILE_EVENT_COUNT);
+  }
+
+  if (config.is_benchmark) {
+    status = MakeFramebuffer(window_w, window_h, &offscreen_fb);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to make offscreen framebuffer.\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Textures are decoded on the worker threads while the scene is made and the
+  // shaders are compiled, and uploaded as soon as each is decoded.
+  InitThreadPool(config.worker_thread_count, &worker_pool);
+
+  GLfloat max_anisotropy_degree;
+  glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy_degree);
+
+  if (config.is_verbose) {
+    std::printf("Maximum degree of anisotropy: %f\n", max_anisotropy_degree);
+  }
+
+  const char *texture_filepaths[kTexture__Count];
+  texture_filepaths[kTexture_Ground] = config.ground_texture_filepath;
+  texture_filepaths[kTexture_Sky] = config.sky_texture_filepath;
+  texture_filepaths[kTexture_Crossties] = config.crossties_texture_filepath;
+
+  if (config.texture_cache_dir[0] != '\0') {
+    status = InitCacheDir(config.texture_cache_dir);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to initialize texture cache.\n");
+      FreeThreadPool(&worker_pool);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!IsTextureCompressionSupported(config.texture_compression)) {
+    if (config.is_verbose) {
+      std::printf(
+          "Texture compression %s is unsupported. Textures are "
+          "uncompressed.\n",
+          String(config.texture_compression));
+    }
+    config.texture_compression = kTextureCompression_None;
+  }
+
+  if (config.shader_cache_dir[0] != '\0') {
+    status = InitCacheDir(config.shader_cache_dir);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to initialize program cache.\n");
+      FreeThreadPool(&worker_pool);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (config.track_cache_dir[0] != '\0') {
+    status = InitCacheDir(config.track_cache_dir);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to initialize track cache.\n");
+      FreeThreadPool(&worker_pool);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /************************************
+   * Setup OpenGL state.
+   ************************************/
+
+  glClearColor(0, 0, 0, 0);
+  glEnable(GL_DEPTH_TEST);
+
+  Startup startup;
+  std::memcpy(startup.texture_filepaths, texture_filepaths,
+              sizeof(texture_filepaths));
+  startup.anisotropy_degree = max_anisotropy_degree * 0.5f;
+  InitSceneConfig(&config, &startup.scene_cfg);
+  InitScene(&startup.scene_cfg, &scene);
+
+  TaskGraph startup_graph;
+  AddStartupTasks(&startup, &startup_graph);
+  status = RunTaskGraph(&worker_pool, &startup_graph);
+  if (config.is_verbose) {
+    PrintTaskGraphTimes(&startup_graph);
+  }
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to start up.\n");
+    FreeThreadPool(&worker_pool);
+    return EXIT_FAILURE;
+  }
+
+  if (config.is_verbose && config.shader_cache_dir[0] != '\0') {
+    std::printf("Loaded %u of %d shader programs from the program cache.\n",
+                startup.shader_prog_builder.cache_hit_count,
+                kVertexFormat__Count);
+  }
+
+  if (config.is_verbose && config.texture_cache_dir[0] != '\0') {
+    std::printf("Loaded %u of %d textures from the texture cache.\n",
+                startup.texture_loader.cache_hit_count.load(),
+                kTexture__Count);
+  }
+
+  if (config.is_verbose) {
+    PrintArenaStats("Scene", &scene.arena);
+    PrintArenaStats("Model", &scene.model_arena);
+  }
 
   FreeModelVertices(&scene);
 
+  if (config.is_track_watched) {
+    if (IsTrackStreamed()) {
+      std::fprintf(stderr,
+                   "The spline files of a streamed track are not watched.\n");
+      config.is_track_watched = 0;
+    } else if (config.max_camera_path_vertex_count != 0) {
+      // An edit of one spline would move vertices of the budget between all
+      // of them.
+      std::fprintf(stderr,
+                   "The spline files of a track tessellated to a vertex "
+                   "budget are not watched.\n");
+      config.is_track_watched = 0;
+    } else {
+      status = InitTrackEditor(&startup.scene_cfg, &scene, &track_editor);
+      if (status != kStatus_Ok) {
+        std::fprintf(stderr, "Failed to watch spline files.\n");
+        return FailStartup();
+      }
+    }
+  }
+
+  InitGpuTimers(&gpu_timers);
+
+  // Captured frames are bottom row first. The flag is global to stb, so it is
+  // set once here, before any capture thread writes a JPEG.
+  stbi_flip_vertically_on_write(1);
+
+  CaptureConfig capture_cfg;
+  capture_cfg.thread_count = config.capture_thread_count;
+  capture_cfg.queue_policy = config.capture_queue_policy;
+  capture_cfg.encode = EncodeScreenshot;
+  capture_cfg.user_data = &config;
+  status = InitCapture(&capture_cfg, &capture);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to initialize capture.\n");
+    return FailStartup();
+  }
+
+  if (IsVideoStreamed()) {
+    float fps = config.target_fps > 0 ? config.target_fps : VIDEO_DEFAULT_FPS;
+    status = OpenVideoWriter(config.video_output_filepath, config.video_format,
+                             fps, &video_writer);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to open video output.\n");
+      return FailStartup();
+    }
+
+    capture_cfg.thread_count = 1;
+    capture_cfg.encode = EncodeVideoFrame;
+    capture_cfg.user_data = &video_writer;
+    status = InitCapture(&capture_cfg, &video_capture);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to initialize video capture.\n");
+      return FailStartup();
+    }
+  }
+
+  if (IsShmPublished()) {
+    status = CreateShmRing(config.shm_output_name, config.shm_slot_count,
+                           SHM_MAX_FRAME_SIZE, &shm_ring);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to create shared memory frame ring.\n");
+      return FailStartup();
+    }
+
+    capture_cfg.thread_count = 1;
+    capture_cfg.encode = PublishFrame;
+    capture_cfg.user_data = &shm_ring;
+    status = InitCapture(&capture_cfg, &shm_capture);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to initialize shared memory capture.\n");
+      return FailStartup();
+    }
+  }
+
+  if (config.is_benchmark) {
+    status = RunBenchmark(ProfileNowNsec() - startup_start_nsec);
+    if (status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to run benchmark.\n");
+      exit_status = EXIT_FAILURE;
+    }
+
+    OnExit();
+
+    FreeFramebuffer(&offscreen_fb);
+    FreeOffscreenContext(&offscreen_ctx);
+
+    return exit_status;
+  }
+
+  InitFrameScheduler(config.target_fps, &frame_scheduler);
+  UpdateIdleFunc();
+  if (IsTrackWatched()) {
+    glutTimerFunc(TRACK_WATCH_PERIOD_MSEC, OnTrackWatchTimer, 0);
+  }
+
   glutMainLoop();
+
+  return exit_status;
 }
@@ -4,14 +4,27 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "capture.hpp"
 #include "opengl.hpp"
 #include "shader.hpp"
+#include "texture_loader.hpp"
 #include "types.hpp"
+#include "video.hpp"
 
 #define BUFFER_OFFSET(offset) ((GLvoid*)(offset))
 #define WINDOW_TITLE_UPDATE_PERIOD_MSEC 1000
+// Period at which the spline files of a watched track are polled.
+#define TRACK_WATCH_PERIOD_MSEC 250
 #define FILEPATH_BUFFER_SIZE 4096
 #define FILENAME_BUFFER_SIZE 255
+#define MAX_PROFILE_EVENT_COUNT (1 << 22)
+#define VIDEO_DEFAULT_FPS 60
+// Largest frame that fits in a shared memory slot: 4K RGBA.
+#define SHM_MAX_FRAME_SIZE (3840 * 2160 * 4)
+// The rails of a chunk or batch of the track, 16 vertices per camera path
+// vertex, must fit 32-bit indices.
+#define MAX_TRACK_STREAM_CHUNK_SIZE ((1u << 28) - 1)
+#define MAX_TRACK_BATCH_VERTEX_COUNT (1u << 28)
 
 const char* kUsageMessage =
     "usage: %s [options...] <track-file> <ground-texture> <sky-texture> "
@@ -19,6 +32,15 @@ const char* kUsageMessage =
 
 const char* kWindowTitlePrefix = "rcoaster";
 
+enum ScreenshotFormat {
+  kScreenshotFormat_Jpg,
+  kScreenshotFormat_Qoi,
+  kScreenshotFormat__Count
+};
+
+const char* const kScreenshotFormatStrings[kScreenshotFormat__Count] = {"jpg",
+                                                                        "qoi"};
+
 struct ViewFrustum {
   float fov_y;
   float near_z;
@@ -36,9 +58,89 @@ struct Config {
   // Camera speed in spline segments per second.
   float camera_speed;
   float max_spline_segment_len;
+  // Control points that the curve of their spline can stay this close to
+  // without are removed as the splines are loaded. Zero keeps every one.
+  float spline_simplify_tolerance;
+  // If nonzero, the track is tessellated into at most this many camera path
+  // vertices, placed where the splines curve most, instead of by
+  // `max_spline_segment_len`.
+  uint max_camera_path_vertex_count;
 
   char screenshot_filename_prefix[FILENAME_BUFFER_SIZE];
   char screenshot_directory_path[FILEPATH_BUFFER_SIZE];
+  ScreenshotFormat screenshot_format;
+
+  // High-resolution screenshots are `hires_screenshot_scale` times the window
+  // size, rendered in tiles of up to `hires_screenshot_tile_size` pixels.
+  uint hires_screenshot_scale;
+  uint hires_screenshot_supersample_factor;
+  uint hires_screenshot_tile_size;
+
+  // Zero disables the frame rate limit.
+  float target_fps;
+  // Stop rendering while the window is hidden or the ride is paused or over.
+  int is_adaptive_idle;
+
+  // Threads that load textures. Zero uses every hardware thread but one.
+  uint worker_thread_count;
+  // Decoded textures are cached in this directory if not empty.
+  char texture_cache_dir[FILEPATH_BUFFER_SIZE];
+  // Falls back to no compression if unsupported.
+  TextureCompression texture_compression;
+  // Linked shader programs are cached in this directory if not empty.
+  char shader_cache_dir[FILEPATH_BUFFER_SIZE];
+  char track_cache_dir[FILEPATH_BUFFER_SIZE];
+  // Chunks of the track that are resident at once. Zero keeps the whole track
+  // resident.
+  uint track_stream_window_size;
+  // Camera path vertices per streamed chunk of the track.
+  uint track_stream_chunk_size;
+  // Time per frame spent uploading streamed chunks of the track. Zero uploads
+  // every chunk that has been made.
+  float track_stream_upload_budget_msec;
+  // Starts rendering once the first chunk of the track has been uploaded, and
+  // streams the rest of the track while rendering.
+  int is_startup_progressive;
+  // Tracks whose rails have more vertices than this are streamed in chunks of
+  // at most this many rail vertices, each of which is kept once uploaded.
+  uint max_track_batch_vertex_count;
+  // Reloads spline files of the track as they are modified while the ride is
+  // running, and updates only the parts of the track that they changed.
+  int is_track_watched;
+
+  // Backs the memory that the scene is made in with transparent huge pages.
+  int is_arena_huge_page_backed;
+
+  // Zero uses every hardware thread but one.
+  uint capture_thread_count;
+  CaptureQueuePolicy capture_queue_policy;
+
+  // Recorded video is streamed to this file, named pipe or `stdout` ("-")
+  // instead of being saved as screenshots if not empty.
+  char video_output_filepath[FILEPATH_BUFFER_SIZE];
+  VideoFormat video_format;
+
+  // Recorded video is published to the shared memory frame ring of this POSIX
+  // shared memory object name if not empty.
+  char shm_output_name[FILENAME_BUFFER_SIZE];
+  uint shm_slot_count;
+
+  int is_profiling;
+  // Profiles are written to `<prefix>.json` and `<prefix>.csv`.
+  char profile_output_prefix[FILEPATH_BUFFER_SIZE];
+
+  // Renders offscreen without a window and reports performance statistics.
+  int is_benchmark;
+  // Zero renders one full lap.
+  uint benchmark_frame_count;
+  // Camera path vertices advanced per frame.
+  uint benchmark_camera_path_step;
+  // The report is written to `stdout` if empty.
+  char benchmark_report_filepath[FILEPATH_BUFFER_SIZE];
+  // Captures every benchmark frame as if video were being recorded.
+  int benchmark_record_video;
+  // Takes a high-resolution screenshot of the last benchmark frame.
+  int benchmark_hires_screenshot;
 
   int is_verbose;
 };
@@ -102,9 +204,6 @@ enum Vbo {
   kVbo__Count
 };
 
-const char* const kVertexFormatStrings[kVertexFormat__Count]{"textured",
-                                                             "colored"};
-
 const char* const kShaderFilepaths[kVertexFormat__Count][kShaderType__Count] = {
     {"shaders/textured.vert.glsl", "shaders/textured.frag.glsl"},
     {"shaders/colored.vert.glsl", "shaders/colored.frag.glsl"}};
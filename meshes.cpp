@@ -1,10 +1,14 @@
 #include "meshes.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <glm/glm.hpp>
+#include <queue>
 #include <vector>
 
+#include "profiler.hpp"
+
 constexpr float kTension = 0.5;
 const glm::mat4x4 kCatmullRomBasis(-kTension, 2 - kTension, kTension - 2,
                                    kTension, 2 * kTension, kTension - 3,
@@ -25,6 +29,40 @@ static glm::vec3 CatmullRomSplineTangent(float u, const glm::mat4x3 *control) {
   return *control * kCatmullRomBasis * parameters;
 }
 
+static glm::mat4x3 CatmullRomSegmentControl(const glm::vec3 *control_points,
+                                             uint segment) {
+  assert(control_points);
+
+  const glm::vec3 *cp = control_points + segment;
+  // clang-format off
+  return glm::mat4x3(
+    cp[0].x, cp[0].y, cp[0].z,
+    cp[1].x, cp[1].y, cp[1].z,
+    cp[2].x, cp[2].y, cp[2].z,
+    cp[3].x, cp[3].y, cp[3].z
+  );
+  // clang-format on
+}
+
+// Appends the vertices of the curve between `u0` and `u1`, at positions `p0`
+// and `p1`, as one line segment.
+static void AppendLineSegment(float u0, float u1, const glm::vec3 *p0,
+                              const glm::vec3 *p1, const glm::mat4x3 *control,
+                              std::vector<glm::vec3> *positions,
+                              std::vector<glm::vec3> *tangents) {
+  assert(p0);
+  assert(p1);
+  assert(control);
+  assert(positions);
+  assert(tangents);
+
+  positions->push_back(*p0);
+  positions->push_back(*p1);
+
+  tangents->push_back(glm::normalize(CatmullRomSplineTangent(u0, control)));
+  tangents->push_back(glm::normalize(CatmullRomSplineTangent(u1, control)));
+}
+
 static void Subdivide(float u0, float u1, float max_segment_len,
                       const glm::mat4x3 *control,
                       std::vector<glm::vec3> *positions,
@@ -47,25 +85,16 @@ static void Subdivide(float u0, float u1, float max_segment_len,
     Subdivide(u0, umid, max_segment_len, control, positions, tangents);
     Subdivide(umid, u1, max_segment_len, control, positions, tangents);
   } else {
-    positions->push_back(p0);
-    positions->push_back(p1);
-
-    glm::vec3 t0 = CatmullRomSplineTangent(u0, control);
-    glm::vec3 t1 = CatmullRomSplineTangent(u1, control);
-
-    glm::vec3 t0_norm = glm::normalize(t0);
-    glm::vec3 t1_norm = glm::normalize(t1);
-
-    tangents->push_back(t0_norm);
-    tangents->push_back(t1_norm);
+    AppendLineSegment(u0, u1, &p0, &p1, control, positions, tangents);
   }
 }
 
 void EvalCatmullRomSpline(const glm::vec3 *control_points,
                           uint control_point_count, float max_segment_len,
-                          glm::vec3 **positions, glm::vec3 **tangents,
-                          uint *vertex_count) {
+                          Arena *arena, glm::vec3 **positions,
+                          glm::vec3 **tangents, std::size_t *vertex_count) {
   assert(control_points);
+  assert(arena);
   assert(positions);
   assert(tangents);
   assert(vertex_count);
@@ -77,73 +106,275 @@ void EvalCatmullRomSpline(const glm::vec3 *control_points,
 
   std::vector<glm::vec3> positions_vec;
   std::vector<glm::vec3> tangents_vec;
-
-  const glm::vec3 *cp = control_points;
-  for (uint i = 1; i + 2 < control_point_count; ++i) {
-    // clang-format off
-    glm::mat4x3 control(
-      cp[i - 1].x, cp[i - 1].y, cp[i - 1].z,
-      cp[i].x, cp[i].y, cp[i].z,
-      cp[i + 1].x, cp[i + 1].y, cp[i + 1].z,
-      cp[i + 2].x, cp[i + 2].y, cp[i + 2].z
-    );
-    // clang-format on
-    Subdivide(0, 1, max_segment_len, &control, &positions_vec, &tangents_vec);
+  if (control_point_count > 3) {
+    AppendCatmullRomSegments(control_points, 0, control_point_count - 3,
+                             max_segment_len, &positions_vec, &tangents_vec);
   }
 
   assert(positions_vec.size() == tangents_vec.size());
 
   *vertex_count = positions_vec.size();
-  *positions = new glm::vec3[*vertex_count];
-  *tangents = new glm::vec3[*vertex_count];
+  *positions = ArenaAllocArray<glm::vec3>(arena, *vertex_count);
+  *tangents = ArenaAllocArray<glm::vec3>(arena, *vertex_count);
 
-  for (uint i = 0; i < *vertex_count; ++i) {
+  for (std::size_t i = 0; i < *vertex_count; ++i) {
     (*positions)[i] = positions_vec[i];
     (*tangents)[i] = tangents_vec[i];
   }
 }
 
-void CalcCameraOrientation(const glm::vec3 *tangents, uint vertex_count,
+void AppendCatmullRomSegments(const glm::vec3 *control_points, uint begin,
+                              uint end, float max_segment_len,
+                              std::vector<glm::vec3> *positions,
+                              std::vector<glm::vec3> *tangents) {
+  assert(control_points);
+  assert(positions);
+  assert(tangents);
+
+  for (uint i = begin; i < end; ++i) {
+    glm::mat4x3 control = CatmullRomSegmentControl(control_points, i);
+    Subdivide(0, 1, max_segment_len, &control, positions, tangents);
+  }
+}
+
+glm::vec3 CatmullRomSegmentPosition(const glm::vec3 *control_points,
+                                    uint segment, float u) {
+  assert(control_points);
+
+  glm::mat4x3 control = CatmullRomSegmentControl(control_points, segment);
+  return CatmullRomSplinePosition(u, &control);
+}
+
+/*
+Distance of the curve between `u0` and `u1` from the line segment that
+approximates it, sampled at the quarter points, so that an S-shaped curve whose
+midpoint lies on the line segment is not mistaken for a straight one.
+*/
+static float ChordError(float u0, float u1, const glm::mat4x3 *control) {
+  assert(control);
+
+  glm::vec3 p0 = CatmullRomSplinePosition(u0, control);
+  glm::vec3 chord = CatmullRomSplinePosition(u1, control) - p0;
+  float chord_len_sq = glm::dot(chord, chord);
+
+  float error = 0;
+  for (uint i = 1; i < 4; ++i) {
+    float u = u0 + (u1 - u0) * (i * 0.25f);
+    glm::vec3 d = CatmullRomSplinePosition(u, control) - p0;
+    if (chord_len_sq > 0) {
+      float t = glm::clamp(glm::dot(d, chord) / chord_len_sq, 0.0f, 1.0f);
+      d -= t * chord;
+    }
+    error = std::max(error, glm::length(d));
+  }
+  return error;
+}
+
+// A parameter interval of a segment of one of the splines being tessellated,
+// which is approximated by one line segment.
+struct SplineInterval {
+  float error;
+  uint spline;
+  uint segment;
+  float u0;
+  float u1;
+};
+
+struct IsLessSplineIntervalError {
+  bool operator()(const SplineInterval &a, const SplineInterval &b) const {
+    return a.error < b.error;
+  }
+};
+
+static bool IsBeforeSplineInterval(const SplineInterval &a,
+                                   const SplineInterval &b) {
+  if (a.spline != b.spline) {
+    return a.spline < b.spline;
+  }
+  if (a.segment != b.segment) {
+    return a.segment < b.segment;
+  }
+  return a.u0 < b.u0;
+}
+
+void EvalCatmullRomSplinesWithBudget(const glm::vec3 *const *control_points,
+                                     const uint *control_point_counts,
+                                     uint spline_count,
+                                     std::size_t max_vertex_count,
+                                     Arena *arena, glm::vec3 **positions,
+                                     glm::vec3 **tangents,
+                                     std::size_t *vertex_counts,
+                                     float *max_error) {
+  // Intervals this accurate, or this short, are not split further.
+  static constexpr float kMinError = 0.00001;
+  static constexpr float kMinIntervalLen = 0.00001;
+
+  assert(control_points);
+  assert(control_point_counts);
+  assert(arena);
+  assert(positions);
+  assert(tangents);
+  assert(vertex_counts);
+  assert(max_error);
+
+  std::vector<glm::mat4x3> controls;
+  // Index in `controls` of the first segment of each spline.
+  std::vector<std::size_t> first_controls(spline_count);
+  for (uint i = 0; i < spline_count; ++i) {
+    assert(control_points[i] || control_point_counts[i] == 0);
+
+    first_controls[i] = controls.size();
+    for (uint j = 3; j < control_point_counts[i]; ++j) {
+      controls.push_back(CatmullRomSegmentControl(control_points[i], j - 3));
+    }
+  }
+
+  // Every segment is at least one line segment, of two vertices.
+  std::size_t vertex_count = 2 * controls.size();
+  assert(vertex_count <= max_vertex_count);
+
+  std::priority_queue<SplineInterval, std::vector<SplineInterval>,
+                      IsLessSplineIntervalError>
+      queue;
+  std::vector<SplineInterval> intervals;
+  for (uint i = 0; i < spline_count; ++i) {
+    uint segment_count = control_point_counts[i] > 3
+                             ? control_point_counts[i] - 3
+                             : 0;
+    for (uint j = 0; j < segment_count; ++j) {
+      const glm::mat4x3 *control = &controls[first_controls[i] + j];
+      queue.push({ChordError(0, 1, control), i, j, 0, 1});
+    }
+  }
+
+  // Splits the interval of largest error in half until the budget is spent.
+  while (!queue.empty() && vertex_count + 2 <= max_vertex_count &&
+         queue.top().error > kMinError) {
+    SplineInterval interval = queue.top();
+    queue.pop();
+    if (interval.u1 - interval.u0 < kMinIntervalLen) {
+      intervals.push_back(interval);
+      continue;
+    }
+
+    const glm::mat4x3 *control =
+        &controls[first_controls[interval.spline] + interval.segment];
+    float umid = (interval.u0 + interval.u1) * 0.5f;
+    queue.push({ChordError(interval.u0, umid, control), interval.spline,
+                interval.segment, interval.u0, umid});
+    queue.push({ChordError(umid, interval.u1, control), interval.spline,
+                interval.segment, umid, interval.u1});
+    vertex_count += 2;
+  }
+
+  *max_error = 0;
+  intervals.reserve(intervals.size() + queue.size());
+  while (!queue.empty()) {
+    intervals.push_back(queue.top());
+    queue.pop();
+  }
+  for (const SplineInterval &interval : intervals) {
+    *max_error = std::max(*max_error, interval.error);
+  }
+
+  std::sort(intervals.begin(), intervals.end(), IsBeforeSplineInterval);
+
+  std::vector<glm::vec3> positions_vec;
+  std::vector<glm::vec3> tangents_vec;
+  std::size_t k = 0;
+  for (uint i = 0; i < spline_count; ++i) {
+    positions_vec.clear();
+    tangents_vec.clear();
+    for (; k < intervals.size() && intervals[k].spline == i; ++k) {
+      const SplineInterval *interval = &intervals[k];
+      const glm::mat4x3 *control =
+          &controls[first_controls[i] + interval->segment];
+      glm::vec3 p0 = CatmullRomSplinePosition(interval->u0, control);
+      glm::vec3 p1 = CatmullRomSplinePosition(interval->u1, control);
+      AppendLineSegment(interval->u0, interval->u1, &p0, &p1, control,
+                        &positions_vec, &tangents_vec);
+    }
+
+    vertex_counts[i] = positions_vec.size();
+    positions[i] = ArenaAllocArray<glm::vec3>(arena, vertex_counts[i]);
+    tangents[i] = ArenaAllocArray<glm::vec3>(arena, vertex_counts[i]);
+    std::copy(positions_vec.begin(), positions_vec.end(), positions[i]);
+    std::copy(tangents_vec.begin(), tangents_vec.end(), tangents[i]);
+  }
+}
+
+void CalcCameraOrientation(const glm::vec3 *tangents, std::size_t vertex_count,
                            glm::vec3 *normals, glm::vec3 *binormals) {
+  CalcCameraOrientationFrom(tangents, vertex_count, 0, normals, binormals);
+}
+
+void CalcCameraOrientationFrom(const glm::vec3 *tangents,
+                               std::size_t vertex_count,
+                               std::size_t first_vertex, glm::vec3 *normals,
+                               glm::vec3 *binormals) {
   assert(tangents);
   assert(normals);
   assert(binormals);
   assert(vertex_count != 0);
+  assert(first_vertex <= vertex_count);
 
   // Initial binormal chosen arbitrarily.
   static const glm::vec3 kInitialBinormal = {0, 1, -0.5};
 
-  normals[0] = glm::normalize(glm::cross(tangents[0], kInitialBinormal));
-  binormals[0] = glm::normalize(glm::cross(tangents[0], normals[0]));
+  if (first_vertex == 0) {
+    normals[0] = glm::normalize(glm::cross(tangents[0], kInitialBinormal));
+    binormals[0] = glm::normalize(glm::cross(tangents[0], normals[0]));
+    first_vertex = 1;
+  }
 
-  for (uint i = 1; i < vertex_count; ++i) {
+  for (std::size_t i = first_vertex; i < vertex_count; ++i) {
     normals[i] = glm::normalize(glm::cross(binormals[i - 1], tangents[i]));
     binormals[i] = glm::normalize(glm::cross(tangents[i], normals[i]));
   }
 }
 
 void MakeCameraPath(const glm::vec3 *control_points, uint control_point_count,
-                    float max_segment_len, VertexList1P1T1N1B *vertices) {
+                    float max_segment_len, Arena *arena,
+                    VertexList1P1T1N1B *vertices) {
 #ifndef NDEBUG
   static constexpr float kTolerance = 0.00001;
 #endif
 
   assert(control_points);
   assert(max_segment_len + kTolerance > 0);
+  assert(arena);
   assert(vertices);
 
-  EvalCatmullRomSpline(control_points, control_point_count, max_segment_len,
-                       &vertices->positions, &vertices->tangents,
-                       &vertices->count);
+  {
+    ProfileScope scope(kProfilePhase_SplineEval);
+    EvalCatmullRomSpline(control_points, control_point_count, max_segment_len,
+                         arena, &vertices->positions, &vertices->tangents,
+                         &vertices->count);
+  }
 
-  vertices->normals = new glm::vec3[vertices->count];
-  vertices->binormals = new glm::vec3[vertices->count];
+  ProfileScope scope(kProfilePhase_Frames);
+  vertices->normals = ArenaAllocArray<glm::vec3>(arena, vertices->count);
+  vertices->binormals = ArenaAllocArray<glm::vec3>(arena, vertices->count);
   CalcCameraOrientation(vertices->tangents, vertices->count, vertices->normals,
                         vertices->binormals);
 }
 
+VertexList1P1T1N1B SliceCameraPath(const VertexList1P1T1N1B *vertices,
+                                   std::size_t begin, std::size_t end) {
+  assert(vertices);
+  assert(begin <= end && end <= vertices->count);
+
+  VertexList1P1T1N1B slice;
+  slice.positions = vertices->positions + begin;
+  slice.tangents = vertices->tangents + begin;
+  slice.normals = vertices->normals + begin;
+  slice.binormals = vertices->binormals + begin;
+  slice.count = end - begin;
+  return slice;
+}
+
 void MakeAxisAlignedXzSquarePlane(float side_len, uint tex_repeat_count,
-                                  Mesh *mesh) {
+                                  Arena *arena, Mesh *mesh) {
   enum Corner { kBl, kTl, kTr, kBr, kCornerCount };
 
   static constexpr uint kVertexCountPerTriangle = 3;
@@ -152,12 +383,13 @@ void MakeAxisAlignedXzSquarePlane(float side_len, uint tex_repeat_count,
 
   assert(side_len > 0);
   assert(tex_repeat_count == 1 || tex_repeat_count % 2 == 0);
+  assert(arena);
   assert(mesh);
 
   mesh->vertex_list_type = kVertexListType_1P1UV;
   mesh->vl1p1uv.count = kCornerCount;
-  mesh->vl1p1uv.positions = new glm::vec3[kCornerCount];
-  mesh->vl1p1uv.uv = new glm::vec2[kCornerCount];
+  mesh->vl1p1uv.positions = ArenaAllocArray<glm::vec3>(arena, kCornerCount);
+  mesh->vl1p1uv.uv = ArenaAllocArray<glm::vec2>(arena, kCornerCount);
 
   glm::vec3 *pos = mesh->vl1p1uv.positions;
   pos[kBl] = {-side_len, 0, -side_len};
@@ -175,7 +407,7 @@ void MakeAxisAlignedXzSquarePlane(float side_len, uint tex_repeat_count,
   uv[kBr] = {tex_repeat_count, 0};
 
   mesh->index_count = kIndexCount;
-  mesh->indices = new uint[kIndexCount];
+  mesh->indices = ArenaAllocArray<uint>(arena, kIndexCount);
 
   uint *indices = mesh->indices;
   indices[0] = kBl;
@@ -186,7 +418,8 @@ void MakeAxisAlignedXzSquarePlane(float side_len, uint tex_repeat_count,
   indices[5] = kTl;
 }
 
-void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Mesh *mesh) {
+void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Arena *arena,
+                         Mesh *mesh) {
   enum CubeCorner {
     kFbl,
     kFtl,
@@ -212,12 +445,13 @@ void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Mesh *mesh) {
 
   assert(side_len > 0);
   assert(tex_repeat_count == 1 || tex_repeat_count % 2 == 0);
+  assert(arena);
   assert(mesh);
 
   mesh->vertex_list_type = kVertexListType_1P1UV;
   mesh->vl1p1uv.count = kVertexCount;
-  mesh->vl1p1uv.positions = new glm::vec3[kVertexCount];
-  mesh->vl1p1uv.uv = new glm::vec2[kVertexCount];
+  mesh->vl1p1uv.positions = ArenaAllocArray<glm::vec3>(arena, kVertexCount);
+  mesh->vl1p1uv.uv = ArenaAllocArray<glm::vec2>(arena, kVertexCount);
 
   glm::vec3 uniq_pos[kCubeCornerCount];
   uniq_pos[kFbl] = {-0.5, -0.5, 0.5};
@@ -272,7 +506,7 @@ void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Mesh *mesh) {
   }
 
   mesh->index_count = kIndexCount;
-  mesh->indices = new uint[kIndexCount];
+  mesh->indices = ArenaAllocArray<uint>(arena, kIndexCount);
 
   uint *indices = mesh->indices;
   uint idx = 0;
@@ -290,7 +524,7 @@ void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Mesh *mesh) {
 void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
                const glm::vec4 *color, float head_w, float head_h, float web_w,
                float web_h, float gauge, float pos_offset_in_camspl_norm_dir,
-               Mesh *left_rail, Mesh *right_rail) {
+               Arena *arena, Mesh *left_rail, Mesh *right_rail) {
   static constexpr uint kCrossSectionVertexCount = 8;
 
   enum RailType { kRailType_Left, kRailType_Right, kRailType__Count };
@@ -300,6 +534,7 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
   assert(camspl_vertices->normals);
   assert(camspl_vertices->binormals);
   assert(color);
+  assert(arena);
   assert(left_rail);
   assert(right_rail);
 
@@ -311,28 +546,29 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
   glm::vec3 *cv_pos = camspl_vertices->positions;
   glm::vec3 *cv_norm = camspl_vertices->normals;
   glm::vec3 *cv_binorm = camspl_vertices->binormals;
-  uint cv_count = camspl_vertices->count;
+  std::size_t cv_count = camspl_vertices->count;
 
   Mesh *rails[kRailType__Count] = {left_rail, right_rail};
-  uint rv_count = cv_count * kCrossSectionVertexCount;
+  std::size_t rv_count = cv_count * kCrossSectionVertexCount;
+  assert(rv_count <= MAX_INDEXED_VERTEX_COUNT);
 
   for (int i = 0; i < kRailType__Count; ++i) {
     rails[i]->vertex_list_type = kVertexListType_1P1C;
     rails[i]->vl1p1c.count = rv_count;
-    rails[i]->vl1p1c.positions = new glm::vec3[rv_count];
-    rails[i]->vl1p1c.colors = new glm::vec4[rv_count];
+    rails[i]->vl1p1c.positions = ArenaAllocArray<glm::vec3>(arena, rv_count);
+    rails[i]->vl1p1c.colors = ArenaAllocArray<glm::vec4>(arena, rv_count);
   }
 
   for (int i = 0; i < kRailType__Count; ++i) {
-    for (uint j = 0; j < rv_count; ++j) {
+    for (std::size_t j = 0; j < rv_count; ++j) {
       rails[i]->vl1p1c.colors[j] = *color;
     }
   }
 
   for (int i = 0; i < kRailType__Count; ++i) {
     glm::vec3 *pos = rails[i]->vl1p1c.positions;
-    for (uint j = 0; j < cv_count; ++j) {
-      uint k = j * kCrossSectionVertexCount;
+    for (std::size_t j = 0; j < cv_count; ++j) {
+      std::size_t k = j * kCrossSectionVertexCount;
       // See the comment block above the function declaration in the header
       // file for the visual index-to-position mapping.
       pos[k] = cv_pos[j] - web_h * cv_norm[j] + 0.5f * web_w * cv_binorm[j];
@@ -349,14 +585,14 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
   }
 
   // Set rail pair `gauge` distance apart.
-  for (uint i = 0; i < cv_count; ++i) {
-    uint j = kCrossSectionVertexCount * i;
+  for (std::size_t i = 0; i < cv_count; ++i) {
+    std::size_t j = kCrossSectionVertexCount * i;
     for (uint k = 0; k < kCrossSectionVertexCount; ++k) {
       right_rail->vl1p1c.positions[j + k] += 0.5f * gauge * cv_binorm[i];
     }
   }
-  for (uint i = 0; i < cv_count; ++i) {
-    uint j = kCrossSectionVertexCount * i;
+  for (std::size_t i = 0; i < cv_count; ++i) {
+    std::size_t j = kCrossSectionVertexCount * i;
     for (uint k = 0; k < kCrossSectionVertexCount; ++k) {
       left_rail->vl1p1c.positions[j + k] -= 0.5f * gauge * cv_binorm[i];
     }
@@ -364,8 +600,8 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
 
   for (int i = 0; i < kRailType__Count; ++i) {
     glm::vec3 *pos = rails[i]->vl1p1c.positions;
-    for (uint j = 0; j < cv_count; ++j) {
-      uint k = j * kCrossSectionVertexCount;
+    for (std::size_t j = 0; j < cv_count; ++j) {
+      std::size_t k = j * kCrossSectionVertexCount;
       for (uint l = 0; l < kCrossSectionVertexCount; ++l) {
         pos[k + l] += pos_offset_in_camspl_norm_dir * cv_norm[j];
       }
@@ -381,17 +617,18 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
   // rv_count / kCrossSectionVertexCount - 1 is the number of iterations for
   // the inner loop.
 
-  uint index_count =
+  std::size_t index_count =
       (rv_count / kCrossSectionVertexCount - 1) * kFaceCount * kFaceVertexCount;
 
   for (int i = 0; i < kRailType__Count; ++i) {
-    rails[i]->indices = new uint[index_count];
+    rails[i]->indices = ArenaAllocArray<uint>(arena, index_count);
     rails[i]->index_count = index_count;
 
     uint *ri = rails[i]->indices;
 
-    uint k = 0;
-    for (uint j = 0; j + kCrossSectionVertexCount < rv_count;
+    // The vertex indices fit in 32 bits, but the index count may not.
+    std::size_t k = 0;
+    for (std::size_t j = 0; j + kCrossSectionVertexCount < rv_count;
          j += kCrossSectionVertexCount) {
       // Top face
       ri[k] = j + 4;
@@ -478,10 +715,13 @@ void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
 
 void MakeCrossties(const VertexList1P1T1N1B *camspl_vertices,
                    float separation_dist, float pos_offset_in_camspl_norm_dir,
+                   Arena *arena, Arena *scratch_arena,
                    VertexList1P1UV *vertices) {
   static constexpr int kUniqPosCountPerCrosstie = 8;
   static constexpr float kDepth = 0.3;
+#ifndef NDEBUG
   static constexpr float kTolerance = 0.00001;
+#endif
 
   static constexpr float kRailWebWidth = 0.1;
   static constexpr float kRailHeight = 0.1;
@@ -495,28 +735,26 @@ void MakeCrossties(const VertexList1P1T1N1B *camspl_vertices,
   assert(camspl_vertices->normals);
   assert(camspl_vertices->binormals);
   assert(separation_dist + kTolerance > 0);
+  assert(arena);
+  assert(scratch_arena);
   assert(vertices);
 
   glm::vec3 *cv_pos = camspl_vertices->positions;
   glm::vec3 *cv_tan = camspl_vertices->tangents;
   glm::vec3 *cv_binorm = camspl_vertices->binormals;
   glm::vec3 *cv_norm = camspl_vertices->normals;
-  uint cv_count = camspl_vertices->count;
-
-  uint max_vertex_count = 36 * (cv_count - 1);
-  glm::vec3 *pos = new glm::vec3[max_vertex_count];
-  glm::vec2 *uv = new glm::vec2[max_vertex_count];
-
-  float dist_moved = 0;
-  uint posi = 0;
-  uint uvi = 0;
-  for (uint i = 1; i < cv_count; ++i) {
-    dist_moved += glm::length(cv_pos[i] - cv_pos[i - 1]);
-
-    if (dist_moved < separation_dist + kTolerance) {
-      continue;
-    }
-
+  std::size_t cv_count = camspl_vertices->count;
+
+  std::size_t max_vertex_count = 36 * (cv_count - 1);
+  glm::vec3 *pos =
+      ArenaAllocArray<glm::vec3>(scratch_arena, max_vertex_count);
+  glm::vec2 *uv = ArenaAllocArray<glm::vec2>(scratch_arena, max_vertex_count);
+
+  std::size_t posi = 0;
+  std::size_t uvi = 0;
+  for (std::size_t i = NextCrosstieVertex(camspl_vertices, 0, separation_dist);
+       i < cv_count;
+       i = NextCrosstieVertex(camspl_vertices, i, separation_dist)) {
     glm::vec3 p[kUniqPosCountPerCrosstie];
 
     // front vertices
@@ -604,21 +842,35 @@ void MakeCrossties(const VertexList1P1T1N1B *camspl_vertices,
 
       uvi += 6;
     }
-
-    dist_moved = 0;
   }
 
   vertices->count = posi;
 
-  vertices->positions = new glm::vec3[vertices->count];
-  for (uint i = 0; i < vertices->count; ++i) {
+  vertices->positions = ArenaAllocArray<glm::vec3>(arena, vertices->count);
+  for (std::size_t i = 0; i < vertices->count; ++i) {
     vertices->positions[i] = pos[i];
   }
-  delete[] pos;
 
-  vertices->uv = new glm::vec2[vertices->count];
-  for (uint i = 0; i < vertices->count; ++i) {
+  vertices->uv = ArenaAllocArray<glm::vec2>(arena, vertices->count);
+  for (std::size_t i = 0; i < vertices->count; ++i) {
     vertices->uv[i] = uv[i];
   }
-  delete[] uv;
+}
+
+std::size_t NextCrosstieVertex(const VertexList1P1T1N1B *camspl_vertices,
+                               std::size_t vertex, float separation_dist) {
+  static constexpr float kTolerance = 0.00001;
+
+  assert(camspl_vertices);
+  assert(camspl_vertices->positions);
+
+  const glm::vec3 *cv_pos = camspl_vertices->positions;
+  float dist_moved = 0;
+  for (std::size_t i = vertex + 1; i < camspl_vertices->count; ++i) {
+    dist_moved += glm::length(cv_pos[i] - cv_pos[i - 1]);
+    if (dist_moved >= separation_dist + kTolerance) {
+      return i;
+    }
+  }
+  return camspl_vertices->count;
 }
\ No newline at end of file
@@ -1,13 +1,23 @@
 #ifndef RCOASTER_MODELS_HPP
 #define RCOASTER_MODELS_HPP
 
+#include <cstddef>
 #include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <vector>
 
+#include "arena.hpp"
 #include "types.hpp"
 
+// The arrays of the vertex lists and meshes that are made below are allocated
+// from the given arena, and freed along with it.
+
+// Indices are 32-bit, as they are drawn, so an indexed mesh has at most this
+// many vertices. Counts are 64-bit.
+#define MAX_INDEXED_VERTEX_COUNT ((std::size_t)1 << 32)
+
 enum VertexListType {
   kVertexListType_1P1C,
   kVertexListType_1P1UV,
@@ -17,13 +27,13 @@ enum VertexListType {
 struct VertexList1P1C {
   glm::vec3 *positions;
   glm::vec4 *colors;
-  uint count;
+  std::size_t count;
 };
 
 struct VertexList1P1UV {
   glm::vec3 *positions;
   glm::vec2 *uv;
-  uint count;
+  std::size_t count;
 };
 
 struct VertexList1P1T1N1B {
@@ -31,7 +41,7 @@ struct VertexList1P1T1N1B {
   glm::vec3 *tangents;
   glm::vec3 *normals;
   glm::vec3 *binormals;
-  uint count;
+  std::size_t count;
 };
 
 struct Mesh {
@@ -42,24 +52,73 @@ struct Mesh {
     VertexList1P1T1N1B vl1p1t1n1b;
   };
   uint *indices;
-  uint index_count;
+  std::size_t index_count;
 };
 
 void EvalCatmullRomSpline(const glm::vec3 *control_points,
                           uint control_point_count, float max_segment_len,
-                          glm::vec3 **positions, glm::vec3 **tangents,
-                          uint *vertices_count);
+                          Arena *arena, glm::vec3 **positions,
+                          glm::vec3 **tangents, std::size_t *vertices_count);
+
+/*
+Appends the vertices of segments `[begin, end)` of a Catmull-Rom spline, as
+`EvalCatmullRomSpline` evaluates them. Segment `i` is the curve between control
+points `i + 1` and `i + 2`, and depends only on control points `i` to `i + 3`,
+so a spline with `n` control points has `n - 3` segments.
+*/
+void AppendCatmullRomSegments(const glm::vec3 *control_points, uint begin,
+                              uint end, float max_segment_len,
+                              std::vector<glm::vec3> *positions,
+                              std::vector<glm::vec3> *tangents);
+
+// Position at `u`, from 0 to 1, along segment `segment` of a Catmull-Rom
+// spline.
+glm::vec3 CatmullRomSegmentPosition(const glm::vec3 *control_points,
+                                    uint segment, float u);
 
-void CalcCameraOrientation(const glm::vec3 *tangents, uint vertex_count,
+/*
+Evaluates Catmull-Rom splines into at most `max_vertex_count` vertices in
+total, as line segments of two vertices each, placed where they most reduce the
+distance between the curves and their approximation rather than where the
+curves are longest. Every segment of a spline takes at least one line segment,
+which the budget must allow for.
+
+Output Parameters:
+- positions, tangents, vertex_counts: of each spline, allocated in `arena`
+- max_error: the largest distance between a curve and its approximation
+*/
+void EvalCatmullRomSplinesWithBudget(const glm::vec3 *const *control_points,
+                                     const uint *control_point_counts,
+                                     uint spline_count,
+                                     std::size_t max_vertex_count,
+                                     Arena *arena, glm::vec3 **positions,
+                                     glm::vec3 **tangents,
+                                     std::size_t *vertex_counts,
+                                     float *max_error);
+
+void CalcCameraOrientation(const glm::vec3 *tangents, std::size_t vertex_count,
                            glm::vec3 *normals, glm::vec3 *binormals);
 
+// Recomputes the reference frames of vertices `[first_vertex, vertex_count)`,
+// each of which is propagated from the frame of the vertex before it.
+void CalcCameraOrientationFrom(const glm::vec3 *tangents,
+                               std::size_t vertex_count,
+                               std::size_t first_vertex, glm::vec3 *normals,
+                               glm::vec3 *binormals);
+
 void MakeCameraPath(const glm::vec3 *control_points, uint control_point_count,
-                    float max_segment_len, VertexList1P1T1N1B *vertices);
+                    float max_segment_len, Arena *arena,
+                    VertexList1P1T1N1B *vertices);
+
+// Vertices `[begin, end)` of a camera path, pointing into it.
+VertexList1P1T1N1B SliceCameraPath(const VertexList1P1T1N1B *vertices,
+                                   std::size_t begin, std::size_t end);
 
 void MakeAxisAlignedXzSquarePlane(float side_len, uint tex_repeat_count,
-                                  Mesh *mesh);
+                                  Arena *arena, Mesh *mesh);
 
-void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Mesh *mesh);
+void MakeAxisAlignedCube(float side_len, uint tex_repeat_count, Arena *arena,
+                         Mesh *mesh);
 
 /*
 Gauge is the distance between the two rails.
@@ -84,6 +143,8 @@ Rail cross section:
           7 -------- 0
 
   `o` marks the camera spline vertex, which is used as the origin.
+  Each rail has 8 vertices per camera spline vertex, of which there may be at
+  most `MAX_INDEXED_VERTEX_COUNT / 8`.
   The gauge is the distance between points `c` and `d`.
 
                         gauge
@@ -99,10 +160,22 @@ Rail cross section:
 void MakeRails(const VertexList1P1T1N1B *camspl_vertices,
                const glm::vec4 *color, float head_w, float head_h, float web_w,
                float web_h, float gauge, float pos_offset_in_camspl_norm_dir,
-               Mesh *left_rail, Mesh *right_rail);
+               Arena *arena, Mesh *left_rail, Mesh *right_rail);
 
+// The worst-case vertices are laid out in `scratch_arena`, whose allocations
+// are left to be freed in bulk by its owner.
+//
+// A crosstie is placed at every camera spline vertex that
+// `NextCrosstieVertex` finds, starting from the first vertex.
 void MakeCrossties(const VertexList1P1T1N1B *camspl_vertices,
                    float separation_dist, float pos_offset_in_camspl_norm_dir,
+                   Arena *arena, Arena *scratch_arena,
                    VertexList1P1UV *vertices);
 
+// Returns the first camera spline vertex after `vertex` that is at least
+// `separation_dist` along the spline from it, or the vertex count if there is
+// none.
+std::size_t NextCrosstieVertex(const VertexList1P1T1N1B *camspl_vertices,
+                               std::size_t vertex, float separation_dist);
+
 #endif  // RCOASTER_MODELS_HPP
\ No newline at end of file
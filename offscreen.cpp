@@ -0,0 +1,210 @@
+#include "offscreen.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#ifdef linux
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef linux
+static int HasExtension(const char *extensions, const char *name) {
+  if (!extensions) {
+    return 0;
+  }
+
+  std::size_t name_len = std::strlen(name);
+  for (const char *p = std::strstr(extensions, name); p;
+       p = std::strstr(p + name_len, name)) {
+    int is_start = p == extensions || p[-1] == ' ';
+    int is_end = p[name_len] == ' ' || p[name_len] == '\0';
+    if (is_start && is_end) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static EGLDisplay GetDisplay() {
+  const char *client_extensions =
+      eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+  if (HasExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    auto get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+      EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                                EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY) {
+        return display;
+      }
+    }
+  }
+
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+#endif
+
+Status MakeOffscreenContext(OffscreenContext *ctx) {
+  assert(ctx);
+
+  *ctx = {};
+
+#ifdef linux
+  EGLDisplay display = GetDisplay();
+  if (display == EGL_NO_DISPLAY) {
+    std::fprintf(stderr, "Failed to get EGL display.\n");
+    return kStatus_GlError;
+  }
+
+  EGLint major;
+  EGLint minor;
+  if (!eglInitialize(display, &major, &minor)) {
+    std::fprintf(stderr, "Failed to initialize EGL display: 0x%x.\n",
+                 eglGetError());
+    return kStatus_GlError;
+  }
+  ctx->display = display;
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::fprintf(stderr, "Failed to bind OpenGL API to EGL.\n");
+    FreeOffscreenContext(ctx);
+    return kStatus_GlError;
+  }
+
+  int is_surfaceless = HasExtension(
+      eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+  // clang-format off
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, is_surfaceless ? 0 : EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_NONE
+  };
+  // clang-format on
+  EGLConfig config;
+  EGLint config_count;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &config_count) ||
+      config_count == 0) {
+    std::fprintf(stderr, "Failed to choose EGL config.\n");
+    FreeOffscreenContext(ctx);
+    return kStatus_GlError;
+  }
+
+  // clang-format off
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 2,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  // clang-format on
+  EGLContext context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if (context == EGL_NO_CONTEXT) {
+    std::fprintf(stderr, "Failed to create EGL context: 0x%x.\n",
+                 eglGetError());
+    FreeOffscreenContext(ctx);
+    return kStatus_GlError;
+  }
+  ctx->context = context;
+
+  EGLSurface surface = EGL_NO_SURFACE;
+  if (!is_surfaceless) {
+    const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    if (surface == EGL_NO_SURFACE) {
+      std::fprintf(stderr, "Failed to create EGL pbuffer surface.\n");
+      FreeOffscreenContext(ctx);
+      return kStatus_GlError;
+    }
+    ctx->surface = surface;
+  }
+
+  if (!eglMakeCurrent(display, surface, surface, context)) {
+    std::fprintf(stderr, "Failed to make EGL context current.\n");
+    FreeOffscreenContext(ctx);
+    return kStatus_GlError;
+  }
+
+  return kStatus_Ok;
+#else
+  std::fprintf(stderr, "Offscreen contexts are only supported on Linux.\n");
+  return kStatus_UnspecifiedError;
+#endif
+}
+
+void FreeOffscreenContext(OffscreenContext *ctx) {
+  assert(ctx);
+
+#ifdef linux
+  if (!ctx->display) {
+    return;
+  }
+
+  eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (ctx->surface) {
+    eglDestroySurface(ctx->display, ctx->surface);
+  }
+  if (ctx->context) {
+    eglDestroyContext(ctx->display, ctx->context);
+  }
+  eglTerminate(ctx->display);
+#endif
+
+  *ctx = {};
+}
+
+Status MakeFramebuffer(uint w, uint h, Framebuffer *fb) {
+  assert(w > 0);
+  assert(h > 0);
+  assert(fb);
+
+  fb->w = w;
+  fb->h = h;
+
+  glGenRenderbuffers(1, &fb->color_rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, fb->color_rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+
+  glGenRenderbuffers(1, &fb->depth_stencil_rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, fb->depth_stencil_rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &fb->fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb->fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, fb->color_rbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, fb->depth_stencil_rbo);
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    std::fprintf(stderr, "Framebuffer is incomplete: 0x%x.\n", status);
+    FreeFramebuffer(fb);
+    return kStatus_GlError;
+  }
+
+  return kStatus_Ok;
+}
+
+void FreeFramebuffer(Framebuffer *fb) {
+  assert(fb);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fb->fbo);
+  glDeleteRenderbuffers(1, &fb->color_rbo);
+  glDeleteRenderbuffers(1, &fb->depth_stencil_rbo);
+
+  *fb = {};
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef RCOASTER_OFFSCREEN_HPP
+#define RCOASTER_OFFSCREEN_HPP
+
+#include "opengl.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+// An OpenGL context without a window, e.g. for headless render nodes.
+struct OffscreenContext {
+  void *display;
+  void *context;
+  void *surface;
+};
+
+struct Framebuffer {
+  GLuint fbo;
+  GLuint color_rbo;
+  GLuint depth_stencil_rbo;
+  uint w;
+  uint h;
+};
+
+/*
+Creates an OpenGL 3.2 core profile context with EGL and makes it current.
+
+A surfaceless context is created if the EGL implementation supports it, e.g.
+Mesa llvmpipe without a display server. Otherwise a minimal pbuffer surface is
+created. Rendering must go to a framebuffer object.
+
+Only supported on Linux.
+*/
+Status MakeOffscreenContext(OffscreenContext *ctx);
+
+void FreeOffscreenContext(OffscreenContext *ctx);
+
+// Makes and binds a framebuffer object with RGBA8 color and depth-stencil
+// renderbuffers.
+Status MakeFramebuffer(uint w, uint h, Framebuffer *fb);
+
+void FreeFramebuffer(Framebuffer *fb);
+
+#endif  // RCOASTER_OFFSCREEN_HPP
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#define FRAME_TIME_WINDOW_SIZE 1024
+
+// Chrome trace thread ID of the GPU timeline.
+#define GPU_TRACE_TID 1000
+
+const char *const kProfilePhaseStrings[kProfilePhase__Count] = {
+    "load_splines", "spline_eval",    "frames",      "rails",
+    "crossties",    "track_cache",    "scenery",     "shaders",
+    "textures",     "upload",         "frame",       "draw_rails",
+    "draw_ground",  "draw_sky",       "draw_crossties", "capture",
+    "readback",     "encode"};
+
+const char *const kProfileClockStrings[kProfileClock__Count] = {"cpu", "gpu"};
+
+struct ProfileEvent {
+  ProfilePhase phase;
+  ProfileClock clock;
+  uint thread_index;
+  std::int64_t start_nsec;
+  std::int64_t duration_nsec;
+};
+
+struct Profiler {
+  std::atomic<int> is_enabled;
+  std::int64_t origin_nsec;
+
+  std::mutex mutex;
+  std::vector<ProfileEvent> events;
+  std::uint64_t max_event_count;
+  std::uint64_t dropped_event_count;
+
+  std::int64_t frame_times_nsec[FRAME_TIME_WINDOW_SIZE];
+  uint frame_time_count;
+  uint frame_time_next;
+};
+
+static Profiler profiler;
+
+static std::atomic<uint> next_thread_index;
+
+static uint ThreadIndex() {
+  static thread_local uint index = next_thread_index++;
+  return index;
+}
+
+const char *String(ProfilePhase p) {
+  assert(p < kProfilePhase__Count);
+  return kProfilePhaseStrings[p];
+}
+
+static const char *String(ProfileClock c) {
+  assert(c < kProfileClock__Count);
+  return kProfileClockStrings[c];
+}
+
+std::int64_t ProfileNowNsec() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+void EnableProfiler(std::uint64_t max_event_count) {
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  profiler.origin_nsec = ProfileNowNsec();
+  profiler.max_event_count = max_event_count;
+  profiler.events.reserve(std::min<std::uint64_t>(max_event_count, 1 << 16));
+  profiler.is_enabled = 1;
+}
+
+int IsProfilerEnabled() { return profiler.is_enabled; }
+
+void RecordProfileEvent(ProfilePhase phase, ProfileClock clock,
+                        std::int64_t start_nsec, std::int64_t duration_nsec) {
+  assert(phase < kProfilePhase__Count);
+  assert(clock < kProfileClock__Count);
+
+  if (!profiler.is_enabled) {
+    return;
+  }
+
+  uint thread_index = ThreadIndex();
+
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  if (profiler.events.size() >= profiler.max_event_count) {
+    ++profiler.dropped_event_count;
+    return;
+  }
+
+  profiler.events.push_back(
+      {phase, clock, thread_index, start_nsec, duration_nsec});
+}
+
+std::int64_t TotalPhaseNsec(ProfilePhase phase, ProfileClock clock) {
+  assert(phase < kProfilePhase__Count);
+  assert(clock < kProfileClock__Count);
+
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  std::int64_t total = 0;
+  for (const ProfileEvent &e : profiler.events) {
+    if (e.phase == phase && e.clock == clock) {
+      total += e.duration_nsec;
+    }
+  }
+  return total;
+}
+
+void RecordFrameTime(std::int64_t duration_nsec) {
+  if (!profiler.is_enabled) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  profiler.frame_times_nsec[profiler.frame_time_next] = duration_nsec;
+  profiler.frame_time_next =
+      (profiler.frame_time_next + 1) % FRAME_TIME_WINDOW_SIZE;
+  if (profiler.frame_time_count < FRAME_TIME_WINDOW_SIZE) {
+    ++profiler.frame_time_count;
+  }
+}
+
+void CalcFrameTimePercentiles(FrameTimePercentiles *percentiles) {
+  assert(percentiles);
+
+  std::int64_t samples[FRAME_TIME_WINDOW_SIZE];
+  uint count;
+  {
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    count = profiler.frame_time_count;
+    std::copy(profiler.frame_times_nsec, profiler.frame_times_nsec + count,
+              samples);
+  }
+
+  *percentiles = {};
+  percentiles->sample_count = count;
+  if (count == 0) {
+    return;
+  }
+
+  std::sort(samples, samples + count);
+
+  // Nearest-rank method.
+  auto percentile = [&](uint p) {
+    uint rank = (p * count + 99) / 100;
+    return samples[std::max(rank, 1u) - 1] / 1e6;
+  };
+  percentiles->p50_msec = percentile(50);
+  percentiles->p95_msec = percentile(95);
+  percentiles->p99_msec = percentile(99);
+}
+
+Status ExportProfileTrace(const char *filepath) {
+  assert(filepath);
+
+  std::FILE *file = std::fopen(filepath, "w");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  std::fprintf(file,
+               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"GPU\"}}",
+               GPU_TRACE_TID);
+
+  for (const ProfileEvent &e : profiler.events) {
+    uint tid = e.thread_index;
+    if (e.clock == kProfileClock_Gpu) {
+      tid = GPU_TRACE_TID;
+    }
+    std::fprintf(file,
+                 ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                 "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                 String(e.phase), String(e.clock), tid,
+                 (e.start_nsec - profiler.origin_nsec) / 1000.0,
+                 e.duration_nsec / 1000.0);
+  }
+
+  std::fprintf(file, "\n]}\n");
+
+  int rc = std::fclose(file);
+  if (rc != 0) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  if (profiler.dropped_event_count) {
+    std::fprintf(stderr, "Dropped %llu profile events.\n",
+                 (unsigned long long)profiler.dropped_event_count);
+  }
+
+  return kStatus_Ok;
+}
+
+Status ExportProfileCsv(const char *filepath) {
+  assert(filepath);
+
+  std::FILE *file = std::fopen(filepath, "w");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  std::lock_guard<std::mutex> lock(profiler.mutex);
+
+  std::fprintf(file, "phase,clock,thread,start_usec,duration_usec\n");
+  for (const ProfileEvent &e : profiler.events) {
+    std::fprintf(file, "%s,%s,%u,%.3f,%.3f\n", String(e.phase),
+                 String(e.clock), e.thread_index,
+                 (e.start_nsec - profiler.origin_nsec) / 1000.0,
+                 e.duration_nsec / 1000.0);
+  }
+
+  int rc = std::fclose(file);
+  if (rc != 0) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
+
+ProfileScope::ProfileScope(ProfilePhase phase) : phase(phase) {
+  start_nsec = profiler.is_enabled ? ProfileNowNsec() : 0;
+}
+
+ProfileScope::~ProfileScope() {
+  if (profiler.is_enabled) {
+    RecordProfileEvent(phase, kProfileClock_Cpu, start_nsec,
+                       ProfileNowNsec() - start_nsec);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef RCOASTER_PROFILER_HPP
+#define RCOASTER_PROFILER_HPP
+
+#include <cstdint>
+
+#include "status.hpp"
+#include "types.hpp"
+
+// The phases before `kProfilePhase_Frame` happen once at startup.
+enum ProfilePhase {
+  kProfilePhase_LoadSplines,
+  kProfilePhase_SplineEval,
+  kProfilePhase_Frames,
+  kProfilePhase_Rails,
+  kProfilePhase_Crossties,
+  kProfilePhase_TrackCache,
+  kProfilePhase_Scenery,
+  kProfilePhase_Shaders,
+  kProfilePhase_Textures,
+  kProfilePhase_Upload,
+  kProfilePhase_Frame,
+  kProfilePhase_DrawRails,
+  kProfilePhase_DrawGround,
+  kProfilePhase_DrawSky,
+  kProfilePhase_DrawCrossties,
+  kProfilePhase_Capture,
+  // Copying a finished readback out of its pixel buffer object, on the
+  // render thread, within `kProfilePhase_Capture`.
+  kProfilePhase_Readback,
+  kProfilePhase_Encode,
+  kProfilePhase__Count
+};
+
+enum ProfileClock {
+  kProfileClock_Cpu,
+  kProfileClock_Gpu,
+  kProfileClock__Count
+};
+
+struct FrameTimePercentiles {
+  uint sample_count;
+  double p50_msec;
+  double p95_msec;
+  double p99_msec;
+};
+
+const char *String(ProfilePhase p);
+
+/*
+The profiler is process-wide and disabled by default. While disabled, timers
+cost a branch and nothing is recorded.
+
+Input Parameters:
+- max_event_count: events recorded after this many are dropped, which bounds
+the memory used by long runs
+*/
+void EnableProfiler(std::uint64_t max_event_count);
+
+int IsProfilerEnabled();
+
+std::int64_t ProfileNowNsec();
+
+// Thread-safe.
+void RecordProfileEvent(ProfilePhase phase, ProfileClock clock,
+                        std::int64_t start_nsec, std::int64_t duration_nsec);
+
+// Sums the durations of all recorded events of a phase.
+std::int64_t TotalPhaseNsec(ProfilePhase phase, ProfileClock clock);
+
+// Adds a sample to the rolling window from which frame time percentiles are
+// calculated.
+void RecordFrameTime(std::int64_t duration_nsec);
+
+void CalcFrameTimePercentiles(FrameTimePercentiles *percentiles);
+
+// Writes all recorded events in the Chrome trace event format, viewable in
+// chrome://tracing or Perfetto.
+Status ExportProfileTrace(const char *filepath);
+
+Status ExportProfileCsv(const char *filepath);
+
+// Records a CPU event spanning the lifetime of the object.
+struct ProfileScope {
+  explicit ProfileScope(ProfilePhase phase);
+  ~ProfileScope();
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+  ProfilePhase phase;
+  std::int64_t start_nsec;
+};
+
+#endif  // RCOASTER_PROFILER_HPP
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "program_cache.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "cache_file.hpp"
+
+static std::uint64_t ExtendHash(std::uint64_t hash, const char *s) {
+  // The terminator separates consecutive strings.
+  return ExtendHash(hash, s ? s : "", s ? std::strlen(s) + 1 : 1);
+}
+
+int IsProgramCacheSupported() {
+#ifdef __APPLE__
+  int is_supported = 1;
+#else
+  int is_supported = glewIsSupported("GL_VERSION_4_1") ||
+                     glewIsSupported("GL_ARB_get_program_binary");
+#endif
+  if (!is_supported) {
+    return 0;
+  }
+
+  // Implementations may support the functions without any binary format.
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  return format_count > 0;
+}
+
+std::uint64_t ProgramCacheKey(const std::string *sources, uint count) {
+  assert(sources || count == 0);
+
+  std::uint64_t hash = CACHE_HASH_SEED;
+  hash = ExtendHash(hash, (const char *)glGetString(GL_VENDOR));
+  hash = ExtendHash(hash, (const char *)glGetString(GL_RENDERER));
+  hash = ExtendHash(hash, (const char *)glGetString(GL_VERSION));
+  for (uint i = 0; i < count; ++i) {
+    std::uint64_t size = sources[i].size();
+    hash = ExtendHash(hash, &size, sizeof(size));
+    hash = ExtendHash(hash, sources[i].data(), sources[i].size());
+  }
+  return hash;
+}
+
+static Status MakeCacheFilepath(const char *cache_dir, std::uint64_t key,
+                                char *filepath) {
+  assert(cache_dir);
+  assert(filepath);
+
+  int rc = std::snprintf(filepath, CACHE_FILEPATH_BUFFER_SIZE,
+                         "%s/%016llx.%s", cache_dir, (unsigned long long)key,
+                         PROGRAM_CACHE_EXTENSION);
+  if (rc < 0 || rc >= CACHE_FILEPATH_BUFFER_SIZE) {
+    std::fprintf(stderr, "Failed to make program cache filepath.\n");
+    return kStatus_UnspecifiedError;
+  }
+  return kStatus_Ok;
+}
+
+static Status ReadCacheFile(const char *filepath, std::vector<uchar> *content,
+                            int *exists) {
+  assert(filepath);
+  assert(content);
+  assert(exists);
+
+  std::FILE *file = std::fopen(filepath, "rb");
+  if (!file) {
+    *exists = 0;
+    return errno == ENOENT ? kStatus_Ok : kStatus_IoError;
+  }
+  *exists = 1;
+
+  Status status = kStatus_Ok;
+  uchar buffer[4096];
+  for (;;) {
+    std::size_t n = std::fread(buffer, 1, sizeof(buffer), file);
+    content->insert(content->end(), buffer, buffer + n);
+    if (n < sizeof(buffer)) {
+      if (std::ferror(file)) {
+        status = kStatus_IoError;
+      }
+      break;
+    }
+  }
+
+  std::fclose(file);
+  return status;
+}
+
+Status LoadCachedProgram(const char *cache_dir, std::uint64_t key,
+                         GLuint program, int *is_hit) {
+  assert(cache_dir);
+  assert(is_hit);
+
+  *is_hit = 0;
+
+  char filepath[CACHE_FILEPATH_BUFFER_SIZE];
+  Status status = MakeCacheFilepath(cache_dir, key, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  std::vector<uchar> content;
+  int exists;
+  status = ReadCacheFile(filepath, &content, &exists);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to read file %s.\n", filepath);
+    return status;
+  }
+  if (!exists || content.size() < sizeof(ProgramCacheHeader)) {
+    return kStatus_Ok;
+  }
+
+  ProgramCacheHeader header;
+  std::memcpy(&header, content.data(), sizeof(header));
+  if (std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) !=
+          0 ||
+      header.version != PROGRAM_CACHE_VERSION || header.key != key ||
+      header.binary_size != content.size() - sizeof(header)) {
+    return kStatus_Ok;
+  }
+
+  glProgramBinary(program, header.binary_format,
+                  content.data() + sizeof(header), header.binary_size);
+
+  // Fails if the implementation no longer accepts the binary, e.g. after a
+  // driver update that kept the version string.
+  GLint link_status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+  *is_hit = link_status == GL_TRUE;
+
+  return kStatus_Ok;
+}
+
+Status WriteCachedProgram(const char *cache_dir, std::uint64_t key,
+                          GLuint program) {
+  assert(cache_dir);
+
+  GLint binary_size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+  if (binary_size <= 0) {
+    std::fprintf(stderr, "Failed to get program binary.\n");
+    return kStatus_GlError;
+  }
+
+  std::vector<uchar> content(sizeof(ProgramCacheHeader) + binary_size);
+
+  GLenum binary_format;
+  GLsizei length = 0;
+  glGetProgramBinary(program, binary_size, &length, &binary_format,
+                     content.data() + sizeof(ProgramCacheHeader));
+  if (length != binary_size) {
+    std::fprintf(stderr, "Failed to get program binary.\n");
+    return kStatus_GlError;
+  }
+
+  ProgramCacheHeader header = {};
+  std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+  header.version = PROGRAM_CACHE_VERSION;
+  header.binary_format = binary_format;
+  header.key = key;
+  header.binary_size = binary_size;
+  std::memcpy(content.data(), &header, sizeof(header));
+
+  char filepath[CACHE_FILEPATH_BUFFER_SIZE];
+  Status status = MakeCacheFilepath(cache_dir, key, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  const CacheFileChunk chunk = {content.data(), content.size()};
+  return WriteCacheFile(filepath, &chunk, 1);
+}
\ No newline at end of file
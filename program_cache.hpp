@@ -0,0 +1,52 @@
+#ifndef RCOASTER_PROGRAM_CACHE_HPP
+#define RCOASTER_PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "opengl.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+#define PROGRAM_CACHE_MAGIC "RCPRGBIN"
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_EXTENSION "rcpb"
+
+/*
+Linked shader programs are cached on disk as the binaries of the OpenGL
+implementation, so that later runs load them instead of compiling their
+shaders.
+
+A cache file is named after the key of its program, a hash of the sources of
+its shaders and of the renderer and version of the OpenGL implementation. It
+starts with a `ProgramCacheHeader`, followed by the binary. A binary that the
+implementation rejects is treated as missing.
+*/
+struct ProgramCacheHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t binary_format;
+  std::uint64_t key;
+  std::uint64_t binary_size;
+};
+
+// Whether the OpenGL implementation can save and load program binaries.
+int IsProgramCacheSupported();
+
+std::uint64_t ProgramCacheKey(const std::string *sources, uint count);
+
+/*
+Loads a program binary from the cache into a program.
+
+Output Parameters:
+- is_hit: whether the cache file exists and the program was linked from it
+*/
+Status LoadCachedProgram(const char *cache_dir, std::uint64_t key,
+                         GLuint program, int *is_hit);
+
+// Writes the binary of a linked program to the cache. The program must have
+// been linked with `GL_PROGRAM_BINARY_RETRIEVABLE_HINT` set.
+Status WriteCachedProgram(const char *cache_dir, std::uint64_t key,
+                          GLuint program);
+
+#endif  // RCOASTER_PROGRAM_CACHE_HPP
\ No newline at end of file
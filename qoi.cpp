@@ -0,0 +1,241 @@
+#include "qoi.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+
+#define QOI_MAX_RUN 62
+
+// The most bytes written for a pixel: the end of a run and `QOI_OP_RGBA`.
+#define QOI_MAX_PIXEL_SIZE 6
+
+static const uchar kQoiEndMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static inline uint Red(std::uint32_t px) { return px & 0xff; }
+static inline uint Green(std::uint32_t px) { return px >> 8 & 0xff; }
+static inline uint Blue(std::uint32_t px) { return px >> 16 & 0xff; }
+static inline uint Alpha(std::uint32_t px) { return px >> 24; }
+
+static inline uint Hash(std::uint32_t px) {
+  return (Red(px) * 3 + Green(px) * 5 + Blue(px) * 7 + Alpha(px) * 11) % 64;
+}
+
+static Status Flush(QoiEncoder *enc) {
+  assert(enc);
+
+  if (enc->buffer_size == 0) {
+    return kStatus_Ok;
+  }
+
+  Status status = enc->write(enc->buffer, enc->buffer_size, enc->context);
+  enc->byte_count += enc->buffer_size;
+  enc->buffer_size = 0;
+  return status;
+}
+
+static inline uchar *WriteBigEndian32(std::uint32_t v, uchar *p) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+  return p + 4;
+}
+
+Status BeginQoi(uint w, uint h, uint channel_count, QoiWriteFunc write,
+                void *context, QoiEncoder *enc) {
+  assert(w > 0);
+  assert(h > 0);
+  assert(channel_count == 3 || channel_count == 4);
+  assert(write);
+  assert(enc);
+
+  enc->write = write;
+  enc->context = context;
+  enc->w = w;
+  enc->h = h;
+  enc->channel_count = channel_count;
+  enc->encoded_row_count = 0;
+
+  std::memset(enc->index, 0, sizeof(enc->index));
+  enc->previous = 0xff000000;
+  enc->run = 0;
+
+  enc->byte_count = 0;
+
+  uchar *p = enc->buffer;
+  std::memcpy(p, "qoif", 4);
+  p = WriteBigEndian32(w, p + 4);
+  p = WriteBigEndian32(h, p);
+  *p++ = channel_count;
+  // sRGB with linear alpha.
+  *p++ = 0;
+  enc->buffer_size = p - enc->buffer;
+
+  return kStatus_Ok;
+}
+
+Status EncodeQoiRows(const uchar *rgba, std::ptrdiff_t stride,
+                     uint row_count, QoiEncoder *enc) {
+  assert(rgba);
+  assert(enc);
+  assert(enc->encoded_row_count + row_count <= enc->h);
+
+  std::uint32_t alpha_mask = enc->channel_count == 3 ? 0xff000000 : 0;
+
+  // The state lives in locals while encoding, so the compiler can keep it in
+  // registers.
+  std::uint32_t previous = enc->previous;
+  uint run = enc->run;
+  uchar *p = enc->buffer + enc->buffer_size;
+  uchar *end = enc->buffer + QOI_BUFFER_SIZE;
+
+  for (uint y = 0; y < row_count; ++y) {
+    const uchar *row = rgba + (std::ptrdiff_t)y * stride;
+
+    for (uint x = 0; x < enc->w; ++x) {
+      const uchar *c = row + x * 4;
+      std::uint32_t px = (c[0] | c[1] << 8 | c[2] << 16 |
+                          (std::uint32_t)c[3] << 24) |
+                         alpha_mask;
+
+      if (end - p < QOI_MAX_PIXEL_SIZE) {
+        enc->buffer_size = p - enc->buffer;
+        Status status = Flush(enc);
+        if (status != kStatus_Ok) {
+          return status;
+        }
+        p = enc->buffer;
+      }
+
+      if (px == previous) {
+        ++run;
+        if (run == QOI_MAX_RUN) {
+          *p++ = QOI_OP_RUN | (run - 1);
+          run = 0;
+        }
+        continue;
+      }
+
+      if (run > 0) {
+        *p++ = QOI_OP_RUN | (run - 1);
+        run = 0;
+      }
+
+      uint hash = Hash(px);
+      if (enc->index[hash] == px) {
+        *p++ = QOI_OP_INDEX | hash;
+        previous = px;
+        continue;
+      }
+      enc->index[hash] = px;
+
+      if (Alpha(px) != Alpha(previous)) {
+        *p++ = QOI_OP_RGBA;
+        *p++ = Red(px);
+        *p++ = Green(px);
+        *p++ = Blue(px);
+        *p++ = Alpha(px);
+        previous = px;
+        continue;
+      }
+
+      signed char dr = (signed char)(Red(px) - Red(previous));
+      signed char dg = (signed char)(Green(px) - Green(previous));
+      signed char db = (signed char)(Blue(px) - Blue(previous));
+      signed char dr_dg = dr - dg;
+      signed char db_dg = db - dg;
+
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+        *p++ = QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+      } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                 db_dg >= -8 && db_dg <= 7) {
+        *p++ = QOI_OP_LUMA | (dg + 32);
+        *p++ = (dr_dg + 8) << 4 | (db_dg + 8);
+      } else {
+        *p++ = QOI_OP_RGB;
+        *p++ = Red(px);
+        *p++ = Green(px);
+        *p++ = Blue(px);
+      }
+      previous = px;
+    }
+  }
+
+  enc->buffer_size = p - enc->buffer;
+  enc->previous = previous;
+  enc->run = run;
+  enc->encoded_row_count += row_count;
+
+  return kStatus_Ok;
+}
+
+Status EndQoi(QoiEncoder *enc) {
+  assert(enc);
+  assert(enc->encoded_row_count == enc->h);
+
+  if (QOI_BUFFER_SIZE - enc->buffer_size < 1 + sizeof(kQoiEndMarker)) {
+    Status status = Flush(enc);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+  }
+
+  if (enc->run > 0) {
+    enc->buffer[enc->buffer_size++] = QOI_OP_RUN | (enc->run - 1);
+    enc->run = 0;
+  }
+  std::memcpy(enc->buffer + enc->buffer_size, kQoiEndMarker,
+              sizeof(kQoiEndMarker));
+  enc->buffer_size += sizeof(kQoiEndMarker);
+
+  return Flush(enc);
+}
+
+Status WriteQoiToFile(const void *data, std::size_t size, void *context) {
+  assert(data);
+  assert(context);
+
+  if (std::fwrite(data, 1, size, (std::FILE *)context) != size) {
+    return kStatus_IoError;
+  }
+  return kStatus_Ok;
+}
+
+Status WriteQoiFile(const char *filepath, const uchar *rgba,
+                    std::ptrdiff_t stride, uint w, uint h, uint channel_count) {
+  assert(filepath);
+  assert(rgba);
+
+  std::FILE *file = std::fopen(filepath, "wb");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  QoiEncoder *enc = new QoiEncoder;
+
+  Status status = BeginQoi(w, h, channel_count, WriteQoiToFile, file, enc);
+  if (status == kStatus_Ok) {
+    status = EncodeQoiRows(rgba, stride, h, enc);
+  }
+  if (status == kStatus_Ok) {
+    status = EndQoi(enc);
+  }
+
+  delete enc;
+
+  int rc = std::fclose(file);
+  if (status != kStatus_Ok || rc != 0) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef RCOASTER_QOI_HPP
+#define RCOASTER_QOI_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "status.hpp"
+#include "types.hpp"
+
+#define QOI_BUFFER_SIZE 65536
+
+// Consumes encoded bytes.
+typedef Status (*QoiWriteFunc)(const void *data, std::size_t size,
+                               void *context);
+
+/*
+Streaming encoder of the lossless QOI image format (https://qoiformat.org).
+
+Rows are encoded in order, a few at a time if need be, so an image does not
+have to be in memory at once. The encoded bytes are buffered and passed to the
+write function in blocks of up to `QOI_BUFFER_SIZE` bytes.
+*/
+struct QoiEncoder {
+  QoiWriteFunc write;
+  void *context;
+
+  uint w;
+  uint h;
+  uint channel_count;
+  uint encoded_row_count;
+
+  // Pixels are packed as R | G << 8 | B << 16 | A << 24.
+  std::uint32_t index[64];
+  std::uint32_t previous;
+  uint run;
+
+  uchar buffer[QOI_BUFFER_SIZE];
+  std::size_t buffer_size;
+  std::uint64_t byte_count;
+};
+
+/*
+Writes the header of an image.
+
+Input Parameters:
+- channel_count: 3 or 4. With 3, the alpha channel of the input is ignored
+*/
+Status BeginQoi(uint w, uint h, uint channel_count, QoiWriteFunc write,
+                void *context, QoiEncoder *enc);
+
+/*
+Encodes the next rows of the image.
+
+Input Parameters:
+- rgba: first pixel of the first row, with 4 bytes per pixel
+- stride: signed distance in bytes from a row to the next one
+*/
+Status EncodeQoiRows(const uchar *rgba, std::ptrdiff_t stride,
+                     uint row_count, QoiEncoder *enc);
+
+// Writes the end of the image once all rows have been encoded.
+Status EndQoi(QoiEncoder *enc);
+
+// A `QoiWriteFunc` that writes to the `std::FILE` passed as context.
+Status WriteQoiToFile(const void *data, std::size_t size, void *context);
+
+// Writes an image to a file. `rgba` and `stride` are as in `EncodeQoiRows`.
+Status WriteQoiFile(const char *filepath, const uchar *rgba,
+                    std::ptrdiff_t stride, uint w, uint h, uint channel_count);
+
+#endif  // RCOASTER_QOI_HPP
\ No newline at end of file
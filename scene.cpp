@@ -1,17 +1,25 @@
 #include "scene.hpp"
 
+#include <sys/mman.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/mat4x4.hpp>
+#include <string>
 #include <vector>
 
-static Status LoadSplines(const char *track_filepath,
-                          std::vector<std::vector<glm::vec3>> *splines) {
-  assert(track_filepath);
-  assert(splines);
+#include "profiler.hpp"
+#include "spline_io.hpp"
+#include "spline_simplify.hpp"
+#include "track_cache.hpp"
 
-  auto &splines_ = *splines;
+Status ReadTrackFile(const char *track_filepath,
+                     std::vector<std::string> *spline_filepaths) {
+  assert(track_filepath);
+  assert(spline_filepaths);
 
   std::FILE *track_file = std::fopen(track_filepath, "r");
   if (!track_file) {
@@ -28,11 +36,11 @@ static Status LoadSplines(const char *track_filepath,
     return kStatus_IoError;
   }
 
-  splines->resize(spline_count);
+  spline_filepaths->resize(spline_count);
 
   char filepath[4096];
   for (uint i = 0; i < spline_count; ++i) {
-    rc = std::fscanf(track_file, "%s", filepath);
+    rc = std::fscanf(track_file, "%4095s", filepath);
     if (rc < 1) {
       std::fprintf(stderr,
                    "Failed to read path of spline file from track file %s.\n",
@@ -40,132 +48,645 @@ static Status LoadSplines(const char *track_filepath,
       std::fclose(track_file);
       return kStatus_IoError;
     }
+    (*spline_filepaths)[i] = filepath;
+  }
 
-    FILE *file = std::fopen(filepath, "r");
-    if (!file) {
-      std::fprintf(stderr, "Failed to open spline file %s.\n", filepath);
-      std::fclose(track_file);
-      return kStatus_IoError;
+  std::fclose(track_file);
+
+  return kStatus_Ok;
+}
+
+// The part of the track made from one spline.
+struct TrackPiece {
+  const char *spline_filepath;
+  uint ctrl_point_count;
+  // After simplification, and the largest distance between the curve and the
+  // control points it removed.
+  uint simplified_ctrl_point_count;
+  float max_deviation;
+  // Kept to be evaluated with the other pieces if the track is tessellated to
+  // a vertex budget.
+  std::vector<glm::vec3> ctrl_points;
+  Status status;
+  // In the scratch arena until the camera path is joined, then a view into it.
+  VertexList1P1T1N1B camspl;
+  Mesh left_rail;
+  Mesh right_rail;
+  VertexList1P1UV crossties;
+};
+
+struct MakeTrackPiecesArgs {
+  const SceneConfig *cfg;
+  TrackPiece *pieces;
+  // The pieces are made in it, and joined out of it.
+  Arena *scratch_arena;
+};
+
+static void EvalTrackPieces(uint begin, uint end, void *arg) {
+  assert(arg);
+
+  MakeTrackPiecesArgs *args = (MakeTrackPiecesArgs *)arg;
+  for (uint i = begin; i < end; ++i) {
+    TrackPiece *piece = &args->pieces[i];
+
+    Spline spline;
+    {
+      ProfileScope scope(kProfilePhase_LoadSplines);
+      piece->status =
+          LoadSplineFile(piece->spline_filepath, args->cfg->pool, &spline);
+    }
+    if (piece->status != kStatus_Ok) {
+      continue;
     }
+    piece->ctrl_point_count = spline.ctrl_points.size();
 
-    uint ctrl_point_count;
-    uint type;
-    rc = std::fscanf(file, "%u %u", &ctrl_point_count, &type);
-    if (rc < 1) {
-      std::fprintf(stderr,
-                   "Failed to read control point count and spline type from "
-                   "spline file %s.\n",
-                   filepath);
-      std::fclose(file);
-      std::fclose(track_file);
-      return kStatus_IoError;
+    if (args->cfg->spline_simplify_tolerance > 0) {
+      ProfileScope scope(kProfilePhase_LoadSplines);
+      SimplifySplineCtrlPoints(args->cfg->spline_simplify_tolerance,
+                               args->cfg->pool, &spline.ctrl_points,
+                               &piece->max_deviation);
+    }
+    piece->simplified_ctrl_point_count = spline.ctrl_points.size();
+
+    if (args->cfg->max_camera_path_vertex_count != 0) {
+      piece->ctrl_points.swap(spline.ctrl_points);
+      continue;
     }
 
-    splines_[i].resize(ctrl_point_count);
+    ProfileScope scope(kProfilePhase_SplineEval);
+    EvalCatmullRomSpline(spline.ctrl_points.data(),
+                         piece->simplified_ctrl_point_count,
+                         args->cfg->max_spline_segment_len,
+                         args->scratch_arena, &piece->camspl.positions,
+                         &piece->camspl.tangents, &piece->camspl.count);
+  }
+}
+
+static void MakeTrackPieceModels(uint begin, uint end, void *arg) {
+  assert(arg);
 
-    uint j = 0;
-    while ((rc = std::fscanf(file, "%f %f %f", &splines_[i][j].x,
-                             &splines_[i][j].y, &splines_[i][j].z)) > 0) {
-      ++j;
+  MakeTrackPiecesArgs *args = (MakeTrackPiecesArgs *)arg;
+  const SceneConfig *cfg = args->cfg;
+  for (uint i = begin; i < end; ++i) {
+    TrackPiece *piece = &args->pieces[i];
+    // Rails and crossties span at least two vertices.
+    if (piece->camspl.count < 2) {
+      continue;
     }
-    if (rc == 0) {
-      std::fprintf(stderr,
-                   "Failed to read control point from spline file %s.\n",
-                   filepath);
-      std::fclose(file);
-      std::fclose(track_file);
-      return kStatus_IoError;
+
+    {
+      ProfileScope scope(kProfilePhase_Rails);
+      MakeRails(&piece->camspl, &cfg->rails_color, cfg->rails_head_w,
+                cfg->rails_head_h, cfg->rails_web_w, cfg->rails_web_h,
+                cfg->rails_gauge, cfg->rails_pos_offset_in_camspl_norm_dir,
+                args->scratch_arena, &piece->left_rail, &piece->right_rail);
     }
 
-    std::fclose(file);
+    ProfileScope scope(kProfilePhase_Crossties);
+    MakeCrossties(&piece->camspl, cfg->crossties_separation_dist,
+                  cfg->crossties_pos_offset_in_camspl_norm_dir,
+                  args->scratch_arena, args->scratch_arena, &piece->crossties);
   }
+}
 
-  std::fclose(track_file);
+/*
+Joins the camera paths of the pieces in order into one, along which the camera
+moves, and points the camera path of each piece into it.
+
+The reference frames are propagated along the joined path, so that they are
+continuous where one piece ends and the next begins.
+*/
+static void JoinCameraPaths(TrackPiece *pieces, uint piece_count,
+                            Arena *arena, VertexList1P1T1N1B *camspl) {
+  assert(pieces);
+  assert(arena);
+  assert(camspl);
+
+  std::size_t count = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    count += pieces[i].camspl.count;
+  }
+
+  camspl->count = count;
+  camspl->positions = ArenaAllocArray<glm::vec3>(arena, count);
+  camspl->tangents = ArenaAllocArray<glm::vec3>(arena, count);
+  camspl->normals = ArenaAllocArray<glm::vec3>(arena, count);
+  camspl->binormals = ArenaAllocArray<glm::vec3>(arena, count);
+
+  std::size_t offset = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    VertexList1P1T1N1B *piece_camspl = &pieces[i].camspl;
+    std::copy_n(piece_camspl->positions, piece_camspl->count,
+                camspl->positions + offset);
+    std::copy_n(piece_camspl->tangents, piece_camspl->count,
+                camspl->tangents + offset);
+
+    piece_camspl->positions = camspl->positions + offset;
+    piece_camspl->tangents = camspl->tangents + offset;
+    piece_camspl->normals = camspl->normals + offset;
+    piece_camspl->binormals = camspl->binormals + offset;
+    offset += piece_camspl->count;
+  }
+
+  ProfileScope scope(kProfilePhase_Frames);
+  CalcCameraOrientation(camspl->tangents, count, camspl->normals,
+                        camspl->binormals);
+}
+
+// Joins the rails of the pieces in order into one pair of rails.
+static void JoinRails(const TrackPiece *pieces, uint piece_count, Arena *arena,
+                      Mesh *left_rail, Mesh *right_rail) {
+  assert(pieces);
+  assert(arena);
+  assert(left_rail);
+  assert(right_rail);
+
+  Mesh *rails[] = {left_rail, right_rail};
+  for (uint r = 0; r < 2; ++r) {
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+    for (uint i = 0; i < piece_count; ++i) {
+      const Mesh *piece_rail = r == 0 ? &pieces[i].left_rail
+                                      : &pieces[i].right_rail;
+      vertex_count += piece_rail->vl1p1c.count;
+      index_count += piece_rail->index_count;
+    }
+
+    Mesh *rail = rails[r];
+    rail->vl1p1c.count = vertex_count;
+    rail->vl1p1c.positions = ArenaAllocArray<glm::vec3>(arena, vertex_count);
+    rail->vl1p1c.colors = ArenaAllocArray<glm::vec4>(arena, vertex_count);
+    rail->index_count = index_count;
+    rail->indices = ArenaAllocArray<uint>(arena, index_count);
+
+    std::size_t vertex_offset = 0;
+    std::size_t index_offset = 0;
+    for (uint i = 0; i < piece_count; ++i) {
+      const Mesh *piece_rail = r == 0 ? &pieces[i].left_rail
+                                      : &pieces[i].right_rail;
+      std::copy_n(piece_rail->vl1p1c.positions, piece_rail->vl1p1c.count,
+                  rail->vl1p1c.positions + vertex_offset);
+      std::copy_n(piece_rail->vl1p1c.colors, piece_rail->vl1p1c.count,
+                  rail->vl1p1c.colors + vertex_offset);
+      for (std::size_t j = 0; j < piece_rail->index_count; ++j) {
+        rail->indices[index_offset + j] =
+            piece_rail->indices[j] + vertex_offset;
+      }
+      vertex_offset += piece_rail->vl1p1c.count;
+      index_offset += piece_rail->index_count;
+    }
+  }
+}
+
+// Joins the crossties of the pieces in order.
+static void JoinCrossties(const TrackPiece *pieces, uint piece_count,
+                          Arena *arena, VertexList1P1UV *crossties) {
+  assert(pieces);
+  assert(arena);
+  assert(crossties);
+
+  std::size_t count = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    count += pieces[i].crossties.count;
+  }
+
+  crossties->count = count;
+  crossties->positions = ArenaAllocArray<glm::vec3>(arena, count);
+  crossties->uv = ArenaAllocArray<glm::vec2>(arena, count);
+
+  std::size_t offset = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    const VertexList1P1UV *piece_crossties = &pieces[i].crossties;
+    std::copy_n(piece_crossties->positions, piece_crossties->count,
+                crossties->positions + offset);
+    std::copy_n(piece_crossties->uv, piece_crossties->count,
+                crossties->uv + offset);
+    offset += piece_crossties->count;
+  }
+}
+
+/*
+Makes the rails and crossties of the pieces from their camera paths in the
+scratch arena, and joins them into the meshes of the scene in `arena`.
+*/
+static void MakeTrackModels(const SceneConfig *cfg, TrackPiece *pieces,
+                            uint piece_count, Arena *scratch_arena,
+                            Arena *arena, Scene *scene) {
+  assert(cfg);
+  assert(pieces);
+  assert(scratch_arena);
+  assert(arena);
+  assert(scene);
+
+  MakeTrackPiecesArgs args = {cfg, pieces, scratch_arena};
+  ParallelFor(cfg->pool, piece_count, 1, MakeTrackPieceModels, &args);
+
+  JoinRails(pieces, piece_count, arena, scene->left_rail.mesh,
+            scene->right_rail.mesh);
+  JoinCrossties(pieces, piece_count, arena, &scene->crossties.mesh->vl1p1uv);
+
+  // The rails share their vertex and index buffers, left rail first.
+  for (std::size_t i = 0; i < scene->right_rail.mesh->index_count; ++i) {
+    scene->right_rail.mesh->indices[i] += scene->left_rail.mesh->vl1p1c.count;
+  }
+}
+
+/*
+Evaluates the splines of the pieces together, so that the vertex budget of the
+track goes where the curves need it most, whichever splines those are in.
+*/
+static Status EvalTrackPiecesWithBudget(const SceneConfig *cfg,
+                                        TrackPiece *pieces, uint piece_count,
+                                        Arena *scratch_arena,
+                                        float *max_error) {
+  assert(cfg);
+  assert(pieces);
+  assert(scratch_arena);
+  assert(max_error);
+
+  ProfileScope scope(kProfilePhase_SplineEval);
+
+  std::vector<const glm::vec3 *> ctrl_points(piece_count);
+  std::vector<uint> ctrl_point_counts(piece_count);
+  std::size_t segment_count = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    ctrl_points[i] = pieces[i].ctrl_points.data();
+    ctrl_point_counts[i] = pieces[i].ctrl_points.size();
+    if (ctrl_point_counts[i] > 3) {
+      segment_count += ctrl_point_counts[i] - 3;
+    }
+  }
+
+  if (2 * segment_count > cfg->max_camera_path_vertex_count) {
+    std::fprintf(stderr,
+                 "Failed to tessellate the track into %zu camera path "
+                 "vertices, as its %zu spline segments take 2 each.\n",
+                 cfg->max_camera_path_vertex_count, segment_count);
+    return kStatus_UnspecifiedError;
+  }
+
+  std::vector<glm::vec3 *> positions(piece_count);
+  std::vector<glm::vec3 *> tangents(piece_count);
+  std::vector<std::size_t> vertex_counts(piece_count);
+  EvalCatmullRomSplinesWithBudget(
+      ctrl_points.data(), ctrl_point_counts.data(), piece_count,
+      cfg->max_camera_path_vertex_count, scratch_arena, positions.data(),
+      tangents.data(), vertex_counts.data(), max_error);
+
+  for (uint i = 0; i < piece_count; ++i) {
+    pieces[i].camspl.positions = positions[i];
+    pieces[i].camspl.tangents = tangents[i];
+    pieces[i].camspl.count = vertex_counts[i];
+  }
 
   return kStatus_Ok;
 }
 
-Status MakeScene(const SceneConfig *cfg, Scene *scene) {
+/*
+Prints what a track tessellated to a vertex budget costs: the bytes of its
+camera path, which stays in memory, and of the vertex and index buffers of its
+rails and crossties. The rails of a streamed track are counted as if they were
+made at once, and its crossties are only made as it streams.
+*/
+static void PrintTrackBudget(const TrackPiece *pieces, uint piece_count,
+                             float max_error, const Scene *scene) {
+  assert(pieces);
+  assert(scene);
+
+  static constexpr double kMib = 1024.0 * 1024.0;
+
+  std::size_t camspl_vertex_count = scene->camspl.mesh->vl1p1t1n1b.count;
+  std::fprintf(
+      stderr,
+      "Tessellated the track into %zu camera path vertices (%.1f MiB), "
+      "within %g of its splines.\n",
+      camspl_vertex_count,
+      camspl_vertex_count * 4 * sizeof(glm::vec3) / kMib, max_error);
+
+  std::size_t rail_vertex_count = 0;
+  std::size_t rail_index_count = 0;
+  if (scene->is_track_streamed) {
+    // 8 vertices per rail per camera path vertex, and 48 indices per rail per
+    // camera path segment, of each piece that has rails.
+    for (uint i = 0; i < piece_count; ++i) {
+      std::size_t count = pieces[i].camspl.count;
+      if (count >= 2) {
+        rail_vertex_count += 16 * count;
+        rail_index_count += 96 * (count - 1);
+      }
+    }
+  } else {
+    rail_vertex_count = scene->left_rail.mesh->vl1p1c.count +
+                        scene->right_rail.mesh->vl1p1c.count;
+    rail_index_count = scene->left_rail.mesh->index_count +
+                       scene->right_rail.mesh->index_count;
+  }
+  std::fprintf(
+      stderr, "Rails: %zu vertices (%.1f MiB), %zu indices (%.1f MiB).\n",
+      rail_vertex_count,
+      rail_vertex_count * (sizeof(glm::vec3) + sizeof(glm::vec4)) / kMib,
+      rail_index_count, rail_index_count * sizeof(uint) / kMib);
+
+  if (scene->is_track_streamed) {
+    std::fprintf(stderr, "Crossties: made as the track streams.\n");
+  } else {
+    std::size_t crosstie_vertex_count = scene->crossties.mesh->vl1p1uv.count;
+    std::fprintf(
+        stderr, "Crossties: %zu vertices (%.1f MiB).\n", crosstie_vertex_count,
+        crosstie_vertex_count * (sizeof(glm::vec3) + sizeof(glm::vec2)) / kMib);
+  }
+}
+
+/*
+Makes the camera path, rails and crossties from the splines of the track.
+
+Each spline is loaded and evaluated, and its rails and crossties are made,
+concurrently on the thread pool. The camera moves along the splines in the
+order of the track file.
+*/
+static Status MakeTrack(const SceneConfig *cfg,
+                        const std::vector<std::string> *spline_filepaths,
+                        Arena *scratch_arena, Scene *scene) {
   assert(cfg);
+  assert(cfg->pool);
+  assert(spline_filepaths);
+  assert(scratch_arena);
   assert(scene);
 
-  std::vector<std::vector<glm::vec3>> splines;
-  Status status = LoadSplines(cfg->track_filepath, &splines);
+  uint piece_count = spline_filepaths->size();
+  std::vector<TrackPiece> pieces(piece_count);
+  for (uint i = 0; i < piece_count; ++i) {
+    pieces[i] = {};
+    pieces[i].spline_filepath = (*spline_filepaths)[i].c_str();
+  }
+
+  MakeTrackPiecesArgs args = {cfg, pieces.data(), scratch_arena};
+  ParallelFor(cfg->pool, piece_count, 1, EvalTrackPieces, &args);
+
+  Status status = kStatus_Ok;
+  for (uint i = 0; i < piece_count; ++i) {
+    if (pieces[i].status != kStatus_Ok) {
+      status = pieces[i].status;
+    }
+  }
   if (status != kStatus_Ok) {
     std::fprintf(stderr, "Could not load splines.\n");
     return status;
   }
 
+  float max_error = 0;
+  if (cfg->max_camera_path_vertex_count != 0) {
+    status = EvalTrackPiecesWithBudget(cfg, pieces.data(), piece_count,
+                                       scratch_arena, &max_error);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+  }
+
+  std::size_t vertex_count = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    vertex_count += pieces[i].camspl.count;
+  }
+  if (vertex_count == 0) {
+    std::fprintf(stderr, "Splines of the track have no segments.\n");
+    return kStatus_UnspecifiedError;
+  }
+
   if (cfg->is_verbose) {
-    std::printf("Loaded spline count: %lu\n", splines.size());
-    for (uint i = 0; i < splines.size(); ++i) {
-      std::printf("Control point count in spline %u: %lu\n", i,
-                  splines[i].size());
+    std::printf("Loaded spline count: %u\n", piece_count);
+    for (uint i = 0; i < piece_count; ++i) {
+      std::printf("Control point count in spline %u: %u\n", i,
+                  pieces[i].ctrl_point_count);
+    }
+
+    if (cfg->spline_simplify_tolerance > 0) {
+      std::size_t ctrl_point_count = 0;
+      std::size_t simplified_ctrl_point_count = 0;
+      float max_deviation = 0;
+      for (uint i = 0; i < piece_count; ++i) {
+        std::printf(
+            "Simplified spline %u from %u to %u control points, within %g "
+            "of them.\n",
+            i, pieces[i].ctrl_point_count,
+            pieces[i].simplified_ctrl_point_count, pieces[i].max_deviation);
+        ctrl_point_count += pieces[i].ctrl_point_count;
+        simplified_ctrl_point_count += pieces[i].simplified_ctrl_point_count;
+        max_deviation = std::max(max_deviation, pieces[i].max_deviation);
+      }
+      std::printf(
+          "Simplified the splines from %zu to %zu control points (%.1f%%), "
+          "within %g of them.\n",
+          ctrl_point_count, simplified_ctrl_point_count,
+          ctrl_point_count ? 100.0 * simplified_ctrl_point_count /
+                                 ctrl_point_count
+                           : 100.0,
+          max_deviation);
     }
   }
 
-  // TODO: Support for multiple splines.
-  assert(splines.size() == 1);
-  scene->camspl.mesh = new Mesh;
-  scene->camspl.mesh->vertex_list_type = kVertexListType_1P1T1N1B;
-  MakeCameraPath(splines[0].data(), splines[0].size(),
-                 cfg->max_spline_segment_len, &scene->camspl.mesh->vl1p1t1n1b);
+  JoinCameraPaths(pieces.data(), piece_count, &scene->arena,
+                  &scene->camspl.mesh->vl1p1t1n1b);
+  scene->piece_vertex_counts =
+      ArenaAllocArray<std::size_t>(&scene->arena, piece_count);
+  for (uint i = 0; i < piece_count; ++i) {
+    scene->piece_vertex_counts[i] = pieces[i].camspl.count;
+  }
+  scene->piece_count = piece_count;
 
-  scene->ground.mesh = new Mesh;
-  MakeAxisAlignedXzSquarePlane(cfg->aabb_side_len, cfg->ground_tex_repeat_count,
-                               scene->ground.mesh);
-  scene->ground.world_transform =
-      glm::translate(glm::mat4(1), cfg->ground_position);
+  // Both rails are drawn from one index buffer, with 8 vertices per rail per
+  // camera path vertex.
+  std::size_t rail_vertex_count = 16 * vertex_count;
+  scene->is_track_streamed = cfg->is_track_streamed ||
+                             rail_vertex_count > cfg->max_batch_vertex_count;
+  if (scene->is_track_streamed) {
+    if (!cfg->is_track_streamed && cfg->is_verbose) {
+      std::printf(
+          "Streaming the track in batches, as its rails have %zu vertices.\n",
+          rail_vertex_count);
+    }
+    *scene->left_rail.mesh = {};
+    scene->left_rail.mesh->vertex_list_type = kVertexListType_1P1C;
+    *scene->right_rail.mesh = {};
+    scene->right_rail.mesh->vertex_list_type = kVertexListType_1P1C;
+    *scene->crossties.mesh = {};
+    scene->crossties.mesh->vertex_list_type = kVertexListType_1P1UV;
+  } else {
+    MakeTrackModels(cfg, pieces.data(), piece_count, scratch_arena,
+                    &scene->model_arena, scene);
+  }
 
-  scene->sky.mesh = new Mesh;
-  MakeAxisAlignedCube(cfg->aabb_side_len, cfg->sky_tex_repeat_count,
-                      scene->sky.mesh);
-  scene->sky.world_transform = glm::translate(glm::mat4(1), cfg->sky_position);
+  if (cfg->max_camera_path_vertex_count != 0) {
+    PrintTrackBudget(pieces.data(), piece_count, max_error, scene);
+  }
 
-  scene->left_rail.mesh = new Mesh;
+  return kStatus_Ok;
+}
+
+void RemakeSceneTrackModels(const SceneConfig *cfg,
+                            const std::size_t *piece_vertex_counts,
+                            uint piece_count, Arena *arena, Scene *scene) {
+  assert(cfg);
+  assert(piece_vertex_counts);
+  assert(arena);
+  assert(scene);
+
+  const VertexList1P1T1N1B *camspl = &scene->camspl.mesh->vl1p1t1n1b;
+  std::vector<TrackPiece> pieces(piece_count);
+  std::size_t begin = 0;
+  for (uint i = 0; i < piece_count; ++i) {
+    std::size_t end = begin + piece_vertex_counts[i];
+    pieces[i] = {};
+    pieces[i].camspl = SliceCameraPath(camspl, begin, end);
+    begin = end;
+  }
+  assert(begin == camspl->count);
+
+  MakeTrackModels(cfg, pieces.data(), piece_count, arena, arena, scene);
+}
+
+Status MakeSceneTrack(const SceneConfig *cfg, Scene *scene) {
+  assert(cfg);
+  assert(scene);
+
+  scene->track_cache_data = NULL;
+  scene->track_cache_size = 0;
+  scene->piece_vertex_counts = NULL;
+  scene->piece_count = 0;
+
+  std::vector<std::string> spline_filepaths;
+  Status status = ReadTrackFile(cfg->track_filepath, &spline_filepaths);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Could not load splines.\n");
+    return status;
+  }
+
+  scene->camspl.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  *scene->camspl.mesh = {};
+  scene->camspl.mesh->vertex_list_type = kVertexListType_1P1T1N1B;
+  scene->left_rail.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  *scene->left_rail.mesh = {};
   scene->left_rail.mesh->vertex_list_type = kVertexListType_1P1C;
-  scene->right_rail.mesh = new Mesh;
+  scene->right_rail.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  *scene->right_rail.mesh = {};
   scene->right_rail.mesh->vertex_list_type = kVertexListType_1P1C;
-  MakeRails(&scene->camspl.mesh->vl1p1t1n1b, &cfg->rails_color,
-            cfg->rails_head_w, cfg->rails_head_h, cfg->rails_web_w,
-            cfg->rails_web_h, cfg->rails_gauge,
-            cfg->rails_pos_offset_in_camspl_norm_dir, scene->left_rail.mesh,
-            scene->right_rail.mesh);
+  scene->crossties.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  *scene->crossties.mesh = {};
+  scene->crossties.mesh->vertex_list_type = kVertexListType_1P1UV;
+
+  int is_cached = 0;
+  std::uint64_t key = 0;
+  int is_cache_enabled = !cfg->is_track_streamed && !cfg->is_track_editable &&
+                         cfg->track_cache_dir && cfg->track_cache_dir[0];
+  if (is_cache_enabled) {
+    ProfileScope scope(kProfilePhase_TrackCache);
+    status = TrackCacheKey(cfg, &spline_filepaths, &key);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+    // A cache file that fails to open is treated as missing.
+    status = OpenCachedTrack(cfg->track_cache_dir, key, scene, &is_cached);
+    if (status != kStatus_Ok) {
+      is_cached = 0;
+    }
+  }
+
+  if (is_cached) {
+    if (cfg->is_verbose) {
+      std::printf("Loaded track from the track cache.\n");
+    }
+  } else {
+    // Freed in bulk once the pieces of the track have been joined.
+    Arena scratch_arena;
+    InitArena(ARENA_DEFAULT_BLOCK_SIZE, cfg->is_arena_huge_page_backed,
+              &scratch_arena);
+    status = MakeTrack(cfg, &spline_filepaths, &scratch_arena, scene);
+    if (cfg->is_verbose) {
+      PrintArenaStats("Track scratch", &scratch_arena);
+    }
+    FreeArena(&scratch_arena);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+    if (is_cache_enabled && !scene->is_track_streamed) {
+      ProfileScope scope(kProfilePhase_TrackCache);
+      // The track is usable even if it could not be cached.
+      WriteCachedTrack(cfg->track_cache_dir, key, scene);
+    }
+  }
+
   scene->left_rail.world_transform =
       glm::translate(glm::mat4(1), cfg->rails_position);
   scene->right_rail.world_transform =
       glm::translate(glm::mat4(1), cfg->rails_position);
-
-  scene->crossties.mesh = new Mesh;
-  scene->crossties.mesh->vertex_list_type = kVertexListType_1P1UV;
-  MakeCrossties(&scene->camspl.mesh->vl1p1t1n1b, cfg->crossties_separation_dist,
-                cfg->crossties_pos_offset_in_camspl_norm_dir,
-                &scene->crossties.mesh->vl1p1uv);
   scene->crossties.world_transform =
       glm::translate(glm::mat4(1), cfg->crossties_position);
 
   return kStatus_Ok;
 }
 
-void FreeModelVertices(Scene *scene) {
+void MakeSceneScenery(const SceneConfig *cfg, Scene *scene) {
+  assert(cfg);
   assert(scene);
 
-  delete[] scene->ground.mesh->vl1p1uv.positions;
-  delete[] scene->ground.mesh->vl1p1uv.uv;
-  delete[] scene->ground.mesh->indices;
+  ProfileScope scope(kProfilePhase_Scenery);
 
-  delete[] scene->sky.mesh->vl1p1uv.positions;
-  delete[] scene->sky.mesh->vl1p1uv.uv;
-  delete[] scene->sky.mesh->indices;
+  scene->ground.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  MakeAxisAlignedXzSquarePlane(cfg->aabb_side_len,
+                               cfg->ground_tex_repeat_count,
+                               &scene->model_arena, scene->ground.mesh);
+  scene->ground.world_transform =
+      glm::translate(glm::mat4(1), cfg->ground_position);
 
-  delete[] scene->crossties.mesh->vl1p1uv.positions;
-  delete[] scene->crossties.mesh->vl1p1uv.uv;
+  scene->sky.mesh = ArenaAllocArray<Mesh>(&scene->arena, 1);
+  MakeAxisAlignedCube(cfg->aabb_side_len, cfg->sky_tex_repeat_count,
+                      &scene->model_arena, scene->sky.mesh);
+  scene->sky.world_transform = glm::translate(glm::mat4(1), cfg->sky_position);
+}
 
-  delete[] scene->left_rail.mesh->vl1p1c.positions;
-  delete[] scene->left_rail.mesh->vl1p1c.colors;
-  delete[] scene->left_rail.mesh->indices;
+void InitScene(const SceneConfig *cfg, Scene *scene) {
+  assert(cfg);
+  assert(scene);
 
-  delete[] scene->right_rail.mesh->vl1p1c.positions;
-  delete[] scene->right_rail.mesh->vl1p1c.colors;
-  delete[] scene->right_rail.mesh->indices;
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, cfg->is_arena_huge_page_backed,
+            &scene->arena);
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, cfg->is_arena_huge_page_backed,
+            &scene->model_arena);
+  scene->is_track_streamed = 0;
+  scene->piece_vertex_counts = NULL;
+  scene->piece_count = 0;
+  scene->track_cache_data = NULL;
+  scene->track_cache_size = 0;
+}
+
+Status MakeScene(const SceneConfig *cfg, Scene *scene) {
+  assert(cfg);
+  assert(scene);
+
+  InitScene(cfg, scene);
+  Status status = MakeSceneTrack(cfg, scene);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+  MakeSceneScenery(cfg, scene);
+
+  return kStatus_Ok;
+}
+
+void FreeModelVertices(Scene *scene) {
+  assert(scene);
+
+  // The arrays of a cached track stay mapped along with the camera path.
+  FreeArena(&scene->model_arena);
+}
+
+void FreeScene(Scene *scene) {
+  assert(scene);
+
+  FreeArena(&scene->model_arena);
+  FreeArena(&scene->arena);
+  if (scene->track_cache_data) {
+    munmap(scene->track_cache_data, scene->track_cache_size);
+    scene->track_cache_data = NULL;
+    scene->track_cache_size = 0;
+  }
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #ifndef RCOASTER_SCENE_HPP
 #define RCOASTER_SCENE_HPP
 
+#include <cstddef>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <string>
+#include <vector>
 
+#include "arena.hpp"
 #include "meshes.hpp"
 #include "status.hpp"
+#include "thread_pool.hpp"
 #include "types.hpp"
 
 struct Entity {
@@ -21,11 +26,51 @@ struct Scene {
   Entity crossties;
   Entity left_rail;
   Entity right_rail;
+  // Whether the rails and crossties were left to be streamed, either as
+  // configured or because they have too many vertices to draw in one batch.
+  int is_track_streamed;
+  // Camera path vertices of each spline of the track, in the order of the
+  // track file, along each of which rails and crossties are made on their
+  // own. Null if the track was mapped from the track cache.
+  std::size_t* piece_vertex_counts;
+  uint piece_count;
+  // The meshes and the camera path, which live as long as the scene.
+  Arena arena;
+  // Vertices of the other models, which are freed once they have been
+  // uploaded.
+  Arena model_arena;
+  // Mapping of the track cache file that the camera path, rails and crossties
+  // point into, or null if they were made.
+  void* track_cache_data;
+  std::size_t track_cache_size;
 };
 
 struct SceneConfig {
   const char* track_filepath;
+  // Loads the splines and makes their parts of the track in parallel.
+  ThreadPool* pool;
+  // Directory of the track cache, or empty to make the track every time.
+  const char* track_cache_dir;
+  // Makes only the camera path, for the rails and crossties to be streamed.
+  // The track cache is not used.
+  int is_track_streamed;
+  // The camera path may be edited in place, so it is not mapped from the
+  // track cache, which is not used.
+  int is_track_editable;
+  // Tracks whose rails have more vertices than this are streamed in batches
+  // of at most this many vertices, which keeps their indices 32-bit and
+  // their buffers within what the driver can allocate.
+  std::size_t max_batch_vertex_count;
+  // Control points that the curve of their spline can stay this close to
+  // without are removed as the splines are loaded. Zero keeps every one.
+  float spline_simplify_tolerance;
   float max_spline_segment_len;
+  // If nonzero, the splines are tessellated into at most this many camera
+  // path vertices, placed by how far the curves stray from the line segments
+  // between them, instead of by `max_spline_segment_len`.
+  std::size_t max_camera_path_vertex_count;
+  // Backs the arenas of the scene with transparent huge pages.
+  int is_arena_huge_page_backed;
   int is_verbose;
 
   float aabb_side_len;
@@ -50,8 +95,38 @@ struct SceneConfig {
   float crossties_pos_offset_in_camspl_norm_dir;
 };
 
+Status ReadTrackFile(const char* track_filepath,
+                     std::vector<std::string>* spline_filepaths);
+
+// Must be called before the scene is made.
+void InitScene(const SceneConfig* cfg, Scene* scene);
+
 Status MakeScene(const SceneConfig* cfg, Scene* scene);
 
+// Makes the camera path, rails and crossties of the scene.
+Status MakeSceneTrack(const SceneConfig* cfg, Scene* scene);
+
+// Makes the ground and sky of the scene. Independent of the track, so it may
+// run concurrently with `MakeSceneTrack`.
+void MakeSceneScenery(const SceneConfig* cfg, Scene* scene);
+
+/*
+Makes the rails and crossties of the scene again from its camera path, as
+`MakeSceneTrack` made them, in `arena`.
+
+Input Parameters:
+- piece_vertex_counts: camera path vertices of each spline of the track, in
+order
+*/
+void RemakeSceneTrackModels(const SceneConfig* cfg,
+                            const std::size_t* piece_vertex_counts,
+                            uint piece_count, Arena* arena, Scene* scene);
+
+// Frees the vertices of the models other than the camera path.
 void FreeModelVertices(Scene* scene);
 
+// Frees everything the scene was made of at once, so that it can be made
+// again.
+void FreeScene(Scene* scene);
+
 #endif  // RCOASTER_SCENE_HPP
\ No newline at end of file
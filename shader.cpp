@@ -6,6 +6,8 @@
 #include <cstdio>
 #include <cstring>
 
+#include "program_cache.hpp"
+
 #define INFO_LOG_BUFFER_SIZE 512
 
 const char *const kShaderTypeStrings[kShaderType__Count] = {"vertex",
@@ -91,71 +93,148 @@ Status LoadFile(const char *path, std::string *content) {
   return kStatus_Ok;
 }
 
-Status MakeShaderObj(const std::string *src, ShaderType type, GLuint *name) {
-  assert(src);
-  assert(name);
+// Reports why a program failed to link, including the shaders that failed to
+// compile.
+static void PrintBuildErrors(const ShaderProgBuild *build) {
+  assert(build);
+
+  GLchar info_log[INFO_LOG_BUFFER_SIZE];
+
+  for (int i = 0; i < kShaderType__Count; ++i) {
+    GLint status = GL_FALSE;
+    glGetShaderiv(build->shader_obj_names[i], GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+      std::fprintf(stderr, "Failed to compile shader file %s.\n",
+                   build->filepaths[i]);
+      glGetShaderInfoLog(build->shader_obj_names[i], INFO_LOG_BUFFER_SIZE, 0,
+                         info_log);
+      std::fprintf(stderr, "%s", info_log);
+    }
+  }
 
-  *name = glCreateShader(GlShaderType(type));
-  if (*name == 0) {
-    std::fprintf(stderr,
-                 "Failed to create GL shader object of type %s from file.\n",
-                 String(type));
-    return kStatus_GlError;
+  std::fprintf(stderr, "Failed to link program.\n");
+  glGetProgramInfoLog(build->name, INFO_LOG_BUFFER_SIZE, 0, info_log);
+  std::fprintf(stderr, "%s", info_log);
+}
+
+static void EnableParallelShaderCompile() {
+#ifdef linux
+  // Lets the implementation pick the number of compiler threads.
+  if (GLEW_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  } else if (GLEW_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
   }
+#endif
+}
 
-  const GLchar *const srcs[1] = {src->data()};
-  const GLint lens[1] = {(GLint)src->size()};
+Status BeginShaderProgs(const char *const (*filepaths)[kShaderType__Count],
+                        uint count, const char *cache_dir,
+                        ShaderProgBuilder *builder) {
+  assert(filepaths);
+  assert(builder);
 
-  glShaderSource(*name, 1, srcs, lens);
-  glCompileShader(*name);
+  builder->cache_dir = NULL;
+  if (cache_dir && cache_dir[0] != '\0' && IsProgramCacheSupported()) {
+    builder->cache_dir = cache_dir;
+  }
+  builder->cache_hit_count = 0;
+  builder->builds.assign(count, {});
 
-  GLint status = GL_FALSE;
-  glGetShaderiv(*name, GL_COMPILE_STATUS, &status);
-  if (status == GL_FALSE) {
-    std::fprintf(stderr, "Failed to compile shader.\n");
+  EnableParallelShaderCompile();
 
-    GLchar info_log[INFO_LOG_BUFFER_SIZE];
-    glGetShaderInfoLog(*name, INFO_LOG_BUFFER_SIZE, 0, info_log);
-    std::fprintf(stderr, "%s", info_log);
+  for (uint i = 0; i < count; ++i) {
+    ShaderProgBuild *build = &builder->builds[i];
+    build->filepaths = filepaths[i];
 
-    return kStatus_GlError;
-  }
+    std::string sources[kShaderType__Count];
+    for (int j = 0; j < kShaderType__Count; ++j) {
+      Status status = LoadFile(build->filepaths[j], &sources[j]);
+      if (status != kStatus_Ok) {
+        return status;
+      }
+    }
 
-  return kStatus_Ok;
-}
+    build->name = glCreateProgram();
+    if (build->name == 0) {
+      std::fprintf(stderr, "Failed to create GL program.\n");
+      return kStatus_GlError;
+    }
 
-Status MakeShaderProg(const std::vector<GLuint> *shader_obj_names,
-                      GLuint *name) {
-  assert(shader_obj_names);
-  assert(name);
+    if (builder->cache_dir) {
+      build->cache_key = ProgramCacheKey(sources, kShaderType__Count);
+      // A cache file that fails to load is treated as missing.
+      LoadCachedProgram(builder->cache_dir, build->cache_key, build->name,
+                        &build->is_cached);
+      if (build->is_cached) {
+        ++builder->cache_hit_count;
+        continue;
+      }
+    }
 
-  *name = glCreateProgram();
-  if (*name == 0) {
-    std::fprintf(stderr, "Failed to create GL program.\n");
-    return kStatus_GlError;
+    for (int j = 0; j < kShaderType__Count; ++j) {
+      GLuint name = glCreateShader(GlShaderType((ShaderType)j));
+      if (name == 0) {
+        std::fprintf(stderr, "Failed to create GL shader object of type %s.\n",
+                     String((ShaderType)j));
+        return kStatus_GlError;
+      }
+      build->shader_obj_names[j] = name;
+
+      const GLchar *const srcs[1] = {sources[j].data()};
+      const GLint lens[1] = {(GLint)sources[j].size()};
+      glShaderSource(name, 1, srcs, lens);
+      glCompileShader(name);
+    }
   }
 
-  for (GLuint n : *shader_obj_names) {
-    glAttachShader(*name, n);
+  for (ShaderProgBuild &build : builder->builds) {
+    if (build.is_cached) {
+      continue;
+    }
+    for (GLuint n : build.shader_obj_names) {
+      glAttachShader(build.name, n);
+    }
+    if (builder->cache_dir) {
+      glProgramParameteri(build.name, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+    }
+    glLinkProgram(build.name);
   }
 
-  glLinkProgram(*name);
+  return kStatus_Ok;
+}
 
-  GLint status;
-  glGetProgramiv(*name, GL_LINK_STATUS, &status);
-  if (status == GL_FALSE) {
-    std::fprintf(stderr, "Failed to link program.\n");
+Status FinishShaderProgs(ShaderProgBuilder *builder, GLuint *names) {
+  assert(builder);
+  assert(names);
 
-    GLchar info_log[INFO_LOG_BUFFER_SIZE];
-    glGetProgramInfoLog(*name, INFO_LOG_BUFFER_SIZE, 0, info_log);
-    std::fprintf(stderr, "%s", info_log);
+  for (std::size_t i = 0; i < builder->builds.size(); ++i) {
+    ShaderProgBuild *build = &builder->builds[i];
+    names[i] = build->name;
+    if (build->is_cached) {
+      continue;
+    }
 
-    return kStatus_GlError;
-  }
+    GLint status = GL_FALSE;
+    glGetProgramiv(build->name, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+      PrintBuildErrors(build);
+      return kStatus_GlError;
+    }
+
+    for (GLuint n : build->shader_obj_names) {
+      glDetachShader(build->name, n);
+      glDeleteShader(n);
+    }
 
-  for (GLuint n : *shader_obj_names) {
-    glDeleteShader(n);
+    if (builder->cache_dir) {
+      // The program is usable even if it could not be cached.
+      WriteCachedProgram(builder->cache_dir, build->cache_key, build->name);
+    }
   }
 
+  builder->builds.clear();
+
   return kStatus_Ok;
 }
\ No newline at end of file
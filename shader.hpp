@@ -1,11 +1,13 @@
 #ifndef RCOASTER_SHADER_HPP
 #define RCOASTER_SHADER_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "opengl.hpp"
 #include "status.hpp"
+#include "types.hpp"
 
 enum ShaderType {
   kShaderType_Vertex,
@@ -21,9 +23,45 @@ ShaderType FromFilepath(const char *path);
 
 Status LoadFile(const char *path, std::string *content);
 
-Status MakeShaderObj(const std::string *src, ShaderType type, GLuint *name);
+// A shader program built from one shader file of each type.
+struct ShaderProgBuild {
+  // Indexed by `ShaderType`.
+  const char *const *filepaths;
+  GLuint name;
+  GLuint shader_obj_names[kShaderType__Count];
+  std::uint64_t cache_key;
+  int is_cached;
+};
+
+/*
+Builds shader programs, loading them from the program cache if they are in it.
+
+The shaders of every program that is not cached are compiled and linked
+before the status of any is queried, so that implementations that compile in
+parallel (`GL_KHR_parallel_shader_compile`) build them concurrently and in the
+background until the programs are finished.
+*/
+struct ShaderProgBuilder {
+  // Null if programs are not cached.
+  const char *cache_dir;
+  uint cache_hit_count;
+  std::vector<ShaderProgBuild> builds;
+};
+
+/*
+Starts building shader programs.
+
+Input Parameters:
+- filepaths: the shader files of each program, which must outlive the builder
+- cache_dir: directory of the program cache, which must exist. Null or empty
+disables the cache, as does an OpenGL implementation without program binaries
+*/
+Status BeginShaderProgs(const char *const (*filepaths)[kShaderType__Count],
+                        uint count, const char *cache_dir,
+                        ShaderProgBuilder *builder);
 
-Status MakeShaderProg(const std::vector<GLuint> *shader_obj_names,
-                      GLuint *name);
+// Waits for the programs to be linked and caches the ones that were built
+// from source.
+Status FinishShaderProgs(ShaderProgBuilder *builder, GLuint *names);
 
 #endif  // RCOASTER_SHADER_HPP
\ No newline at end of file
@@ -2,8 +2,9 @@
 
 in vec2 frag_tex_coord;
 out vec4 color; 
-uniform sampler2D tex_img;
+uniform sampler2DArray tex_img;
+uniform int tex_layer;
 
 void main() {
-  color = texture(tex_img, frag_tex_coord);
+  color = texture(tex_img, vec3(frag_tex_coord, tex_layer));
 }
\ No newline at end of file
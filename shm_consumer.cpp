@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "cli.hpp"
+#include "shm_ring.hpp"
+#include "types.hpp"
+
+/*
+Reference consumer of the shared memory frame ring that `rcoaster` publishes
+recorded video to with `--shm-output`.
+
+Follows the ring from the newest frame and reads every frame in place. Reports
+the frames received, missed because the writer lapped the consumer, and torn
+while being read, along with the latency from capture to consumption.
+*/
+
+struct ConsumerConfig {
+  // Zero consumes frames until the timeout.
+  uint frame_count;
+  // Stop after this long without a new frame.
+  float timeout_sec;
+  int is_verbose;
+};
+
+struct ConsumerStats {
+  std::uint64_t received_count;
+  std::uint64_t missed_count;
+  std::uint64_t torn_count;
+  double total_latency_msec;
+  double max_latency_msec;
+};
+
+static std::int64_t NowNsec() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+// Reads every byte of the frame, as a real consumer would.
+static std::uint32_t Checksum(const uchar *pixels, std::size_t size) {
+  assert(pixels);
+
+  // FNV-1a.
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ pixels[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static Status OpenRing(const char *name, float timeout_sec, ShmRing *ring) {
+  assert(name);
+  assert(ring);
+
+  // The producer may not have created the ring yet.
+  std::int64_t deadline = NowNsec() + (std::int64_t)(timeout_sec * 1e9);
+  for (;;) {
+    Status status = OpenShmRing(name, ring);
+    if (status == kStatus_Ok || NowNsec() >= deadline) {
+      return status;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+static void Consume(const ConsumerConfig *cfg, const ShmRing *ring,
+                    ConsumerStats *stats) {
+  assert(cfg);
+  assert(ring);
+  assert(stats);
+
+  const ShmRingHeader *header = ring->header;
+
+  std::uint64_t next = header->write_count.load(std::memory_order_acquire);
+  std::int64_t last_frame_nsec = NowNsec();
+
+  while (cfg->frame_count == 0 || stats->received_count < cfg->frame_count) {
+    std::uint64_t write_count =
+        header->write_count.load(std::memory_order_acquire);
+
+    if (write_count == next) {
+      if (NowNsec() - last_frame_nsec > cfg->timeout_sec * 1e9) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+    last_frame_nsec = NowNsec();
+
+    // Frames older than the ring holds have been overwritten.
+    if (write_count - next > header->slot_count) {
+      stats->missed_count += write_count - header->slot_count - next;
+      next = write_count - header->slot_count;
+    }
+
+    const ShmSlotHeader *slot = ShmSlot(ring, next);
+    std::uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != ShmFrameSequence(ring, next)) {
+      ++stats->missed_count;
+      ++next;
+      continue;
+    }
+
+    std::uint64_t frame_index = slot->frame_index;
+    std::uint64_t camera_path_index = slot->camera_path_index;
+    std::int64_t capture_nsec = slot->capture_nsec;
+    std::size_t size =
+        std::min<std::size_t>((std::size_t)slot->w * slot->h * 4,
+                              header->max_frame_size);
+    std::uint32_t checksum = Checksum(ShmSlotPixels(slot), size);
+    double latency_msec = (NowNsec() - capture_nsec) / 1e6;
+
+    // Orders the reads of the frame before the second read of the counter.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+      ++stats->torn_count;
+      ++next;
+      continue;
+    }
+
+    ++stats->received_count;
+    stats->total_latency_msec += latency_msec;
+    stats->max_latency_msec = std::max(stats->max_latency_msec, latency_msec);
+
+    if (cfg->is_verbose) {
+      std::printf(
+          "frame %llu, camera path index %llu, %zu bytes, checksum %08x, "
+          "latency %.3f ms\n",
+          (unsigned long long)frame_index,
+          (unsigned long long)camera_path_index, size, checksum, latency_msec);
+    }
+
+    ++next;
+  }
+}
+
+int main(int argc, char **argv) {
+  ConsumerConfig cfg;
+  cfg.frame_count = 0;
+  cfg.timeout_sec = 5;
+  cfg.is_verbose = 0;
+
+  cli::Opt opts[] = {
+      {"frame-count", cli::kOptArgType_Uint, &cfg.frame_count},
+      {"timeout-sec", cli::kOptArgType_Float, &cfg.timeout_sec},
+      {"verbose", cli::kOptArgType_Int, &cfg.is_verbose}};
+
+  uint size = sizeof(opts) / sizeof(opts[0]);
+  uint argi;
+  cli::Status st = cli::ParseOpts(argc, argv, opts, size, &argi);
+  if (st != cli::kStatus_Ok || argi + 1 != (uint)argc) {
+    std::fprintf(stderr, "Failed to parse options: %s\n",
+                 cli::StatusMessage(st));
+    std::fprintf(stderr,
+                 "usage: %s [--frame-count <n>] [--timeout-sec <sec>] "
+                 "[--verbose <0|1>] <shm-name>\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *name = argv[argi];
+
+  ShmRing ring;
+  Status status = OpenRing(name, cfg.timeout_sec, &ring);
+  if (status != kStatus_Ok) {
+    std::fprintf(stderr, "Failed to open frame ring.\n");
+    return EXIT_FAILURE;
+  }
+
+  ConsumerStats stats = {};
+  Consume(&cfg, &ring, &stats);
+
+  CloseShmRing(&ring);
+
+  double mean_latency_msec = 0;
+  if (stats.received_count) {
+    mean_latency_msec = stats.total_latency_msec / stats.received_count;
+  }
+  std::printf(
+      "Frames: %llu received, %llu missed, %llu torn. Latency: mean %.3f ms, "
+      "max %.3f ms\n",
+      (unsigned long long)stats.received_count,
+      (unsigned long long)stats.missed_count,
+      (unsigned long long)stats.torn_count, mean_latency_msec,
+      stats.max_latency_msec);
+
+  return stats.received_count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
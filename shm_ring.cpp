@@ -0,0 +1,225 @@
+#include "shm_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define SHM_RING_PAGE_SIZE 4096
+
+// Pixels start at this offset into a slot, so that rows are cache line
+// aligned.
+#define SHM_SLOT_HEADER_SIZE 64
+
+static_assert(sizeof(ShmRingHeader) <= SHM_RING_PAGE_SIZE, "");
+static_assert(sizeof(ShmSlotHeader) <= SHM_SLOT_HEADER_SIZE, "");
+
+static std::size_t RoundUp(std::size_t n, std::size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+static Status SetName(const char *name, ShmRing *ring) {
+  assert(name);
+  assert(ring);
+
+  int rc = std::snprintf(ring->name, sizeof(ring->name), "%s", name);
+  if (rc < 0 || rc >= (int)sizeof(ring->name)) {
+    std::fprintf(stderr, "Shared memory name %s is too long.\n", name);
+    return kStatus_UnspecifiedError;
+  }
+  return kStatus_Ok;
+}
+
+Status CreateShmRing(const char *name, uint slot_count,
+                     std::size_t max_frame_size, ShmRing *ring) {
+  assert(name);
+  assert(slot_count > 0);
+  assert(ring);
+
+  *ring = {};
+
+  Status status = SetName(name, ring);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  std::size_t slot_size =
+      RoundUp(SHM_SLOT_HEADER_SIZE + max_frame_size, SHM_RING_PAGE_SIZE);
+  std::size_t size = SHM_RING_PAGE_SIZE + slot_count * slot_size;
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    std::fprintf(stderr, "Failed to create shared memory %s.\n", name);
+    return kStatus_IoError;
+  }
+
+  // The memory is only committed once pages are written.
+  if (ftruncate(fd, size) != 0) {
+    std::fprintf(stderr, "Failed to size shared memory %s.\n", name);
+    close(fd);
+    shm_unlink(name);
+    return kStatus_IoError;
+  }
+
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map shared memory %s.\n", name);
+    shm_unlink(name);
+    return kStatus_IoError;
+  }
+
+  ring->is_owner = 1;
+  ring->data = data;
+  ring->size = size;
+  ring->header = (ShmRingHeader *)data;
+
+  // The memory is zeroed by `ftruncate`, so the counters start at 0. The magic
+  // is written last to mark the header as complete.
+  ShmRingHeader *header = ring->header;
+  header->version = SHM_RING_VERSION;
+  header->slot_count = slot_count;
+  header->slot_size = slot_size;
+  header->max_frame_size = max_frame_size;
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+
+  return kStatus_Ok;
+}
+
+Status OpenShmRing(const char *name, ShmRing *ring) {
+  assert(name);
+  assert(ring);
+
+  *ring = {};
+
+  Status status = SetName(name, ring);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    std::fprintf(stderr, "Failed to open shared memory %s.\n", name);
+    return kStatus_IoError;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < SHM_RING_PAGE_SIZE) {
+    std::fprintf(stderr, "Shared memory %s is not a frame ring.\n", name);
+    close(fd);
+    return kStatus_IoError;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map shared memory %s.\n", name);
+    return kStatus_IoError;
+  }
+
+  ring->data = data;
+  ring->size = st.st_size;
+  ring->header = (ShmRingHeader *)data;
+
+  const ShmRingHeader *header = ring->header;
+  int is_valid = std::memcmp(header->magic, SHM_RING_MAGIC,
+                             sizeof(header->magic)) == 0 &&
+                 header->version == SHM_RING_VERSION &&
+                 SHM_RING_PAGE_SIZE + header->slot_count * header->slot_size <=
+                     ring->size;
+  if (!is_valid) {
+    std::fprintf(stderr, "Shared memory %s is not a frame ring.\n", name);
+    CloseShmRing(ring);
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
+
+void CloseShmRing(ShmRing *ring) {
+  assert(ring);
+
+  if (ring->data) {
+    munmap(ring->data, ring->size);
+  }
+  if (ring->is_owner) {
+    shm_unlink(ring->name);
+  }
+  *ring = {};
+}
+
+ShmSlotHeader *ShmSlot(const ShmRing *ring, std::uint64_t frame_number) {
+  assert(ring);
+  assert(ring->header);
+
+  const ShmRingHeader *header = ring->header;
+  std::uint64_t i = frame_number % header->slot_count;
+  return (ShmSlotHeader *)((uchar *)ring->data + SHM_RING_PAGE_SIZE +
+                           i * header->slot_size);
+}
+
+const uchar *ShmSlotPixels(const ShmSlotHeader *slot) {
+  assert(slot);
+  return (const uchar *)slot + SHM_SLOT_HEADER_SIZE;
+}
+
+std::uint64_t ShmFrameSequence(const ShmRing *ring,
+                               std::uint64_t frame_number) {
+  assert(ring);
+  assert(ring->header);
+  return 2 * (frame_number / ring->header->slot_count + 1);
+}
+
+Status PublishShmFrame(const ShmFrameInfo *info, const uchar *pixels,
+                       std::ptrdiff_t stride, ShmRing *ring) {
+  assert(info);
+  assert(pixels);
+  assert(ring);
+  assert(ring->is_owner);
+
+  ShmRingHeader *header = ring->header;
+
+  std::size_t row_size = (std::size_t)info->w * 4;
+  std::size_t size = row_size * info->h;
+  if (size > header->max_frame_size) {
+    std::fprintf(stderr,
+                 "Frame of %u x %u pixels does not fit in a shared memory "
+                 "slot.\n",
+                 info->w, info->h);
+    return kStatus_UnspecifiedError;
+  }
+
+  std::uint64_t frame_number =
+      header->write_count.load(std::memory_order_relaxed);
+  ShmSlotHeader *slot = ShmSlot(ring, frame_number);
+
+  std::uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  // Orders the odd counter before the writes to the slot.
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->frame_index = info->frame_index;
+  slot->camera_path_index = info->camera_path_index;
+  slot->capture_nsec = info->capture_nsec;
+  slot->w = info->w;
+  slot->h = info->h;
+  uchar *slot_pixels = (uchar *)slot + SHM_SLOT_HEADER_SIZE;
+  if (stride == (std::ptrdiff_t)row_size) {
+    std::memcpy(slot_pixels, pixels, size);
+  } else {
+    for (uint y = 0; y < info->h; ++y) {
+      std::memcpy(slot_pixels + y * row_size, pixels + y * stride, row_size);
+    }
+  }
+
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  header->write_count.store(frame_number + 1, std::memory_order_release);
+
+  return kStatus_Ok;
+}
\ No newline at end of file
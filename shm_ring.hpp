@@ -0,0 +1,105 @@
+#ifndef RCOASTER_SHM_RING_HPP
+#define RCOASTER_SHM_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "status.hpp"
+#include "types.hpp"
+
+#define SHM_RING_MAGIC "RCSHMRNG"
+#define SHM_RING_VERSION 1
+
+/*
+A ring of frames in POSIX shared memory, written by one process and read in
+place by any number of processes on the same host.
+
+The shared memory starts with a `ShmRingHeader`, followed by `slot_count`
+slots of `slot_size` bytes. Each slot starts with a `ShmSlotHeader`, followed
+by the pixels of the frame. Frame `k` is written to slot `k % slot_count`.
+
+Slots are guarded by sequence counters (a seqlock). The writer makes a slot's
+counter odd before writing into it and even again afterwards, and then
+increments `write_count`. A reader of frame `k` waits until `write_count > k`,
+checks that the counter is `2 * (k / slot_count + 1)`, uses the frame, and
+checks that the counter has not changed since. A changed counter means that
+the writer lapped the reader, and whatever was read is torn.
+*/
+struct ShmRingHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slot_count;
+  std::uint64_t slot_size;
+  std::uint64_t max_frame_size;
+  std::atomic<std::uint64_t> write_count;
+};
+
+struct ShmSlotHeader {
+  std::atomic<std::uint64_t> sequence;
+  std::uint64_t frame_index;
+  std::uint64_t camera_path_index;
+  // When the frame was captured, on the steady clock (`CLOCK_MONOTONIC` on
+  // Linux).
+  std::int64_t capture_nsec;
+  // Tightly packed RGBA rows, top row first.
+  std::uint32_t w;
+  std::uint32_t h;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "Shared memory counters must be lock-free to be address-free.");
+
+struct ShmFrameInfo {
+  std::uint64_t frame_index;
+  std::uint64_t camera_path_index;
+  std::int64_t capture_nsec;
+  uint w;
+  uint h;
+};
+
+struct ShmRing {
+  char name[256];
+  int is_owner;
+  void *data;
+  std::size_t size;
+  ShmRingHeader *header;
+};
+
+/*
+Creates the shared memory of a ring, replacing any left over from a previous
+run.
+
+Input Parameters:
+- name: POSIX shared memory object name, e.g. "/rcoaster"
+- max_frame_size: bytes of the largest frame that can be published
+*/
+Status CreateShmRing(const char *name, uint slot_count,
+                     std::size_t max_frame_size, ShmRing *ring);
+
+// Opens the shared memory of a ring created by another process, read-only.
+Status OpenShmRing(const char *name, ShmRing *ring);
+
+// Unmaps the ring. The shared memory object is removed if this process
+// created it. Readers that have it mapped keep their mapping.
+void CloseShmRing(ShmRing *ring);
+
+/*
+Copies a frame into the next slot, top row first.
+
+Input Parameters:
+- pixels: first pixel of the top row, with 4 bytes per pixel
+- stride: signed distance in bytes from a row to the row below it
+*/
+Status PublishShmFrame(const ShmFrameInfo *info, const uchar *pixels,
+                       std::ptrdiff_t stride, ShmRing *ring);
+
+ShmSlotHeader *ShmSlot(const ShmRing *ring, std::uint64_t frame_number);
+
+const uchar *ShmSlotPixels(const ShmSlotHeader *slot);
+
+// Returns the sequence counter value of the slot while it holds frame
+// `frame_number`.
+std::uint64_t ShmFrameSequence(const ShmRing *ring, std::uint64_t frame_number);
+
+#endif  // RCOASTER_SHM_RING_HPP
\ No newline at end of file
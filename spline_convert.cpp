@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "cli.hpp"
+#include "spline_io.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+/*
+Converts spline files between the text and binary formats.
+
+The format of the input file is detected. The output file is written in the
+format and encoding given by the options.
+*/
+
+#define CONVERTER_OPT_ARG_BUFFER_SIZE 64
+
+int main(int argc, char **argv) {
+  SplineFileFormat format = kSplineFileFormat_Binary;
+  SplineEncoding encoding = kSplineEncoding_Float32;
+  float quantization_step = 1e-4f;
+
+  char format_arg[CONVERTER_OPT_ARG_BUFFER_SIZE];
+  std::snprintf(format_arg, sizeof(format_arg), "%s", String(format));
+  char encoding_arg[CONVERTER_OPT_ARG_BUFFER_SIZE];
+  std::snprintf(encoding_arg, sizeof(encoding_arg), "%s", String(encoding));
+
+  cli::Opt opts[] = {
+      {"format", cli::kOptArgType_String, format_arg},
+      {"encoding", cli::kOptArgType_String, encoding_arg},
+      {"quantization-step", cli::kOptArgType_Float, &quantization_step}};
+
+  uint size = sizeof(opts) / sizeof(opts[0]);
+  uint argi;
+  cli::Status st = cli::ParseOpts(argc, argv, opts, size, &argi);
+  if (st != cli::kStatus_Ok || argi + 2 != (uint)argc) {
+    std::fprintf(stderr, "Failed to parse options: %s\n",
+                 cli::StatusMessage(st));
+    std::fprintf(stderr,
+                 "usage: %s [--format <text|binary>] "
+                 "[--encoding <float32|delta>] [--quantization-step <step>] "
+                 "<input> <output>\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Status status = ParseSplineFileFormat(format_arg, &format);
+  if (status != kStatus_Ok) {
+    return EXIT_FAILURE;
+  }
+  status = ParseSplineEncoding(encoding_arg, &encoding);
+  if (status != kStatus_Ok) {
+    return EXIT_FAILURE;
+  }
+
+  const char *input_filepath = argv[argi];
+  const char *output_filepath = argv[argi + 1];
+
+  ThreadPool pool;
+  InitThreadPool(0, &pool);
+
+  Spline spline;
+  status = LoadSplineFile(input_filepath, &pool, &spline);
+  FreeThreadPool(&pool);
+  if (status != kStatus_Ok) {
+    return EXIT_FAILURE;
+  }
+
+  if (format == kSplineFileFormat_Text) {
+    status = WriteSplineTextFile(output_filepath, &spline);
+  } else {
+    status = WriteSplineBinaryFile(output_filepath, &spline, encoding,
+                                   quantization_step);
+  }
+  if (status != kStatus_Ok) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,541 @@
+#include "spline_io.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Quantized coordinates must fit in 63 bits so that their differences do.
+#define SPLINE_MAX_QUANTIZED_COORD 4.0e18
+
+const char *const kSplineFileFormatStrings[kSplineFileFormat__Count] = {
+    "text", "binary"};
+
+const char *const kSplineEncodingStrings[kSplineEncoding__Count] = {"float32",
+                                                                    "delta"};
+
+const char *String(SplineFileFormat f) {
+  assert(f < kSplineFileFormat__Count);
+  return kSplineFileFormatStrings[f];
+}
+
+Status ParseSplineFileFormat(const char *s, SplineFileFormat *f) {
+  assert(s);
+  assert(f);
+
+  for (int i = 0; i < kSplineFileFormat__Count; ++i) {
+    if (std::strcmp(s, kSplineFileFormatStrings[i]) == 0) {
+      *f = (SplineFileFormat)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown spline file format \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
+}
+
+const char *String(SplineEncoding e) {
+  assert(e < kSplineEncoding__Count);
+  return kSplineEncodingStrings[e];
+}
+
+Status ParseSplineEncoding(const char *s, SplineEncoding *e) {
+  assert(s);
+  assert(e);
+
+  for (int i = 0; i < kSplineEncoding__Count; ++i) {
+    if (std::strcmp(s, kSplineEncodingStrings[i]) == 0) {
+      *e = (SplineEncoding)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown spline encoding \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
+}
+
+struct MappedFile {
+  const char *data;
+  std::size_t size;
+};
+
+static Status MapFile(const char *filepath, MappedFile *file) {
+  assert(filepath);
+  assert(file);
+
+  *file = {};
+
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    std::fprintf(stderr, "Failed to open spline file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::fprintf(stderr, "Failed to get status of file %s.\n", filepath);
+    close(fd);
+    return kStatus_IoError;
+  }
+
+  // Empty files cannot be mapped.
+  if (st.st_size == 0) {
+    close(fd);
+    return kStatus_Ok;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+  file->data = (const char *)data;
+  file->size = st.st_size;
+  return kStatus_Ok;
+}
+
+static void UnmapFile(MappedFile *file) {
+  assert(file);
+
+  if (file->data) {
+    munmap((void *)file->data, file->size);
+  }
+  *file = {};
+}
+
+static inline int IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+static const char *SkipSpace(const char *p, const char *end) {
+  while (p < end && IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+static const char *SkipToken(const char *p, const char *end) {
+  while (p < end && !IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// Parses a whitespace-terminated unsigned integer.
+static int ParseUint(const char **p, const char *end, uint *value) {
+  assert(p);
+  assert(value);
+
+  const char *begin = SkipSpace(*p, end);
+  std::from_chars_result r = std::from_chars(begin, end, *value);
+  if (r.ec != std::errc() || (r.ptr < end && !IsSpace(*r.ptr))) {
+    return 0;
+  }
+  *p = r.ptr;
+  return 1;
+}
+
+static std::size_t CountValues(const char *p, const char *end) {
+  std::size_t count = 0;
+  for (;;) {
+    p = SkipSpace(p, end);
+    if (p == end) {
+      return count;
+    }
+    ++count;
+    p = SkipToken(p, end);
+  }
+}
+
+/*
+Parses the whitespace-separated floats in `[p, end)` into `values`.
+
+Returns the number of values parsed, or `capacity + 1` if there are more, or
+-1 if a value is malformed.
+*/
+static std::ptrdiff_t ParseValues(const char *p, const char *end, float *values,
+                                  std::size_t capacity) {
+  std::size_t count = 0;
+  for (;;) {
+    p = SkipSpace(p, end);
+    if (p == end) {
+      return count;
+    }
+    if (count == capacity) {
+      return capacity + 1;
+    }
+
+    // `std::from_chars` does not accept a plus sign.
+    if (*p == '+') {
+      ++p;
+    }
+    std::from_chars_result r = std::from_chars(p, end, values[count]);
+    if (r.ec != std::errc() || (r.ptr < end && !IsSpace(*r.ptr))) {
+      return -1;
+    }
+    p = r.ptr;
+    ++count;
+  }
+}
+
+// A range of the text that starts and ends at line boundaries, so that no
+// value is split between ranges.
+struct TextChunk {
+  const char *begin;
+  const char *end;
+  std::size_t first_value;
+  std::size_t value_count;
+  int is_malformed;
+};
+
+struct ParseChunksArgs {
+  TextChunk *chunks;
+  float *values;
+};
+
+static void CountChunkValues(uint begin, uint end, void *arg) {
+  assert(arg);
+
+  ParseChunksArgs *args = (ParseChunksArgs *)arg;
+  for (uint i = begin; i < end; ++i) {
+    TextChunk *chunk = &args->chunks[i];
+    chunk->value_count = CountValues(chunk->begin, chunk->end);
+  }
+}
+
+static void ParseChunkValues(uint begin, uint end, void *arg) {
+  assert(arg);
+
+  ParseChunksArgs *args = (ParseChunksArgs *)arg;
+  for (uint i = begin; i < end; ++i) {
+    TextChunk *chunk = &args->chunks[i];
+    std::ptrdiff_t n =
+        ParseValues(chunk->begin, chunk->end,
+                    args->values + chunk->first_value, chunk->value_count);
+    chunk->is_malformed = n != (std::ptrdiff_t)chunk->value_count;
+  }
+}
+
+/*
+Parses values in parallel in two passes. The first counts the values of each
+chunk, which gives every chunk the index of its first value, and the second
+parses each chunk in place.
+*/
+static Status ParseValuesParallel(const char *p, const char *end,
+                                  ThreadPool *pool, const char *filepath,
+                                  float *values, std::size_t value_count) {
+  assert(pool);
+  assert(filepath);
+
+  std::vector<TextChunk> chunks;
+  while (p < end) {
+    const char *chunk_end = p + std::min<std::size_t>(
+                                    SPLINE_PARSE_CHUNK_SIZE, end - p);
+    if (chunk_end < end) {
+      const char *newline =
+          (const char *)std::memchr(chunk_end, '\n', end - chunk_end);
+      chunk_end = newline ? newline + 1 : end;
+    }
+    chunks.push_back({p, chunk_end, 0, 0, 0});
+    p = chunk_end;
+  }
+
+  ParseChunksArgs args = {chunks.data(), values};
+  ParallelFor(pool, chunks.size(), 1, CountChunkValues, &args);
+
+  std::size_t total = 0;
+  for (TextChunk &chunk : chunks) {
+    chunk.first_value = total;
+    total += chunk.value_count;
+  }
+  if (total != value_count) {
+    std::fprintf(stderr,
+                 "Spline file %s has %zu coordinates instead of the %zu of "
+                 "its control point count.\n",
+                 filepath, total, value_count);
+    return kStatus_IoError;
+  }
+
+  ParallelFor(pool, chunks.size(), 1, ParseChunkValues, &args);
+
+  for (const TextChunk &chunk : chunks) {
+    if (chunk.is_malformed) {
+      std::fprintf(stderr,
+                   "Failed to read control point from spline file %s.\n",
+                   filepath);
+      return kStatus_IoError;
+    }
+  }
+
+  return kStatus_Ok;
+}
+
+static Status ParseSplineText(const MappedFile *file, const char *filepath,
+                              ThreadPool *pool, Spline *spline) {
+  assert(file);
+  assert(filepath);
+  assert(spline);
+
+  const char *p = file->data;
+  const char *end = file->data + file->size;
+
+  uint ctrl_point_count;
+  if (!ParseUint(&p, end, &ctrl_point_count) ||
+      !ParseUint(&p, end, &spline->type)) {
+    std::fprintf(stderr,
+                 "Failed to read control point count and spline type from "
+                 "spline file %s.\n",
+                 filepath);
+    return kStatus_IoError;
+  }
+
+  spline->ctrl_points.resize(ctrl_point_count);
+  float *values = (float *)spline->ctrl_points.data();
+  std::size_t value_count = (std::size_t)ctrl_point_count * 3;
+
+  if (pool && (std::size_t)(end - p) >= 2 * SPLINE_PARSE_CHUNK_SIZE) {
+    return ParseValuesParallel(p, end, pool, filepath, values, value_count);
+  }
+
+  std::ptrdiff_t n = ParseValues(p, end, values, value_count);
+  if (n < 0) {
+    std::fprintf(stderr, "Failed to read control point from spline file %s.\n",
+                 filepath);
+    return kStatus_IoError;
+  }
+  if ((std::size_t)n != value_count) {
+    std::fprintf(stderr,
+                 "Spline file %s has %s coordinates than the %zu of its "
+                 "control point count.\n",
+                 filepath, (std::size_t)n < value_count ? "fewer" : "more",
+                 value_count);
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
+
+static inline std::uint64_t ZigzagEncode(std::int64_t v) {
+  return ((std::uint64_t)v << 1) ^ (std::uint64_t)(v >> 63);
+}
+
+static inline std::int64_t ZigzagDecode(std::uint64_t v) {
+  return (std::int64_t)(v >> 1) ^ -(std::int64_t)(v & 1);
+}
+
+static int ReadVarint(const uchar **p, const uchar *end, std::uint64_t *v) {
+  std::uint64_t result = 0;
+  for (uint shift = 0; shift < 64; shift += 7) {
+    if (*p == end) {
+      return 0;
+    }
+    uchar byte = *(*p)++;
+    result |= (std::uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *v = result;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void WriteVarint(std::uint64_t v, std::vector<uchar> *out) {
+  while (v >= 0x80) {
+    out->push_back((uchar)(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back((uchar)v);
+}
+
+static Status DecodeSplineBinary(const MappedFile *file, const char *filepath,
+                                 Spline *spline) {
+  assert(file);
+  assert(filepath);
+  assert(spline);
+
+  SplineFileHeader header;
+  if (file->size < sizeof(header)) {
+    std::fprintf(stderr, "Spline file %s is truncated.\n", filepath);
+    return kStatus_IoError;
+  }
+  std::memcpy(&header, file->data, sizeof(header));
+
+  if (header.version != SPLINE_FILE_VERSION ||
+      header.encoding >= kSplineEncoding__Count) {
+    std::fprintf(stderr, "Spline file %s has an unsupported version.\n",
+                 filepath);
+    return kStatus_IoError;
+  }
+  if (header.data_size > file->size - sizeof(header)) {
+    std::fprintf(stderr, "Spline file %s is truncated.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  const uchar *p = (const uchar *)file->data + sizeof(header);
+  const uchar *end = p + header.data_size;
+
+  // Every control point takes at least 3 bytes in either encoding, which
+  // bounds the allocation by the size of the file.
+  if (header.ctrl_point_count > header.data_size / 3) {
+    std::fprintf(stderr, "Spline file %s is truncated.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  spline->type = header.type;
+  spline->ctrl_points.resize(header.ctrl_point_count);
+
+  if (header.encoding == kSplineEncoding_Float32) {
+    std::size_t size = header.ctrl_point_count * sizeof(glm::vec3);
+    if (header.data_size != size) {
+      std::fprintf(stderr, "Spline file %s is truncated.\n", filepath);
+      return kStatus_IoError;
+    }
+    std::memcpy(spline->ctrl_points.data(), p, size);
+    return kStatus_Ok;
+  }
+
+  double step = header.quantization_step;
+  if (!(step > 0)) {
+    std::fprintf(stderr, "Spline file %s has an invalid quantization step.\n",
+                 filepath);
+    return kStatus_IoError;
+  }
+
+  std::int64_t previous[3] = {};
+  for (glm::vec3 &point : spline->ctrl_points) {
+    for (int k = 0; k < 3; ++k) {
+      std::uint64_t delta;
+      if (!ReadVarint(&p, end, &delta)) {
+        std::fprintf(stderr,
+                     "Failed to read control point from spline file %s.\n",
+                     filepath);
+        return kStatus_IoError;
+      }
+      previous[k] += ZigzagDecode(delta);
+      point[k] = (float)(previous[k] * step);
+    }
+  }
+
+  return kStatus_Ok;
+}
+
+Status LoadSplineFile(const char *filepath, ThreadPool *pool, Spline *spline) {
+  assert(filepath);
+  assert(spline);
+
+  MappedFile file;
+  Status status = MapFile(filepath, &file);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  if (file.size >= sizeof(SplineFileHeader) &&
+      std::memcmp(file.data, SPLINE_FILE_MAGIC, 8) == 0) {
+    status = DecodeSplineBinary(&file, filepath, spline);
+  } else {
+    status = ParseSplineText(&file, filepath, pool, spline);
+  }
+
+  UnmapFile(&file);
+  return status;
+}
+
+Status WriteSplineTextFile(const char *filepath, const Spline *spline) {
+  assert(filepath);
+  assert(spline);
+
+  std::FILE *file = std::fopen(filepath, "w");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  std::fprintf(file, "%zu %u\n", spline->ctrl_points.size(), spline->type);
+  // 9 significant digits round-trip any float.
+  for (const glm::vec3 &p : spline->ctrl_points) {
+    std::fprintf(file, "%.9g %.9g %.9g\n", p.x, p.y, p.z);
+  }
+
+  int is_failed = std::ferror(file);
+  is_failed |= std::fclose(file);
+  if (is_failed) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  return kStatus_Ok;
+}
+
+Status WriteSplineBinaryFile(const char *filepath, const Spline *spline,
+                             SplineEncoding encoding,
+                             float quantization_step) {
+  assert(filepath);
+  assert(spline);
+  assert(encoding < kSplineEncoding__Count);
+
+  std::vector<uchar> data;
+  if (encoding == kSplineEncoding_Float32) {
+    const uchar *points = (const uchar *)spline->ctrl_points.data();
+    data.assign(points,
+                points + spline->ctrl_points.size() * sizeof(glm::vec3));
+  } else {
+    if (!(quantization_step > 0)) {
+      std::fprintf(stderr, "Quantization step must be positive.\n");
+      return kStatus_UnspecifiedError;
+    }
+
+    std::int64_t previous[3] = {};
+    for (const glm::vec3 &point : spline->ctrl_points) {
+      for (int k = 0; k < 3; ++k) {
+        double q = std::round((double)point[k] / quantization_step);
+        if (!(std::fabs(q) < SPLINE_MAX_QUANTIZED_COORD)) {
+          std::fprintf(stderr,
+                       "Control point coordinate %g cannot be quantized with "
+                       "step %g.\n",
+                       point[k], quantization_step);
+          return kStatus_UnspecifiedError;
+        }
+        std::int64_t v = (std::int64_t)q;
+        WriteVarint(ZigzagEncode(v - previous[k]), &data);
+        previous[k] = v;
+      }
+    }
+  }
+
+  SplineFileHeader header = {};
+  std::memcpy(header.magic, SPLINE_FILE_MAGIC, sizeof(header.magic));
+  header.version = SPLINE_FILE_VERSION;
+  header.type = spline->type;
+  header.ctrl_point_count = spline->ctrl_points.size();
+  header.encoding = encoding;
+  header.quantization_step =
+      encoding == kSplineEncoding_Delta ? quantization_step : 0;
+  header.data_size = data.size();
+
+  std::FILE *file = std::fopen(filepath, "wb");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fwrite(data.data(), 1, data.size(), file);
+
+  int is_failed = std::ferror(file);
+  is_failed |= std::fclose(file);
+  if (is_failed) {
+    std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  return kStatus_Ok;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef RCOASTER_SPLINE_IO_HPP
+#define RCOASTER_SPLINE_IO_HPP
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+#define SPLINE_FILE_MAGIC "RCSPLINE"
+#define SPLINE_FILE_VERSION 1
+
+// Text files at least this large are parsed in chunks of this size on the
+// thread pool.
+#define SPLINE_PARSE_CHUNK_SIZE (1 << 20)
+
+enum SplineFileFormat {
+  // The control point count and spline type, followed by the coordinates of
+  // every control point, all separated by whitespace.
+  kSplineFileFormat_Text,
+  // A `SplineFileHeader` followed by the control points.
+  kSplineFileFormat_Binary,
+  kSplineFileFormat__Count
+};
+
+enum SplineEncoding {
+  // Little-endian 32-bit floats.
+  kSplineEncoding_Float32,
+  // Coordinates are rounded to multiples of the quantization step, and each
+  // is stored as the difference from the same coordinate of the previous
+  // control point, in a zigzag LEB128 varint.
+  kSplineEncoding_Delta,
+  kSplineEncoding__Count
+};
+
+const char *String(SplineFileFormat f);
+
+Status ParseSplineFileFormat(const char *s, SplineFileFormat *f);
+
+const char *String(SplineEncoding e);
+
+Status ParseSplineEncoding(const char *s, SplineEncoding *e);
+
+struct SplineFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t type;
+  std::uint64_t ctrl_point_count;
+  // A `SplineEncoding`.
+  std::uint32_t encoding;
+  float quantization_step;
+  // Bytes of control points after the header.
+  std::uint64_t data_size;
+};
+
+struct Spline {
+  std::vector<glm::vec3> ctrl_points;
+  uint type;
+};
+
+/*
+Loads a spline file of either format, detected by its magic number.
+
+The file is mapped rather than read. The number of control points must match
+the count in the file.
+
+Input Parameters:
+- pool: parses large text files in parallel if not null
+*/
+Status LoadSplineFile(const char *filepath, ThreadPool *pool, Spline *spline);
+
+Status WriteSplineTextFile(const char *filepath, const Spline *spline);
+
+/*
+Input Parameters:
+- quantization_step: the largest error of a coordinate is half of it. Only used
+by `kSplineEncoding_Delta`
+*/
+Status WriteSplineBinaryFile(const char *filepath, const Spline *spline,
+                             SplineEncoding encoding, float quantization_step);
+
+#endif  // RCOASTER_SPLINE_IO_HPP
\ No newline at end of file
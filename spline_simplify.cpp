@@ -0,0 +1,260 @@
+#include "spline_simplify.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+
+#include "meshes.hpp"
+
+static float DistanceToLineSegment(const glm::vec3 *p, const glm::vec3 *a,
+                                   const glm::vec3 *b) {
+  assert(p);
+  assert(a);
+  assert(b);
+
+  glm::vec3 ab = *b - *a;
+  glm::vec3 ap = *p - *a;
+  float len_sq = glm::dot(ab, ab);
+  if (len_sq > 0) {
+    float t = glm::clamp(glm::dot(ap, ab) / len_sq, 0.0f, 1.0f);
+    ap -= t * ab;
+  }
+  return glm::length(ap);
+}
+
+// Control points `[begin, end)` to be searched for the farthest one from the
+// line between control points `first` and `last`.
+struct FarthestSearch {
+  uint first;
+  uint last;
+  uint begin;
+  uint end;
+  float dist;
+  uint index;
+};
+
+struct FindFarthestArgs {
+  const glm::vec3 *ctrl_points;
+  FarthestSearch *searches;
+};
+
+static void FindFarthest(uint begin, uint end, void *arg) {
+  assert(arg);
+
+  FindFarthestArgs *args = (FindFarthestArgs *)arg;
+  const glm::vec3 *cp = args->ctrl_points;
+  for (uint i = begin; i < end; ++i) {
+    FarthestSearch *search = &args->searches[i];
+    search->dist = -1;
+    for (uint j = search->begin; j < search->end; ++j) {
+      float dist =
+          DistanceToLineSegment(&cp[j], &cp[search->first], &cp[search->last]);
+      if (dist > search->dist) {
+        search->dist = dist;
+        search->index = j;
+      }
+    }
+  }
+}
+
+/*
+Marks the control points that the Douglas-Peucker algorithm keeps between
+control points `first` and `last`, which are kept.
+
+The lines of each level of the recursion are searched together, in chunks, so
+that both the few long lines near the top and the many short lines near the
+bottom keep the thread pool busy.
+*/
+static void DouglasPeucker(const std::vector<glm::vec3> *ctrl_points,
+                           uint first, uint last, float tolerance,
+                           ThreadPool *pool, std::vector<uchar> *is_kept) {
+  assert(ctrl_points);
+  assert(pool);
+  assert(is_kept);
+
+  struct Line {
+    uint first;
+    uint last;
+  };
+
+  std::vector<Line> lines = {{first, last}};
+  std::vector<Line> next_lines;
+  std::vector<FarthestSearch> searches;
+  while (!lines.empty()) {
+    searches.clear();
+    for (const Line &line : lines) {
+      for (uint i = line.first + 1; i < line.last;
+           i += SPLINE_SIMPLIFY_CHUNK_SIZE) {
+        uint end = std::min<uint>(i + SPLINE_SIMPLIFY_CHUNK_SIZE, line.last);
+        searches.push_back({line.first, line.last, i, end, 0, 0});
+      }
+    }
+
+    FindFarthestArgs args = {ctrl_points->data(), searches.data()};
+    ParallelFor(pool, searches.size(), 1, FindFarthest, &args);
+
+    // The searches of a line are consecutive.
+    next_lines.clear();
+    for (std::size_t i = 0; i < searches.size();) {
+      const FarthestSearch *farthest = &searches[i];
+      std::size_t j = i + 1;
+      for (; j < searches.size() && searches[j].first == searches[i].first;
+           ++j) {
+        if (searches[j].dist > farthest->dist) {
+          farthest = &searches[j];
+        }
+      }
+      i = j;
+
+      if (farthest->dist > tolerance) {
+        (*is_kept)[farthest->index] = 1;
+        next_lines.push_back({farthest->first, farthest->index});
+        next_lines.push_back({farthest->index, farthest->last});
+      }
+    }
+    lines.swap(next_lines);
+  }
+}
+
+// Checks the removed control points of a segment of the simplified spline
+// against its curve.
+struct SegmentCheck {
+  // Index of the segment in the simplified spline.
+  uint segment;
+  // The curve of the segment depends on control points `window_first`,
+  // `begin - 1`, `end` and `window_last` of the original spline.
+  uint window_first;
+  uint window_last;
+  // Removed control points `[begin, end)` lie on the original curve along it.
+  uint begin;
+  uint end;
+  float dist;
+  uint index;
+};
+
+struct CheckSegmentsArgs {
+  const glm::vec3 *ctrl_points;
+  const glm::vec3 *simplified_ctrl_points;
+  SegmentCheck *checks;
+};
+
+static void CheckSegments(uint begin, uint end, void *arg) {
+  // Of the curve of a segment, which is approximated by the line segments
+  // between them.
+  static constexpr uint kSampleCount = 32;
+
+  assert(arg);
+
+  CheckSegmentsArgs *args = (CheckSegmentsArgs *)arg;
+  glm::vec3 samples[kSampleCount + 1];
+  for (uint i = begin; i < end; ++i) {
+    SegmentCheck *check = &args->checks[i];
+    for (uint j = 0; j <= kSampleCount; ++j) {
+      samples[j] = CatmullRomSegmentPosition(args->simplified_ctrl_points,
+                                             check->segment,
+                                             (float)j / kSampleCount);
+    }
+
+    check->dist = -1;
+    for (uint j = check->begin; j < check->end; ++j) {
+      float dist = DistanceToLineSegment(&args->ctrl_points[j], &samples[0],
+                                         &samples[1]);
+      for (uint k = 1; k < kSampleCount; ++k) {
+        dist = std::min(dist, DistanceToLineSegment(&args->ctrl_points[j],
+                                                    &samples[k],
+                                                    &samples[k + 1]));
+      }
+      if (dist > check->dist) {
+        check->dist = dist;
+        check->index = j;
+      }
+    }
+  }
+}
+
+void SimplifySplineCtrlPoints(float tolerance, ThreadPool *pool,
+                              std::vector<glm::vec3> *ctrl_points,
+                              float *max_deviation) {
+  assert(tolerance >= 0);
+  assert(pool);
+  assert(ctrl_points);
+  assert(max_deviation);
+
+  *max_deviation = 0;
+
+  uint count = ctrl_points->size();
+  if (count <= 4) {
+    return;
+  }
+
+  std::vector<uchar> is_kept(count, 0);
+  is_kept[0] = 1;
+  is_kept[1] = 1;
+  is_kept[count - 2] = 1;
+  is_kept[count - 1] = 1;
+  DouglasPeucker(ctrl_points, 1, count - 2, tolerance, pool, &is_kept);
+
+  std::vector<uint> kept;
+  std::vector<glm::vec3> simplified;
+  std::vector<SegmentCheck> checks;
+  // The last check of the segment that starts at each control point. Only
+  // segments whose control points changed since are checked again.
+  std::vector<SegmentCheck> last_checks(count, SegmentCheck{});
+  for (;;) {
+    kept.clear();
+    simplified.clear();
+    for (uint i = 0; i < count; ++i) {
+      if (is_kept[i]) {
+        kept.push_back(i);
+        simplified.push_back((*ctrl_points)[i]);
+      }
+    }
+
+    // The curve between simplified control points `i` and `i + 1` is segment
+    // `i - 1`. The first two and last two control points are kept, so no
+    // control point is removed from before the first segment or after the
+    // last.
+    checks.clear();
+    for (uint i = 1; i + 2 < kept.size(); ++i) {
+      if (kept[i + 1] - kept[i] <= 1) {
+        continue;
+      }
+      SegmentCheck check = {};
+      check.segment = i - 1;
+      check.window_first = kept[i - 1];
+      check.window_last = kept[i + 2];
+      check.begin = kept[i] + 1;
+      check.end = kept[i + 1];
+      const SegmentCheck *last = &last_checks[kept[i]];
+      if (last->end == check.end && last->window_first == check.window_first &&
+          last->window_last == check.window_last) {
+        continue;
+      }
+      checks.push_back(check);
+    }
+
+    CheckSegmentsArgs args = {ctrl_points->data(), simplified.data(),
+                              checks.data()};
+    ParallelFor(pool, checks.size(), 1, CheckSegments, &args);
+
+    int is_within_tolerance = 1;
+    for (const SegmentCheck &check : checks) {
+      last_checks[check.begin - 1] = check;
+      if (check.dist > tolerance) {
+        is_kept[check.index] = 1;
+        is_within_tolerance = 0;
+      }
+    }
+    if (is_within_tolerance) {
+      break;
+    }
+  }
+
+  for (uint i = 1; i + 2 < kept.size(); ++i) {
+    if (kept[i + 1] - kept[i] > 1) {
+      *max_deviation = std::max(*max_deviation, last_checks[kept[i]].dist);
+    }
+  }
+
+  ctrl_points->swap(simplified);
+}
\ No newline at end of file
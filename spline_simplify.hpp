@@ -0,0 +1,37 @@
+#ifndef RCOASTER_SPLINE_SIMPLIFY_HPP
+#define RCOASTER_SPLINE_SIMPLIFY_HPP
+
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+// Control points are searched for the farthest one from a line in chunks of
+// up to this many on the thread pool.
+#define SPLINE_SIMPLIFY_CHUNK_SIZE 4096
+
+/*
+Removes control points of a Catmull-Rom spline that its curve does not need to
+stay within `tolerance` of them. The original curve passes through every
+control point but the first and last, so this bounds how far the simplified
+curve strays from it at the removed control points.
+
+Control points are first removed with the Douglas-Peucker algorithm, whose
+lines are searched in parallel, one level of its recursion at a time. The
+curve between the remaining control points is then checked against the
+removed ones, and the farthest one of every segment that strays beyond
+`tolerance` is restored, until none does.
+
+The first two and last two control points are always kept, so that the curve
+starts and ends as it did.
+
+Output Parameters:
+- max_deviation: the largest distance between the simplified curve and a
+removed control point
+*/
+void SimplifySplineCtrlPoints(float tolerance, ThreadPool *pool,
+                              std::vector<glm::vec3> *ctrl_points,
+                              float *max_deviation);
+
+#endif  // RCOASTER_SPLINE_SIMPLIFY_HPP
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "task_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "profiler.hpp"
+
+const char *const kTaskAffinityStrings[kTaskAffinity__Count] = {"worker",
+                                                                "main"};
+
+const char *String(TaskAffinity a) {
+  assert(a < kTaskAffinity__Count);
+  return kTaskAffinityStrings[a];
+}
+
+uint AddGraphTask(TaskGraph *graph, const char *name, TaskAffinity affinity,
+                  GraphTaskFunc func, void *arg) {
+  assert(graph);
+  assert(name);
+  assert(affinity < kTaskAffinity__Count);
+  assert(func);
+
+  GraphTask task = {};
+  task.name = name;
+  task.func = func;
+  task.arg = arg;
+  task.affinity = affinity;
+  task.status = kStatus_Ok;
+  graph->tasks.push_back(task);
+  return graph->tasks.size() - 1;
+}
+
+void AddGraphDependency(TaskGraph *graph, uint task, uint dependency) {
+  assert(graph);
+  assert(task < graph->tasks.size());
+  assert(dependency < graph->tasks.size());
+  assert(task != dependency);
+
+  graph->tasks[task].dependencies.push_back(dependency);
+  graph->tasks[dependency].dependents.push_back(task);
+}
+
+/*
+Marks a task as finished and releases its dependents. Dependents that become
+ready are either queued for the main thread or appended to `worker_tasks`, to
+be submitted once the lock is released. Dependents of a task that failed or
+was skipped are skipped in turn.
+
+The lock of the graph must be held.
+*/
+static void FinishTask(TaskGraph *graph, uint index,
+                       std::vector<uint> *worker_tasks) {
+  assert(graph);
+  assert(worker_tasks);
+
+  std::vector<uint> finished = {index};
+  while (!finished.empty()) {
+    GraphTask *task = &graph->tasks[finished.back()];
+    finished.pop_back();
+    --graph->unfinished_task_count;
+
+    int is_failed = task->is_skipped || task->status != kStatus_Ok;
+    for (uint i : task->dependents) {
+      GraphTask *dependent = &graph->tasks[i];
+      if (is_failed) {
+        dependent->is_skipped = 1;
+      }
+      if (--dependent->pending_dependency_count > 0) {
+        continue;
+      }
+
+      if (dependent->is_skipped) {
+        finished.push_back(i);
+      } else if (dependent->affinity == kTaskAffinity_Main) {
+        graph->ready_main_tasks.push_back(i);
+      } else {
+        worker_tasks->push_back(i);
+      }
+    }
+  }
+
+  graph->task_finished.notify_all();
+}
+
+static void SubmitGraphTasks(TaskGraph *graph,
+                             const std::vector<uint> *worker_tasks);
+
+static void RunGraphTask(GraphTask *task) {
+  assert(task);
+
+  TaskGraph *graph = task->graph;
+  std::int64_t start_nsec = ProfileNowNsec();
+  Status status = task->func(task->arg);
+  std::int64_t end_nsec = ProfileNowNsec();
+
+  std::vector<uint> worker_tasks;
+  {
+    std::lock_guard<std::mutex> lock(graph->mutex);
+    task->status = status;
+    task->start_nsec = start_nsec - graph->start_nsec;
+    task->duration_nsec = end_nsec - start_nsec;
+    FinishTask(graph, task->index, &worker_tasks);
+  }
+  SubmitGraphTasks(graph, &worker_tasks);
+}
+
+// Called on a worker thread.
+static void RunWorkerGraphTask(void *arg) {
+  assert(arg);
+
+  RunGraphTask((GraphTask *)arg);
+}
+
+static void SubmitGraphTasks(TaskGraph *graph,
+                             const std::vector<uint> *worker_tasks) {
+  assert(graph);
+  assert(worker_tasks);
+
+  for (uint i : *worker_tasks) {
+    SubmitTask(graph->pool, RunWorkerGraphTask, &graph->tasks[i]);
+  }
+}
+
+Status RunTaskGraph(ThreadPool *pool, TaskGraph *graph) {
+  assert(pool);
+  assert(graph);
+
+  graph->pool = pool;
+  graph->start_nsec = ProfileNowNsec();
+  graph->unfinished_task_count = graph->tasks.size();
+  graph->ready_main_tasks.clear();
+
+  std::vector<uint> worker_tasks;
+  for (uint i = 0; i < graph->tasks.size(); ++i) {
+    GraphTask *task = &graph->tasks[i];
+    task->graph = graph;
+    task->index = i;
+    task->pending_dependency_count = task->dependencies.size();
+    task->is_skipped = 0;
+    task->status = kStatus_Ok;
+    task->start_nsec = 0;
+    task->duration_nsec = 0;
+    if (task->pending_dependency_count > 0) {
+      continue;
+    }
+    if (task->affinity == kTaskAffinity_Main) {
+      graph->ready_main_tasks.push_back(i);
+    } else {
+      worker_tasks.push_back(i);
+    }
+  }
+  SubmitGraphTasks(graph, &worker_tasks);
+
+  std::unique_lock<std::mutex> lock(graph->mutex);
+  for (;;) {
+    graph->task_finished.wait(lock, [graph] {
+      return !graph->ready_main_tasks.empty() ||
+             graph->unfinished_task_count == 0;
+    });
+    if (graph->ready_main_tasks.empty()) {
+      break;
+    }
+
+    std::vector<uint>::iterator next = std::min_element(
+        graph->ready_main_tasks.begin(), graph->ready_main_tasks.end());
+    uint index = *next;
+    graph->ready_main_tasks.erase(next);
+
+    lock.unlock();
+    RunGraphTask(&graph->tasks[index]);
+    lock.lock();
+  }
+
+  for (const GraphTask &task : graph->tasks) {
+    if (task.status != kStatus_Ok) {
+      std::fprintf(stderr, "Failed to run task %s.\n", task.name);
+      return task.status;
+    }
+  }
+  return kStatus_Ok;
+}
+
+static std::int64_t EndNsec(const GraphTask *task) {
+  assert(task);
+
+  return task->start_nsec + task->duration_nsec;
+}
+
+void PrintTaskGraphTimes(const TaskGraph *graph) {
+  assert(graph);
+
+  std::printf("Task graph times (msec):\n");
+  std::printf("  %-20s %-8s %10s %10s\n", "task", "thread", "start",
+              "duration");
+  for (const GraphTask &task : graph->tasks) {
+    if (task.is_skipped) {
+      std::printf("  %-20s %-8s %10s %10s\n", task.name,
+                  String(task.affinity), "skipped", "-");
+      continue;
+    }
+    std::printf("  %-20s %-8s %10.3f %10.3f\n", task.name,
+                String(task.affinity), task.start_nsec * 1e-6,
+                task.duration_nsec * 1e-6);
+  }
+
+  if (graph->tasks.empty()) {
+    return;
+  }
+
+  // Walks back from the task that finished last through the dependency of
+  // each task that finished last.
+  std::vector<uint> path;
+  uint index = 0;
+  for (uint i = 1; i < graph->tasks.size(); ++i) {
+    if (EndNsec(&graph->tasks[i]) > EndNsec(&graph->tasks[index])) {
+      index = i;
+    }
+  }
+  std::int64_t end_nsec = EndNsec(&graph->tasks[index]);
+  for (;;) {
+    path.push_back(index);
+    const GraphTask *task = &graph->tasks[index];
+    if (task->dependencies.empty()) {
+      break;
+    }
+    index = task->dependencies[0];
+    for (uint i : task->dependencies) {
+      if (EndNsec(&graph->tasks[i]) > EndNsec(&graph->tasks[index])) {
+        index = i;
+      }
+    }
+  }
+
+  std::printf("  Critical path (%.3f msec):", end_nsec * 1e-6);
+  for (uint i = path.size(); i > 0; --i) {
+    std::printf(" %s%s", graph->tasks[path[i - 1]].name, i > 1 ? " ->" : "");
+  }
+  std::printf("\n");
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef RCOASTER_TASK_GRAPH_HPP
+#define RCOASTER_TASK_GRAPH_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+// A task of a graph. A task that fails keeps the tasks that depend on it from
+// running.
+typedef Status (*GraphTaskFunc)(void *arg);
+
+enum TaskAffinity {
+  // Runs on a worker thread of the thread pool.
+  kTaskAffinity_Worker,
+  // Runs on the thread that runs the graph, e.g. because it uses the OpenGL
+  // context that is current on that thread.
+  kTaskAffinity_Main,
+  kTaskAffinity__Count
+};
+
+const char *String(TaskAffinity a);
+
+struct TaskGraph;
+
+struct GraphTask {
+  const char *name;
+  GraphTaskFunc func;
+  void *arg;
+  TaskAffinity affinity;
+  std::vector<uint> dependencies;
+  std::vector<uint> dependents;
+  // Dependencies that have not finished yet.
+  uint pending_dependency_count;
+  // Whether a dependency failed or was skipped, so that the task does not run.
+  int is_skipped;
+  Status status;
+  // Relative to the start of the graph. Zero if the task did not run.
+  std::int64_t start_nsec;
+  std::int64_t duration_nsec;
+
+  TaskGraph *graph;
+  uint index;
+};
+
+/*
+Tasks with dependencies between them, such as the phases of startup.
+
+Each task runs as soon as all of its dependencies have finished, so the time to
+run the graph is bounded by its critical path rather than by the sum of its
+tasks. Ready tasks of the main thread run in the order they were added.
+*/
+struct TaskGraph {
+  std::vector<GraphTask> tasks;
+  ThreadPool *pool;
+  std::int64_t start_nsec;
+
+  std::mutex mutex;
+  std::condition_variable task_finished;
+  // Indices of the tasks of the main thread whose dependencies have finished.
+  std::vector<uint> ready_main_tasks;
+  uint unfinished_task_count;
+};
+
+// Returns the index of the task, by which other tasks depend on it.
+uint AddGraphTask(TaskGraph *graph, const char *name, TaskAffinity affinity,
+                  GraphTaskFunc func, void *arg);
+
+// Makes `task` run after `dependency` has finished.
+void AddGraphDependency(TaskGraph *graph, uint task, uint dependency);
+
+/*
+Runs every task of the graph, and returns once they have all finished or been
+skipped. The calling thread runs the tasks of the main thread, and the thread
+pool runs the others. Tasks must not be added while the graph runs.
+
+Returns the status of the first task that failed, in the order they were added.
+*/
+Status RunTaskGraph(ThreadPool *pool, TaskGraph *graph);
+
+// Prints the thread, start time and duration of every task, and the chain of
+// tasks that finished last.
+void PrintTaskGraphTimes(const TaskGraph *graph);
+
+#endif  // RCOASTER_TASK_GRAPH_HPP
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "texture_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define TEXTURE_CACHE_PAGE_SIZE 4096
+
+static_assert(sizeof(TextureCacheHeader) <= TEXTURE_CACHE_PAGE_SIZE, "");
+
+Status InitTextureSource(const char *cache_dir, const char *filepath,
+                         TextureCompression compression, TextureSource *src) {
+  assert(cache_dir);
+  assert(filepath);
+  assert(compression < kTextureCompression__Count);
+  assert(src);
+
+  src->filepath = filepath;
+
+  struct stat st;
+  if (stat(filepath, &st) != 0) {
+    std::fprintf(stderr, "Failed to get status of file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  src->mtime_nsec = MtimeNsec(&st);
+  src->size = st.st_size;
+
+  char path[PATH_MAX];
+  if (!realpath(filepath, path)) {
+    std::fprintf(stderr, "Failed to resolve path of file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  std::uint64_t key = HashBytes((const uchar *)path, std::strlen(path));
+  int rc = std::snprintf(src->cache_filepath, sizeof(src->cache_filepath),
+                         "%s/%016llx.%s.%s", cache_dir,
+                         (unsigned long long)key, String(compression),
+                         TEXTURE_CACHE_EXTENSION);
+  if (rc < 0 || rc >= (int)sizeof(src->cache_filepath)) {
+    std::fprintf(stderr, "Failed to make texture cache filepath.\n");
+    return kStatus_UnspecifiedError;
+  }
+
+  return kStatus_Ok;
+}
+
+static int IsValid(const TextureCacheHeader *header, std::size_t file_size) {
+  assert(header);
+
+  if (std::memcmp(header->magic, TEXTURE_CACHE_MAGIC,
+                  sizeof(header->magic)) != 0 ||
+      header->version != TEXTURE_CACHE_VERSION ||
+      header->format >= kTextureFormat__Count || header->w == 0 ||
+      header->h == 0 || header->level_count == 0 || header->level_count > 32) {
+    return 0;
+  }
+  return header->pixels_size ==
+             MipmapsSize((TextureFormat)header->format, header->w,
+                         header->h, header->level_count) &&
+         header->pixels_offset <= file_size &&
+         header->pixels_size <= file_size - header->pixels_offset;
+}
+
+// Records the modification time of an image file whose content is unchanged,
+// so that the next run does not have to hash it. The cache file is rewritten
+// with `WriteCacheFile` from its mapping, with only the header changed.
+static void RefreshCachedTexture(const TextureSource *src, const void *data,
+                                 std::size_t size) {
+  assert(src);
+  assert(data);
+  assert(size >= sizeof(TextureCacheHeader));
+
+  TextureCacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  header.source_mtime_nsec = src->mtime_nsec;
+
+  const CacheFileChunk chunks[] = {
+      {&header, sizeof(header)},
+      {(const uchar *)data + sizeof(header), size - sizeof(header)}};
+  // Failing to refresh only costs hashing again.
+  Status status = WriteCacheFile(src->cache_filepath, chunks, 2);
+  (void)status;
+}
+
+Status OpenCachedTexture(const TextureSource *src, const uchar *content,
+                         std::size_t content_size, CachedTexture *tex,
+                         int *is_hit) {
+  assert(src);
+  assert(tex);
+  assert(is_hit);
+
+  *tex = {};
+  *is_hit = 0;
+
+  int fd = open(src->cache_filepath, O_RDONLY);
+  if (fd < 0) {
+    // Not cached yet.
+    return errno == ENOENT ? kStatus_Ok : kStatus_IoError;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return kStatus_IoError;
+  }
+  std::size_t size = st.st_size;
+  if (size < sizeof(TextureCacheHeader)) {
+    close(fd);
+    return kStatus_Ok;
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  // Reads the file in now, on the calling thread, rather than on first use.
+  flags |= MAP_POPULATE;
+#endif
+  void *data = mmap(NULL, size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map file %s.\n", src->cache_filepath);
+    return kStatus_IoError;
+  }
+
+  const TextureCacheHeader *header = (const TextureCacheHeader *)data;
+  int is_up_to_date = 0;
+  if (IsValid(header, size) && header->source_size == src->size) {
+    if (header->source_mtime_nsec == src->mtime_nsec) {
+      is_up_to_date = 1;
+    } else if (content && content_size == src->size &&
+               header->source_hash == HashBytes(content, content_size)) {
+      is_up_to_date = 1;
+      RefreshCachedTexture(src, data, size);
+    }
+  }
+
+  if (!is_up_to_date) {
+    munmap(data, size);
+    return kStatus_Ok;
+  }
+
+  tex->data = data;
+  tex->size = size;
+  tex->image.pixels = (uchar *)data + header->pixels_offset;
+  tex->image.size = header->pixels_size;
+  tex->image.format = (TextureFormat)header->format;
+  tex->image.w = header->w;
+  tex->image.h = header->h;
+  tex->image.level_count = header->level_count;
+  *is_hit = 1;
+
+  return kStatus_Ok;
+}
+
+void CloseCachedTexture(CachedTexture *tex) {
+  assert(tex);
+
+  if (tex->data) {
+    munmap(tex->data, tex->size);
+  }
+  *tex = {};
+}
+
+Status WriteCachedTexture(const TextureSource *src, const uchar *content,
+                          std::size_t content_size,
+                          const MipmappedImage *image) {
+  assert(src);
+  assert(content);
+  assert(image);
+  assert(image->pixels);
+
+  TextureCacheHeader header = {};
+  std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+  header.version = TEXTURE_CACHE_VERSION;
+  header.format = image->format;
+  header.w = image->w;
+  header.h = image->h;
+  header.level_count = image->level_count;
+  header.source_mtime_nsec = src->mtime_nsec;
+  header.source_size = content_size;
+  header.source_hash = HashBytes(content, content_size);
+  // Page aligned, so that the levels are page aligned in the mapping.
+  header.pixels_offset = TEXTURE_CACHE_PAGE_SIZE;
+  header.pixels_size = image->size;
+
+  uchar page[TEXTURE_CACHE_PAGE_SIZE] = {};
+  std::memcpy(page, &header, sizeof(header));
+  const CacheFileChunk chunks[] = {{page, sizeof(page)},
+                                   {image->pixels, image->size}};
+  return WriteCacheFile(src->cache_filepath, chunks, 2);
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef RCOASTER_TEXTURE_CACHE_HPP
+#define RCOASTER_TEXTURE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cache_file.hpp"
+#include "status.hpp"
+#include "texture_loader.hpp"
+#include "types.hpp"
+
+#define TEXTURE_CACHE_MAGIC "RCTXCACH"
+#define TEXTURE_CACHE_VERSION 2
+#define TEXTURE_CACHE_EXTENSION "rctx"
+
+/*
+Textures decoded from image files are cached on disk with all of their mipmap
+levels, so that later runs map them instead of decoding the image files.
+
+A cache file is named after a hash of the absolute path of its image file and
+the texture compression, so compressed and uncompressed textures are cached
+apart. It starts with a `TextureCacheHeader`, followed by the levels at
+`pixels_offset`, laid out as in `MipmappedImage` in the format of the header.
+A cache file is up to date if the modification time and size of the image file
+match, or else if the hash of its content does.
+*/
+struct TextureCacheHeader {
+  char magic[8];
+  std::uint32_t version;
+  // A `TextureFormat`.
+  std::uint32_t format;
+  std::uint32_t w;
+  std::uint32_t h;
+  std::uint32_t level_count;
+  std::int64_t source_mtime_nsec;
+  std::uint64_t source_size;
+  std::uint64_t source_hash;
+  std::uint64_t pixels_offset;
+  std::uint64_t pixels_size;
+};
+
+struct TextureSource {
+  const char *filepath;
+  std::int64_t mtime_nsec;
+  std::uint64_t size;
+  // Path of the cache file of the image file.
+  char cache_filepath[CACHE_FILEPATH_BUFFER_SIZE];
+};
+
+Status InitTextureSource(const char *cache_dir, const char *filepath,
+                         TextureCompression compression, TextureSource *src);
+
+/*
+Maps the cache file of an image file if it is up to date.
+
+Input Parameters:
+- content: the content of the image file, if it has been read. Without it,
+the cache file is only up to date if the modification time and size match
+
+Output Parameters:
+- is_hit: whether the cache file was up to date and has been mapped
+*/
+Status OpenCachedTexture(const TextureSource *src, const uchar *content,
+                         std::size_t content_size, CachedTexture *tex,
+                         int *is_hit);
+
+void CloseCachedTexture(CachedTexture *tex);
+
+// Writes the cache file of an image file with `WriteCacheFile`.
+Status WriteCachedTexture(const TextureSource *src, const uchar *content,
+                          std::size_t content_size,
+                          const MipmappedImage *image);
+
+#endif  // RCOASTER_TEXTURE_CACHE_HPP
\ No newline at end of file
@@ -0,0 +1,698 @@
+#include "texture_loader.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "bc.hpp"
+#include "profiler.hpp"
+#include "shader.hpp"
+#include "texture_cache.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Block rows of a level encoded per task.
+#define BC_BLOCK_ROWS_PER_TASK 16
+
+// Resolution of the table that encodes linear intensities to sRGB.
+#define LINEAR_TABLE_SIZE 4096
+
+static constexpr uint kChannelCount = 4;
+
+struct SrgbTables {
+  float to_linear[256];
+  uchar to_srgb[LINEAR_TABLE_SIZE];
+};
+
+static SrgbTables MakeSrgbTables() {
+  SrgbTables t;
+  for (uint i = 0; i < 256; ++i) {
+    float c = i / 255.0f;
+    t.to_linear[i] =
+        c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+  }
+  for (uint i = 0; i < LINEAR_TABLE_SIZE; ++i) {
+    float c = (float)i / (LINEAR_TABLE_SIZE - 1);
+    float srgb =
+        c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+    t.to_srgb[i] = (uchar)(srgb * 255 + 0.5f);
+  }
+  return t;
+}
+
+static const SrgbTables *GetSrgbTables() {
+  static const SrgbTables tables = MakeSrgbTables();
+  return &tables;
+}
+
+const char *const kTextureCompressionStrings[kTextureCompression__Count] = {
+    "none", "bc"};
+
+const char *String(TextureCompression c) {
+  assert(c < kTextureCompression__Count);
+  return kTextureCompressionStrings[c];
+}
+
+Status ParseTextureCompression(const char *s, TextureCompression *c) {
+  assert(s);
+  assert(c);
+
+  for (int i = 0; i < kTextureCompression__Count; ++i) {
+    if (std::strcmp(s, kTextureCompressionStrings[i]) == 0) {
+      *c = (TextureCompression)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown texture compression \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
+}
+
+std::size_t LevelSize(TextureFormat format, uint w, uint h) {
+  switch (format) {
+    case kTextureFormat_Rgba8: {
+      return (std::size_t)w * h * kChannelCount;
+    }
+    case kTextureFormat_Bc1: {
+      return BcImageSize(w, h, 0);
+    }
+    case kTextureFormat_Bc3: {
+      return BcImageSize(w, h, 1);
+    }
+    default: {
+      assert(false);
+      return 0;
+    }
+  }
+}
+
+std::size_t MipmapsSize(TextureFormat format, uint w, uint h,
+                        uint level_count) {
+  std::size_t size = 0;
+  for (uint i = 0; i < level_count; ++i) {
+    size += LevelSize(format, w, h);
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+  return size;
+}
+
+static uint LevelCount(uint w, uint h) {
+  uint count = 1;
+  while (w > 1 || h > 1) {
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+    ++count;
+  }
+  return count;
+}
+
+/*
+Averages 2 x 2 blocks of `src` into `dst`. The last row or column of an odd
+sized level is averaged with itself.
+
+Colors are sRGB encoded, so they are averaged as linear intensities. Otherwise
+smaller levels would darken.
+*/
+static void Downsample(const uchar *src, uint src_w, uint src_h, uchar *dst,
+                       uint dst_w, uint dst_h) {
+  const SrgbTables *t = GetSrgbTables();
+
+  for (uint y = 0; y < dst_h; ++y) {
+    const uchar *row0 = src + (std::size_t)std::min(y * 2, src_h - 1) * src_w *
+                                  kChannelCount;
+    const uchar *row1 = src + (std::size_t)std::min(y * 2 + 1, src_h - 1) *
+                                  src_w * kChannelCount;
+    uchar *out = dst + (std::size_t)y * dst_w * kChannelCount;
+
+    for (uint x = 0; x < dst_w; ++x) {
+      uint x0 = std::min(x * 2, src_w - 1) * kChannelCount;
+      uint x1 = std::min(x * 2 + 1, src_w - 1) * kChannelCount;
+      for (uint c = 0; c < kChannelCount - 1; ++c) {
+        float sum = t->to_linear[row0[x0 + c]] + t->to_linear[row0[x1 + c]] +
+                    t->to_linear[row1[x0 + c]] + t->to_linear[row1[x1 + c]];
+        out[x * kChannelCount + c] =
+            t->to_srgb[(uint)(sum * (0.25f * (LINEAR_TABLE_SIZE - 1)) + 0.5f)];
+      }
+      // Alpha is linear.
+      uint c = kChannelCount - 1;
+      uint sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+      out[x * kChannelCount + c] = (sum + 2) / 4;
+    }
+  }
+}
+
+Status MakeMipmaps(MipmappedImage *image) {
+  assert(image);
+  assert(image->pixels);
+
+  uint level_count = LevelCount(image->w, image->h);
+  std::size_t size =
+      MipmapsSize(kTextureFormat_Rgba8, image->w, image->h, level_count);
+
+  uchar *pixels = (uchar *)std::realloc(image->pixels, size);
+  if (!pixels) {
+    std::fprintf(stderr, "Failed to allocate mipmaps.\n");
+    return kStatus_UnspecifiedError;
+  }
+  image->pixels = pixels;
+  image->size = size;
+  image->format = kTextureFormat_Rgba8;
+  image->level_count = level_count;
+
+  uint w = image->w;
+  uint h = image->h;
+  for (uint i = 1; i < level_count; ++i) {
+    uint next_w = std::max(w / 2, 1u);
+    uint next_h = std::max(h / 2, 1u);
+    uchar *next = pixels + (std::size_t)w * h * kChannelCount;
+    Downsample(pixels, w, h, next, next_w, next_h);
+    pixels = next;
+    w = next_w;
+    h = next_h;
+  }
+
+  return kStatus_Ok;
+}
+
+struct EncodeBcLevelArgs {
+  const uchar *rgba;
+  uint w;
+  uint h;
+  int is_bc3;
+  uchar *out;
+};
+
+static void EncodeBcLevelRows(uint begin, uint end, void *arg) {
+  assert(arg);
+
+  const EncodeBcLevelArgs *args = (const EncodeBcLevelArgs *)arg;
+  EncodeBcRows(args->rgba, args->w, args->h, args->is_bc3, begin, end,
+               args->out);
+}
+
+Status CompressMipmaps(ThreadPool *pool, TextureFormat format,
+                       MipmappedImage *image) {
+  assert(pool);
+  assert(format == kTextureFormat_Bc1 || format == kTextureFormat_Bc3);
+  assert(image);
+  assert(image->pixels);
+  assert(image->format == kTextureFormat_Rgba8);
+
+  std::size_t size =
+      MipmapsSize(format, image->w, image->h, image->level_count);
+
+  uchar *blocks = (uchar *)std::malloc(size);
+  if (!blocks) {
+    std::fprintf(stderr, "Failed to allocate compressed mipmaps.\n");
+    return kStatus_UnspecifiedError;
+  }
+
+  const uchar *rgba = image->pixels;
+  uchar *out = blocks;
+  uint w = image->w;
+  uint h = image->h;
+  for (uint i = 0; i < image->level_count; ++i) {
+    EncodeBcLevelArgs args = {rgba, w, h, format == kTextureFormat_Bc3, out};
+    uint block_row_count = (h + BC_BLOCK_H - 1) / BC_BLOCK_H;
+    ParallelFor(pool, block_row_count, BC_BLOCK_ROWS_PER_TASK,
+                EncodeBcLevelRows, &args);
+
+    rgba += LevelSize(kTextureFormat_Rgba8, w, h);
+    out += LevelSize(format, w, h);
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+
+  std::free(image->pixels);
+  image->pixels = blocks;
+  image->size = size;
+  image->format = format;
+
+  return kStatus_Ok;
+}
+
+static int HasLayout(const MipmappedImage *image,
+                     const TextureLayout *layout) {
+  assert(image);
+  assert(layout);
+
+  return image->format == layout->format && image->w == layout->w &&
+         image->h == layout->h && image->level_count == layout->level_count;
+}
+
+// Decodes an image file and prepares its levels in the layout to upload.
+static Status MakeImage(const uchar *content, std::size_t size,
+                        const char *filepath, const TextureLayout *layout,
+                        ThreadPool *pool, MipmappedImage *image) {
+  assert(content);
+  assert(filepath);
+  assert(layout);
+  assert(image);
+
+  int w;
+  int h;
+  int channel_count;
+  image->pixels = stbi_load_from_memory(content, size, &w, &h, &channel_count,
+                                        kChannelCount);
+  if (!image->pixels) {
+    std::fprintf(stderr, "Failed to load image file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  image->w = w;
+  image->h = h;
+
+  // The texture array was allocated for the size in the header.
+  if (image->w != layout->w || image->h != layout->h) {
+    std::fprintf(stderr, "Image file %s changed while loading.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  Status status = MakeMipmaps(image);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  if (layout->format != kTextureFormat_Rgba8) {
+    status = CompressMipmaps(pool, layout->format, image);
+  }
+  return status;
+}
+
+// Takes the image from a cache file that was mapped, if it can be uploaded
+// into the layer of the load.
+static int UseCachedImage(TextureLoad *load) {
+  assert(load);
+
+  if (!HasLayout(&load->cached.image, &load->layout)) {
+    CloseCachedTexture(&load->cached);
+    return 0;
+  }
+  load->image = load->cached.image;
+  return 1;
+}
+
+// Maps the image from the texture cache, or else decodes it and caches it.
+static Status LoadCachedImage(TextureLoad *load, int *is_hit) {
+  assert(load);
+  assert(is_hit);
+
+  TextureLoader *loader = load->loader;
+
+  TextureSource src;
+  Status status = InitTextureSource(loader->cache_dir, load->filepath,
+                                    loader->compression, &src);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  // A cache file that fails to open, or that holds an image of another
+  // layout, is treated as missing.
+  status = OpenCachedTexture(&src, NULL, 0, &load->cached, is_hit);
+  if (status == kStatus_Ok && *is_hit) {
+    *is_hit = UseCachedImage(load);
+    if (*is_hit) {
+      return kStatus_Ok;
+    }
+  }
+
+  std::string content;
+  status = LoadFile(load->filepath, &content);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  // The modification time changed, but the content may not have.
+  status = OpenCachedTexture(&src, (const uchar *)content.data(),
+                             content.size(), &load->cached, is_hit);
+  if (status == kStatus_Ok && *is_hit) {
+    *is_hit = UseCachedImage(load);
+    if (*is_hit) {
+      return kStatus_Ok;
+    }
+  }
+
+  status = MakeImage((const uchar *)content.data(), content.size(),
+                     load->filepath, &load->layout, loader->pool,
+                     &load->image);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  // The texture is usable even if it could not be cached.
+  WriteCachedTexture(&src, (const uchar *)content.data(), content.size(),
+                     &load->image);
+
+  return kStatus_Ok;
+}
+
+// Called on a worker thread.
+static void DecodeTexture(void *arg) {
+  assert(arg);
+
+  TextureLoad *load = (TextureLoad *)arg;
+  TextureLoader *loader = load->loader;
+
+  {
+    ProfileScope scope(kProfilePhase_Textures);
+
+    if (loader->cache_dir) {
+      int is_hit = 0;
+      load->status = LoadCachedImage(load, &is_hit);
+      if (is_hit) {
+        ++loader->cache_hit_count;
+      }
+    } else {
+      std::string content;
+      load->status = LoadFile(load->filepath, &content);
+      if (load->status == kStatus_Ok) {
+        load->status = MakeImage((const uchar *)content.data(),
+                                 content.size(), load->filepath,
+                                 &load->layout, loader->pool, &load->image);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(loader->mutex);
+    loader->decoded_loads.push_back(load->index);
+  }
+  loader->load_decoded.notify_one();
+}
+
+static Status ReadTextureLayout(const char *filepath,
+                                TextureCompression compression,
+                                TextureLayout *layout) {
+  assert(filepath);
+  assert(layout);
+
+  int w;
+  int h;
+  int channel_count;
+  if (!stbi_info(filepath, &w, &h, &channel_count)) {
+    std::fprintf(stderr, "Failed to read header of image file %s.\n",
+                 filepath);
+    return kStatus_IoError;
+  }
+
+  layout->format = kTextureFormat_Rgba8;
+  if (compression == kTextureCompression_Bc) {
+    // Grey and RGB images have no alpha channel.
+    layout->format = channel_count == 2 || channel_count == 4
+                         ? kTextureFormat_Bc3
+                         : kTextureFormat_Bc1;
+  }
+  layout->w = w;
+  layout->h = h;
+  layout->level_count = LevelCount(w, h);
+
+  return kStatus_Ok;
+}
+
+static int IsSameLayout(const TextureLayout *a, const TextureLayout *b) {
+  assert(a);
+  assert(b);
+
+  return a->format == b->format && a->w == b->w && a->h == b->h &&
+         a->level_count == b->level_count;
+}
+
+static GLenum InternalFormat(TextureFormat format) {
+  switch (format) {
+    case kTextureFormat_Rgba8: {
+      return GL_RGBA8;
+    }
+    case kTextureFormat_Bc1: {
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+    case kTextureFormat_Bc3: {
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    default: {
+      assert(false);
+      return GL_NONE;
+    }
+  }
+}
+
+// Allocates every level of every layer of a texture array, without content.
+static GLuint MakeTextureArray(const TextureLayout *layout, uint layer_count,
+                               GLfloat anisotropy_degree) {
+  assert(layout);
+  assert(layer_count > 0);
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+  GLenum internal_format = InternalFormat(layout->format);
+  uint w = layout->w;
+  uint h = layout->h;
+  for (uint i = 0; i < layout->level_count; ++i) {
+    if (layout->format == kTextureFormat_Rgba8) {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, i, internal_format, w, h, layer_count,
+                   0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    } else {
+      glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, internal_format, w, h,
+                             layer_count, 0,
+                             LevelSize(layout->format, w, h) * layer_count,
+                             NULL);
+    }
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                  layout->level_count - 1);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                  anisotropy_degree);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  return texture;
+}
+
+Status BeginTextureLoads(const char *const *filepaths, uint count,
+                         GLfloat anisotropy_degree,
+                         TextureCompression compression,
+                         const char *cache_dir, ThreadPool *pool,
+                         TextureLayer *layers, TextureLoader *loader) {
+  assert(filepaths);
+  assert(compression < kTextureCompression__Count);
+  assert(pool);
+  assert(layers);
+  assert(loader);
+
+  std::vector<TextureLayout> layouts(count);
+  for (uint i = 0; i < count; ++i) {
+    Status status = ReadTextureLayout(filepaths[i], compression, &layouts[i]);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+  }
+
+  GLint max_layer_count;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layer_count);
+
+  // Each texture joins the array of the first texture of the same layout
+  // unless it is full, in which case the texture starts an array of its own.
+  std::vector<uint> first_of_array(count);
+  std::vector<uint> layer_counts(count, 0);
+  for (uint i = 0; i < count; ++i) {
+    uint first = i;
+    for (uint j = 0; j < i; ++j) {
+      if (first_of_array[j] == j && IsSameLayout(&layouts[i], &layouts[j]) &&
+          layer_counts[j] < (uint)max_layer_count) {
+        first = j;
+        break;
+      }
+    }
+    first_of_array[i] = first;
+    layers[i].layer = layer_counts[first]++;
+  }
+  for (uint i = 0; i < count; ++i) {
+    if (first_of_array[i] == i) {
+      layers[i].texture =
+          MakeTextureArray(&layouts[i], layer_counts[i], anisotropy_degree);
+    } else {
+      layers[i].texture = layers[first_of_array[i]].texture;
+    }
+  }
+
+  loader->pool = pool;
+  loader->compression = compression;
+  loader->cache_dir = cache_dir && cache_dir[0] != '\0' ? cache_dir : NULL;
+  loader->cache_hit_count = 0;
+  loader->uploaded_count = 0;
+  loader->status = kStatus_Ok;
+  glGenBuffers(1, &loader->pbo);
+
+  // Tasks point into the vector, so it must not be resized from here on.
+  loader->loads.resize(count);
+  for (uint i = 0; i < count; ++i) {
+    TextureLoad *load = &loader->loads[i];
+    *load = {};
+    load->loader = loader;
+    load->index = i;
+    load->filepath = filepaths[i];
+    load->layout = layouts[i];
+    load->layer = layers[i];
+    SubmitTask(pool, DecodeTexture, load);
+  }
+
+  return kStatus_Ok;
+}
+
+int IsTextureCompressionSupported(TextureCompression compression) {
+  assert(compression < kTextureCompression__Count);
+
+  if (compression == kTextureCompression_None) {
+    return 1;
+  }
+
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static Status UploadTexture(TextureLoad *load, GLuint pbo) {
+  assert(load);
+
+  ProfileScope scope(kProfilePhase_Upload);
+
+  const MipmappedImage *image = &load->image;
+
+  // Orphaning the storage lets the previous upload out of the buffer finish
+  // while this one is written.
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, image->size, NULL, GL_STREAM_DRAW);
+  void *dst = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, image->size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!dst) {
+    std::fprintf(stderr, "Failed to map pixel unpack buffer.\n");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return kStatus_GlError;
+  }
+  std::memcpy(dst, image->pixels, image->size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, load->layer.texture);
+
+  uint layer = load->layer.layer;
+  std::size_t offset = 0;
+  uint w = image->w;
+  uint h = image->h;
+  for (uint i = 0; i < image->level_count; ++i) {
+    std::size_t level_size = LevelSize(image->format, w, h);
+    if (image->format == kTextureFormat_Rgba8) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, w, h, 1, GL_RGBA,
+                      GL_UNSIGNED_BYTE, (const GLvoid *)offset);
+    } else {
+      glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, w, h, 1,
+                                InternalFormat(image->format), level_size,
+                                (const GLvoid *)offset);
+    }
+    offset += level_size;
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  return kStatus_Ok;
+}
+
+// Uploads the decoded texture at the front of the queue, waiting for one to be
+// decoded if `is_blocking`. Returns whether a texture was uploaded.
+static int UploadNextTexture(TextureLoader *loader, int is_blocking,
+                             Status *status) {
+  assert(loader);
+  assert(status);
+
+  uint index;
+  {
+    std::unique_lock<std::mutex> lock(loader->mutex);
+    if (is_blocking) {
+      loader->load_decoded.wait(
+          lock, [loader] { return !loader->decoded_loads.empty(); });
+    } else if (loader->decoded_loads.empty()) {
+      return 0;
+    }
+    index = loader->decoded_loads.front();
+    loader->decoded_loads.pop_front();
+  }
+
+  TextureLoad *load = &loader->loads[index];
+  *status = load->status;
+  if (*status == kStatus_Ok) {
+    *status = UploadTexture(load, loader->pbo);
+  }
+
+  if (load->cached.data) {
+    CloseCachedTexture(&load->cached);
+  } else {
+    std::free(load->image.pixels);
+  }
+  load->image.pixels = NULL;
+  ++loader->uploaded_count;
+
+  return 1;
+}
+
+void UploadDecodedTexture(TextureLoader *loader) {
+  assert(loader);
+  assert(loader->uploaded_count < loader->loads.size());
+
+  Status status;
+  UploadNextTexture(loader, 1, &status);
+  if (loader->status == kStatus_Ok) {
+    loader->status = status;
+  }
+}
+
+Status FinishTextureLoads(TextureLoader *loader) {
+  assert(loader);
+
+  // Every load is waited for, even after a failure, since the worker threads
+  // still write to them.
+  Status status = loader->status;
+  while (loader->uploaded_count < loader->loads.size()) {
+    Status load_status;
+    UploadNextTexture(loader, 1, &load_status);
+    if (status == kStatus_Ok) {
+      status = load_status;
+    }
+  }
+
+  glDeleteBuffers(1, &loader->pbo);
+  loader->pbo = 0;
+  loader->loads.clear();
+
+  return status;
+}
\ No newline at end of file
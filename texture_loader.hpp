@@ -0,0 +1,166 @@
+#ifndef RCOASTER_TEXTURE_LOADER_HPP
+#define RCOASTER_TEXTURE_LOADER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "opengl.hpp"
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+enum TextureFormat {
+  kTextureFormat_Rgba8,
+  // BC1 (DXT1) blocks of opaque images.
+  kTextureFormat_Bc1,
+  // BC3 (DXT5) blocks of images with alpha.
+  kTextureFormat_Bc3,
+  kTextureFormat__Count
+};
+
+enum TextureCompression {
+  kTextureCompression_None,
+  // BC1 for opaque images and BC3 otherwise, if the OpenGL implementation
+  // supports S3TC.
+  kTextureCompression_Bc,
+  kTextureCompression__Count
+};
+
+const char *String(TextureCompression c);
+
+Status ParseTextureCompression(const char *s, TextureCompression *c);
+
+// An image with its full chain of mipmap levels.
+struct MipmappedImage {
+  // Tightly packed levels, largest first, each with its top row first.
+  // Allocated with `std::malloc`.
+  uchar *pixels;
+  std::size_t size;
+  TextureFormat format;
+  uint w;
+  uint h;
+  uint level_count;
+};
+
+// Format and size of a texture. Textures of the same layout can be layers of
+// the same texture array.
+struct TextureLayout {
+  TextureFormat format;
+  uint w;
+  uint h;
+  uint level_count;
+};
+
+// A layer of a `GL_TEXTURE_2D_ARRAY` texture.
+struct TextureLayer {
+  GLuint texture;
+  uint layer;
+};
+
+// Returns the number of bytes of a level of `w` x `h` pixels.
+std::size_t LevelSize(TextureFormat format, uint w, uint h);
+
+// Returns the number of bytes of the first `level_count` levels of an image.
+std::size_t MipmapsSize(TextureFormat format, uint w, uint h,
+                        uint level_count);
+
+struct TextureLoader;
+
+// Mapping of a texture cache file.
+struct CachedTexture {
+  void *data;
+  std::size_t size;
+  // Points into the mapping.
+  MipmappedImage image;
+};
+
+struct TextureLoad {
+  TextureLoader *loader;
+  uint index;
+  const char *filepath;
+  TextureLayout layout;
+  TextureLayer layer;
+  // Points into `cached` if the image was loaded from the texture cache.
+  MipmappedImage image;
+  CachedTexture cached;
+  Status status;
+};
+
+/*
+Loads textures from image files, decoding them and calculating their mipmaps
+on a thread pool while the render thread does other work.
+
+Textures of the same layout are packed into layers of the same
+`GL_TEXTURE_2D_ARRAY` texture, so that draws of different textures can share
+a binding and sampler state. The layout of each texture is read from the
+header of its image file before decoding, so the arrays are allocated up front.
+
+The render thread uploads every texture into its layer once it has been
+decoded, through a pixel buffer object so that the copy into the texture can
+happen asynchronously.
+*/
+struct TextureLoader {
+  ThreadPool *pool;
+  TextureCompression compression;
+  // Null if textures are not cached.
+  const char *cache_dir;
+  std::atomic<uint> cache_hit_count;
+  std::vector<TextureLoad> loads;
+  GLuint pbo;
+  uint uploaded_count;
+  // Of the first texture uploaded by `UploadDecodedTexture` that failed.
+  Status status;
+
+  std::mutex mutex;
+  std::condition_variable load_decoded;
+  // Indices of the loads that have been decoded but not uploaded.
+  std::deque<uint> decoded_loads;
+};
+
+/*
+Makes the texture arrays and starts decoding the image files on the thread
+pool.
+
+Input Parameters:
+- filepaths: must outlive the loader
+- compression: must be supported, see `IsTextureCompressionSupported`
+- cache_dir: directory of the texture cache, which must exist. Null or empty
+disables the cache
+
+Output Parameters:
+- layers: the layer that each image is loaded into
+*/
+Status BeginTextureLoads(const char *const *filepaths, uint count,
+                         GLfloat anisotropy_degree,
+                         TextureCompression compression,
+                         const char *cache_dir, ThreadPool *pool,
+                         TextureLayer *layers, TextureLoader *loader);
+
+int IsTextureCompressionSupported(TextureCompression compression);
+
+// Waits for the next texture to be decoded and uploads it, so that each
+// texture is uploaded as soon as it is ready. Call from the render thread at
+// most once per texture. A failure is returned by `FinishTextureLoads`.
+void UploadDecodedTexture(TextureLoader *loader);
+
+// Waits for the remaining textures to be decoded, uploads them, and frees the
+// resources of the loader.
+Status FinishTextureLoads(TextureLoader *loader);
+
+/*
+Calculates the mipmap levels of an RGBA image down to 1 x 1 pixels with a box
+filter. Level 0 must already be in `image->pixels`, which is reallocated to
+hold every level.
+*/
+Status MakeMipmaps(MipmappedImage *image);
+
+// Encodes every level of an RGBA image as BC1 or BC3 blocks. The blocks are
+// encoded concurrently on the thread pool.
+Status CompressMipmaps(ThreadPool *pool, TextureFormat format,
+                       MipmappedImage *image);
+
+#endif  // RCOASTER_TEXTURE_LOADER_HPP
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+// The pool and queue index of the worker thread running on this thread, if any.
+static thread_local ThreadPool *current_pool;
+static thread_local uint current_worker_index;
+
+static int PopTask(ThreadPool *pool, TaskQueue *queue, int is_newest,
+                   Task *task) {
+  assert(pool);
+  assert(queue);
+  assert(task);
+
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (queue->tasks.empty()) {
+    return 0;
+  }
+  if (is_newest) {
+    *task = queue->tasks.back();
+    queue->tasks.pop_back();
+  } else {
+    *task = queue->tasks.front();
+    queue->tasks.pop_front();
+  }
+  --pool->queued_task_count;
+  return 1;
+}
+
+static int TakeTask(ThreadPool *pool, uint worker_index, Task *task) {
+  assert(pool);
+  assert(task);
+
+  if (PopTask(pool, &pool->worker_queues[worker_index], 1, task) ||
+      PopTask(pool, &pool->shared_queue, 0, task)) {
+    return 1;
+  }
+
+  for (uint i = 1; i < pool->worker_count; ++i) {
+    uint victim = (worker_index + i) % pool->worker_count;
+    if (PopTask(pool, &pool->worker_queues[victim], 0, task)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void RunWorker(ThreadPool *pool, uint worker_index) {
+  assert(pool);
+
+  current_pool = pool;
+  current_worker_index = worker_index;
+
+  for (;;) {
+    Task task;
+    if (!TakeTask(pool, worker_index, &task)) {
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      pool->queue_not_empty.wait(lock, [pool] {
+        return pool->queued_task_count > 0 || pool->is_stopping;
+      });
+      if (pool->queued_task_count == 0) {
+        return;
+      }
+      continue;
+    }
+
+    task.func(task.arg);
+
+    if (--pool->unfinished_task_count == 0) {
+      // Taken so that a waiter cannot miss the notification between checking
+      // the count and waiting.
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      pool->tasks_done.notify_all();
+    }
+  }
+}
+
+void InitThreadPool(uint thread_count, ThreadPool *pool) {
+  assert(pool);
+
+  if (thread_count == 0) {
+    uint hardware_thread_count = std::thread::hardware_concurrency();
+    thread_count = std::max(hardware_thread_count, 2u) - 1;
+  }
+
+  pool->worker_queues = new TaskQueue[thread_count];
+  pool->worker_count = thread_count;
+  pool->queued_task_count = 0;
+  pool->unfinished_task_count = 0;
+  pool->is_stopping = 0;
+
+  // Every queue exists before any worker thread can steal from it.
+  pool->threads.reserve(thread_count);
+  for (uint i = 0; i < thread_count; ++i) {
+    pool->threads.emplace_back(RunWorker, pool, i);
+  }
+}
+
+void SubmitTask(ThreadPool *pool, TaskFunc func, void *arg) {
+  assert(pool);
+  assert(func);
+
+  TaskQueue *queue = current_pool == pool
+                         ? &pool->worker_queues[current_worker_index]
+                         : &pool->shared_queue;
+  ++pool->unfinished_task_count;
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->tasks.push_back({func, arg});
+    ++pool->queued_task_count;
+  }
+
+  {
+    // Taken so that a worker thread cannot miss the notification between
+    // checking the count and waiting.
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    assert(!pool->is_stopping);
+  }
+  pool->queue_not_empty.notify_one();
+}
+
+void WaitForTasks(ThreadPool *pool) {
+  assert(pool);
+
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  pool->tasks_done.wait(lock,
+                        [pool] { return pool->unfinished_task_count == 0; });
+}
+
+// Shared by the threads taking part in a `ParallelFor`. Helper tasks may only
+// start after the loop has finished, so the last thread to leave frees it.
+struct ParallelForState {
+  RangeFunc func;
+  void *arg;
+  uint count;
+  uint grain_size;
+  std::atomic<uint> next;
+  std::atomic<uint> done_count;
+  std::atomic<uint> ref_count;
+  std::mutex mutex;
+  std::condition_variable all_done;
+};
+
+static void ReleaseParallelFor(ParallelForState *state) {
+  assert(state);
+
+  if (--state->ref_count == 0) {
+    delete state;
+  }
+}
+
+// Processes chunks until none are left.
+static void ProcessChunks(ParallelForState *state) {
+  assert(state);
+
+  for (;;) {
+    uint begin = state->next.fetch_add(state->grain_size);
+    if (begin >= state->count) {
+      return;
+    }
+    uint end = std::min(begin + state->grain_size, state->count);
+    state->func(begin, end, state->arg);
+
+    if (state->done_count.fetch_add(end - begin) + (end - begin) ==
+        state->count) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->all_done.notify_all();
+    }
+  }
+}
+
+static void RunParallelForHelper(void *arg) {
+  assert(arg);
+
+  ParallelForState *state = (ParallelForState *)arg;
+  ProcessChunks(state);
+  ReleaseParallelFor(state);
+}
+
+void ParallelFor(ThreadPool *pool, uint count, uint grain_size,
+                 RangeFunc func, void *arg) {
+  assert(pool);
+  assert(grain_size > 0);
+  assert(func);
+
+  if (count == 0) {
+    return;
+  }
+
+  uint chunk_count = (count - 1) / grain_size + 1;
+  uint helper_count =
+      std::min<std::size_t>(chunk_count - 1, pool->threads.size());
+  if (helper_count == 0) {
+    func(0, count, arg);
+    return;
+  }
+
+  ParallelForState *state = new ParallelForState;
+  state->func = func;
+  state->arg = arg;
+  state->count = count;
+  state->grain_size = grain_size;
+  state->next = 0;
+  state->done_count = 0;
+  state->ref_count = helper_count + 1;
+
+  for (uint i = 0; i < helper_count; ++i) {
+    SubmitTask(pool, RunParallelForHelper, state);
+  }
+
+  ProcessChunks(state);
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->all_done.wait(
+        lock, [state] { return state->done_count == state->count; });
+  }
+  ReleaseParallelFor(state);
+}
+
+void FreeThreadPool(ThreadPool *pool) {
+  assert(pool);
+
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->is_stopping = 1;
+  }
+  pool->queue_not_empty.notify_all();
+
+  for (std::thread &t : pool->threads) {
+    t.join();
+  }
+  pool->threads.clear();
+
+  delete[] pool->worker_queues;
+  pool->worker_queues = NULL;
+  pool->worker_count = 0;
+}
\ No newline at end of file
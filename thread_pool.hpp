@@ -0,0 +1,75 @@
+#ifndef RCOASTER_THREAD_POOL_HPP
+#define RCOASTER_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+typedef void (*TaskFunc)(void *arg);
+
+// Processes the items in `[begin, end)`.
+typedef void (*RangeFunc)(uint begin, uint end, void *arg);
+
+struct Task {
+  TaskFunc func;
+  void *arg;
+};
+
+struct TaskQueue {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+};
+
+/*
+A fixed set of worker threads that share work by stealing.
+
+Each worker thread has a queue of its own. Tasks submitted from a worker
+thread go to the back of its queue, and tasks submitted from other threads go
+to the back of a shared queue. A worker thread takes the newest task of its own
+queue first, then the oldest of the shared queue, then steals the oldest of
+another worker thread.
+*/
+struct ThreadPool {
+  std::mutex mutex;
+  std::condition_variable queue_not_empty;
+  std::condition_variable tasks_done;
+  TaskQueue shared_queue;
+  // One per worker thread.
+  TaskQueue *worker_queues;
+  uint worker_count;
+  // Tasks that have been submitted and not taken off a queue yet.
+  std::atomic<uint> queued_task_count;
+  // Tasks that have been submitted and have not returned yet.
+  std::atomic<uint> unfinished_task_count;
+  int is_stopping;
+  std::vector<std::thread> threads;
+};
+
+// Zero uses every hardware thread but one.
+void InitThreadPool(uint thread_count, ThreadPool *pool);
+
+void SubmitTask(ThreadPool *pool, TaskFunc func, void *arg);
+
+// Waits until every submitted task has returned.
+void WaitForTasks(ThreadPool *pool);
+
+/*
+Calls `func` on chunks of up to `grain_size` items that together cover
+`[0, count)`, concurrently on the calling thread and the worker threads, and
+returns once every chunk has been processed.
+
+The calling thread processes chunks too, so it may be a worker thread of the
+same pool without risking a deadlock.
+*/
+void ParallelFor(ThreadPool *pool, uint count, uint grain_size,
+                 RangeFunc func, void *arg);
+
+// Runs the tasks still queued, then stops the worker threads.
+void FreeThreadPool(ThreadPool *pool);
+
+#endif  // RCOASTER_THREAD_POOL_HPP
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "tiled_capture.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#include "offscreen.hpp"
+#include "opengl.hpp"
+#include "qoi.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static constexpr uint kChannelCount = 4;
+
+/*
+The average of a box is `((sum + count / 2) * reciprocal) >> 16`, which is
+within one of the rounded quotient and never above 255 for the counts allowed.
+Unlike a division, it maps onto 16-bit high multiplies.
+*/
+static inline uint Reciprocal(uint count) {
+  return (65536 + count - 1) / count;
+}
+
+static void SumColumns(const uchar *src, std::ptrdiff_t stride, uint n,
+                       uint row_count, std::uint16_t *sums) {
+  uint i = 0;
+
+#if defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i lo = zero;
+    __m128i hi = zero;
+    for (uint k = 0; k < row_count; ++k) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + k * stride + i));
+      lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+      hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+    }
+    _mm_storeu_si128((__m128i *)(sums + i), lo);
+    _mm_storeu_si128((__m128i *)(sums + i + 8), hi);
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    uint16x8_t lo = vdupq_n_u16(0);
+    uint16x8_t hi = vdupq_n_u16(0);
+    for (uint k = 0; k < row_count; ++k) {
+      uint8x16_t v = vld1q_u8(src + k * stride + i);
+      lo = vaddw_u8(lo, vget_low_u8(v));
+      hi = vaddw_u8(hi, vget_high_u8(v));
+    }
+    vst1q_u16(sums + i, lo);
+    vst1q_u16(sums + i + 8, hi);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    uint sum = 0;
+    for (uint k = 0; k < row_count; ++k) {
+      sum += src[k * stride + i];
+    }
+    sums[i] = sum;
+  }
+}
+
+void DownsampleBox(const uchar *src, std::ptrdiff_t stride, uint w,
+                   uint factor, std::uint16_t *sums, uchar *dst) {
+  assert(src);
+  assert(factor >= 2 && factor <= TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR);
+  assert(sums);
+  assert(dst);
+
+  SumColumns(src, stride, w * factor * kChannelCount, factor, sums);
+
+  uint count = factor * factor;
+  uint bias = count / 2;
+  uint reciprocal = Reciprocal(count);
+  std::ptrdiff_t pixel_stride = factor * kChannelCount;
+
+  uint x = 0;
+
+#if defined(__SSE2__)
+  // Two pixels at a time.
+  __m128i bias_v = _mm_set1_epi16(bias);
+  __m128i reciprocal_v = _mm_set1_epi16(reciprocal);
+  for (; x + 2 <= w; x += 2) {
+    const std::uint16_t *s = sums + x * pixel_stride;
+    __m128i sum = _mm_setzero_si128();
+    for (uint k = 0; k < factor; ++k) {
+      __m128i a = _mm_loadl_epi64((const __m128i *)(s + k * kChannelCount));
+      __m128i b = _mm_loadl_epi64(
+          (const __m128i *)(s + pixel_stride + k * kChannelCount));
+      sum = _mm_add_epi16(sum, _mm_unpacklo_epi64(a, b));
+    }
+    __m128i avg = _mm_mulhi_epu16(_mm_add_epi16(sum, bias_v), reciprocal_v);
+    _mm_storel_epi64((__m128i *)(dst + x * kChannelCount),
+                     _mm_packus_epi16(avg, avg));
+  }
+#elif defined(__ARM_NEON)
+  uint16x8_t bias_v = vdupq_n_u16(bias);
+  uint16x4_t reciprocal_v = vdup_n_u16(reciprocal);
+  for (; x + 2 <= w; x += 2) {
+    const std::uint16_t *s = sums + x * pixel_stride;
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (uint k = 0; k < factor; ++k) {
+      uint16x4_t a = vld1_u16(s + k * kChannelCount);
+      uint16x4_t b = vld1_u16(s + pixel_stride + k * kChannelCount);
+      sum = vaddq_u16(sum, vcombine_u16(a, b));
+    }
+    sum = vaddq_u16(sum, bias_v);
+    uint32x4_t lo = vmull_u16(vget_low_u16(sum), reciprocal_v);
+    uint32x4_t hi = vmull_u16(vget_high_u16(sum), reciprocal_v);
+    uint16x8_t avg = vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+    vst1_u8(dst + x * kChannelCount, vmovn_u16(avg));
+  }
+#endif
+
+  for (; x < w; ++x) {
+    const std::uint16_t *s = sums + x * pixel_stride;
+    for (uint c = 0; c < kChannelCount; ++c) {
+      uint sum = 0;
+      for (uint k = 0; k < factor; ++k) {
+        sum += s[k * kChannelCount + c];
+      }
+      dst[x * kChannelCount + c] = (sum + bias) * reciprocal >> 16;
+    }
+  }
+}
+
+/*
+Maps the clip space of the whole image to the clip space of the tile whose
+bottom left corner is at `(x, y)` pixels. Applied after the projection, it
+narrows the frustum to the tile.
+*/
+static glm::mat4 TileMatrix(uint image_w, uint image_h, uint x, uint y,
+                            uint tile_size) {
+  glm::mat4 m(1);
+  m[0][0] = (float)image_w / tile_size;
+  m[1][1] = (float)image_h / tile_size;
+  m[3][0] = ((float)image_w - 2.0f * x - tile_size) / tile_size;
+  m[3][1] = ((float)image_h - 2.0f * y - tile_size) / tile_size;
+  return m;
+}
+
+static uint TileSize(uint max_tile_size, uint factor) {
+  GLint max_renderbuffer_size;
+  glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer_size);
+  GLint max_viewport_dims[2];
+  glGetIntegerv(GL_MAX_VIEWPORT_DIMS, max_viewport_dims);
+
+  uint size = std::min<uint>(max_tile_size, max_renderbuffer_size);
+  size = std::min<uint>(size, max_viewport_dims[0]);
+  size = std::min<uint>(size, max_viewport_dims[1]);
+  // Output rows must not straddle rows of tiles.
+  return size - size % factor;
+}
+
+static Status RenderTiles(const TiledCaptureConfig *cfg, uint tile_size,
+                          QoiEncoder *enc) {
+  assert(cfg);
+  assert(enc);
+
+  uint factor = cfg->supersample_factor;
+  uint image_w = cfg->w * factor;
+  uint image_h = cfg->h * factor;
+  std::ptrdiff_t stride = (std::ptrdiff_t)image_w * kChannelCount;
+
+  std::vector<uchar> stripe((std::size_t)stride * tile_size);
+  std::vector<std::uint16_t> sums;
+  std::vector<uchar> rows;
+  if (factor > 1) {
+    sums.resize(stride);
+    rows.resize((std::size_t)cfg->w * kChannelCount * (tile_size / factor));
+  }
+
+  glViewport(0, 0, tile_size, tile_size);
+  glPixelStorei(GL_PACK_ROW_LENGTH, image_w);
+
+  Status status = kStatus_Ok;
+
+  // Rows of tiles from the top, as the encoder expects.
+  for (uint top = 0; top < image_h && status == kStatus_Ok; top += tile_size) {
+    uint stripe_h = std::min(tile_size, image_h - top);
+    uint y = image_h - top - stripe_h;
+
+    for (uint x = 0; x < image_w; x += tile_size) {
+      glm::mat4 projection =
+          TileMatrix(image_w, image_h, x, y, tile_size) * cfg->projection;
+      cfg->draw(&projection, cfg->user_data);
+
+      // Tiles at the top and right edges are only partly in the image.
+      uint tile_w = std::min(tile_size, image_w - x);
+      glReadPixels(0, 0, tile_w, stripe_h, GL_RGBA, GL_UNSIGNED_BYTE,
+                   stripe.data() + (std::size_t)x * kChannelCount);
+    }
+
+    // The stripe is read back bottom row first.
+    const uchar *top_row = stripe.data() + (stripe_h - 1) * stride;
+    if (factor == 1) {
+      status = EncodeQoiRows(top_row, -stride, stripe_h, enc);
+      continue;
+    }
+
+    uint row_count = stripe_h / factor;
+    for (uint i = 0; i < row_count; ++i) {
+      const uchar *src = stripe.data() + (stripe_h - (i + 1) * factor) * stride;
+      DownsampleBox(src, stride, cfg->w, factor, sums.data(),
+                    rows.data() + (std::size_t)i * cfg->w * kChannelCount);
+    }
+    status = EncodeQoiRows(rows.data(), (std::ptrdiff_t)cfg->w * kChannelCount,
+                           row_count, enc);
+  }
+
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+  return status;
+}
+
+Status WriteTiledQoiFile(const char *filepath, const TiledCaptureConfig *cfg) {
+  assert(filepath);
+  assert(cfg);
+  assert(cfg->w > 0);
+  assert(cfg->h > 0);
+  assert(cfg->supersample_factor >= 1 &&
+         cfg->supersample_factor <= TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR);
+  assert(cfg->draw);
+
+  uint factor = cfg->supersample_factor;
+  if ((std::uint64_t)cfg->w * factor * kChannelCount > 1u << 31 ||
+      (std::uint64_t)cfg->h * factor > 1u << 31) {
+    std::fprintf(stderr, "Tiled image of %u x %u pixels is too large.\n",
+                 cfg->w, cfg->h);
+    return kStatus_UnspecifiedError;
+  }
+
+  uint tile_size = TileSize(cfg->max_tile_size, factor);
+  if (tile_size == 0) {
+    std::fprintf(stderr, "Tile size is smaller than the supersample factor.\n");
+    return kStatus_UnspecifiedError;
+  }
+
+  GLint framebuffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  Framebuffer fb;
+  Status status = MakeFramebuffer(tile_size, tile_size, &fb);
+  if (status != kStatus_Ok) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    return status;
+  }
+
+  std::FILE *file = std::fopen(filepath, "wb");
+  if (!file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    status = kStatus_IoError;
+  }
+
+  if (status == kStatus_Ok) {
+    QoiEncoder *enc = new QoiEncoder;
+
+    // The alpha channel is ignored.
+    status = BeginQoi(cfg->w, cfg->h, 3, WriteQoiToFile, file, enc);
+    if (status == kStatus_Ok) {
+      status = RenderTiles(cfg, tile_size, enc);
+    }
+    if (status == kStatus_Ok) {
+      status = EndQoi(enc);
+    }
+
+    delete enc;
+
+    int rc = std::fclose(file);
+    if (status != kStatus_Ok || rc != 0) {
+      std::fprintf(stderr, "Failed to write file %s.\n", filepath);
+      status = kStatus_IoError;
+    }
+  }
+
+  FreeFramebuffer(&fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef RCOASTER_TILED_CAPTURE_HPP
+#define RCOASTER_TILED_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+
+#include "status.hpp"
+#include "types.hpp"
+
+// Box filter sums of `factor * factor` 8-bit values must fit in 16 bits.
+#define TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR 16
+
+// Draws the scene into the bound framebuffer with the given projection matrix.
+typedef void (*DrawTileFunc)(const glm::mat4 *projection, void *user_data);
+
+struct TiledCaptureConfig {
+  // Size of the image, in pixels.
+  uint w;
+  uint h;
+  // Each pixel of the image is the average of `supersample_factor *
+  // supersample_factor` rendered pixels. 1 disables supersampling.
+  uint supersample_factor;
+  // Largest edge length of a tile, in rendered pixels. Also limited by the
+  // maximum renderbuffer and viewport sizes.
+  uint max_tile_size;
+  glm::mat4 projection;
+  DrawTileFunc draw;
+  void *user_data;
+};
+
+/*
+Renders an image of any size and saves it as a QOI file.
+
+The image is rendered as a grid of tiles into a framebuffer of one tile. Each
+tile is drawn with the sub-frustum of `projection` that covers it. Tiles are
+rendered a row at a time, and each row of tiles is downsampled and streamed
+into the encoder, so at most one row of tiles is in memory at once.
+
+The bound framebuffer and viewport are restored afterwards.
+*/
+Status WriteTiledQoiFile(const char *filepath, const TiledCaptureConfig *cfg);
+
+/*
+Downsamples `factor` rows of RGBA pixels into one row with a box filter.
+
+Input Parameters:
+- src: first pixel of the first row, with `w * factor` pixels per row
+- stride: distance in bytes from a source row to the next one
+- factor: 2 to `TILED_CAPTURE_MAX_SUPERSAMPLE_FACTOR`
+- sums: scratch space of `w * factor * 4` elements
+
+Output Parameters:
+- dst: `w` pixels
+*/
+void DownsampleBox(const uchar *src, std::ptrdiff_t stride, uint w,
+                   uint factor, std::uint16_t *sums, uchar *dst);
+
+#endif  // RCOASTER_TILED_CAPTURE_HPP
\ No newline at end of file
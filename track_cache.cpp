@@ -0,0 +1,303 @@
+#include "track_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "cache_file.hpp"
+
+#define TRACK_CACHE_PAGE_SIZE 4096
+#define TRACK_CACHE_ARRAY_COUNT 12
+
+static_assert(sizeof(TrackCacheHeader) <= TRACK_CACHE_PAGE_SIZE, "");
+
+struct TrackArray {
+  void *data;
+  std::size_t size;
+};
+
+static Status ExtendHashWithFile(std::uint64_t hash, const char *filepath,
+                                 std::uint64_t *extended) {
+  assert(filepath);
+  assert(extended);
+
+  char path[PATH_MAX];
+  if (!realpath(filepath, path)) {
+    std::fprintf(stderr, "Failed to resolve path of file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    std::fprintf(stderr, "Failed to get status of file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+  std::uint64_t size = st.st_size;
+  std::int64_t mtime_nsec = MtimeNsec(&st);
+
+  // The terminator separates the path from the numbers.
+  hash = ExtendHash(hash, path, std::strlen(path) + 1);
+  hash = ExtendHash(hash, &size, sizeof(size));
+  *extended = ExtendHash(hash, &mtime_nsec, sizeof(mtime_nsec));
+
+  return kStatus_Ok;
+}
+
+Status TrackCacheKey(const SceneConfig *cfg,
+                     const std::vector<std::string> *spline_filepaths,
+                     std::uint64_t *key) {
+  assert(cfg);
+  assert(cfg->track_filepath);
+  assert(spline_filepaths);
+  assert(key);
+
+  const float params[] = {cfg->max_spline_segment_len,
+                          cfg->spline_simplify_tolerance,
+                          cfg->rails_color.r,
+                          cfg->rails_color.g,
+                          cfg->rails_color.b,
+                          cfg->rails_color.a,
+                          cfg->rails_head_w,
+                          cfg->rails_head_h,
+                          cfg->rails_web_w,
+                          cfg->rails_web_h,
+                          cfg->rails_gauge,
+                          cfg->rails_pos_offset_in_camspl_norm_dir,
+                          cfg->crossties_separation_dist,
+                          cfg->crossties_pos_offset_in_camspl_norm_dir};
+
+  std::uint64_t hash = CACHE_HASH_SEED;
+  hash = ExtendHash(hash, params, sizeof(params));
+  // Tracks over the limit are streamed rather than cached.
+  std::uint64_t max_batch_vertex_count = cfg->max_batch_vertex_count;
+  hash = ExtendHash(hash, &max_batch_vertex_count,
+                    sizeof(max_batch_vertex_count));
+
+  std::uint64_t max_camera_path_vertex_count =
+      cfg->max_camera_path_vertex_count;
+  hash = ExtendHash(hash, &max_camera_path_vertex_count,
+                    sizeof(max_camera_path_vertex_count));
+
+  Status status = ExtendHashWithFile(hash, cfg->track_filepath, &hash);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+  for (const std::string &filepath : *spline_filepaths) {
+    status = ExtendHashWithFile(hash, filepath.c_str(), &hash);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+  }
+
+  *key = hash;
+  return kStatus_Ok;
+}
+
+static Status MakeCacheFilepath(const char *cache_dir, std::uint64_t key,
+                                char *filepath) {
+  assert(cache_dir);
+  assert(filepath);
+
+  int rc = std::snprintf(filepath, CACHE_FILEPATH_BUFFER_SIZE,
+                         "%s/%016llx.%s", cache_dir, (unsigned long long)key,
+                         TRACK_CACHE_EXTENSION);
+  if (rc < 0 || rc >= CACHE_FILEPATH_BUFFER_SIZE) {
+    std::fprintf(stderr, "Failed to make track cache filepath.\n");
+    return kStatus_UnspecifiedError;
+  }
+  return kStatus_Ok;
+}
+
+// Lists the arrays of a track in the order of the cache file.
+static void ListArrays(const Scene *scene, TrackArray *arrays) {
+  assert(scene);
+  assert(arrays);
+
+  const VertexList1P1T1N1B *camspl = &scene->camspl.mesh->vl1p1t1n1b;
+  const Mesh *left_rail = scene->left_rail.mesh;
+  const Mesh *right_rail = scene->right_rail.mesh;
+  const VertexList1P1UV *crossties = &scene->crossties.mesh->vl1p1uv;
+
+  arrays[0] = {camspl->positions, camspl->count * sizeof(glm::vec3)};
+  arrays[1] = {camspl->tangents, camspl->count * sizeof(glm::vec3)};
+  arrays[2] = {camspl->normals, camspl->count * sizeof(glm::vec3)};
+  arrays[3] = {camspl->binormals, camspl->count * sizeof(glm::vec3)};
+  arrays[4] = {left_rail->vl1p1c.positions,
+               left_rail->vl1p1c.count * sizeof(glm::vec3)};
+  arrays[5] = {right_rail->vl1p1c.positions,
+               right_rail->vl1p1c.count * sizeof(glm::vec3)};
+  arrays[6] = {left_rail->vl1p1c.colors,
+               left_rail->vl1p1c.count * sizeof(glm::vec4)};
+  arrays[7] = {right_rail->vl1p1c.colors,
+               right_rail->vl1p1c.count * sizeof(glm::vec4)};
+  arrays[8] = {left_rail->indices, left_rail->index_count * sizeof(uint)};
+  arrays[9] = {right_rail->indices, right_rail->index_count * sizeof(uint)};
+  arrays[10] = {crossties->positions, crossties->count * sizeof(glm::vec3)};
+  arrays[11] = {crossties->uv, crossties->count * sizeof(glm::vec2)};
+}
+
+static void SetCounts(const TrackCacheHeader *header, Scene *scene) {
+  assert(header);
+  assert(scene);
+
+  scene->camspl.mesh->vl1p1t1n1b.count = header->camspl_vertex_count;
+  scene->left_rail.mesh->vl1p1c.count = header->left_rail_vertex_count;
+  scene->right_rail.mesh->vl1p1c.count = header->right_rail_vertex_count;
+  scene->left_rail.mesh->index_count = header->left_rail_index_count;
+  scene->right_rail.mesh->index_count = header->right_rail_index_count;
+  scene->crossties.mesh->vl1p1uv.count = header->crossties_vertex_count;
+}
+
+static void SetArrays(uchar *data, Scene *scene) {
+  assert(data);
+  assert(scene);
+
+  TrackArray arrays[TRACK_CACHE_ARRAY_COUNT];
+  ListArrays(scene, arrays);
+  for (uint i = 0; i < TRACK_CACHE_ARRAY_COUNT; ++i) {
+    arrays[i].data = data;
+    data += arrays[i].size;
+  }
+
+  VertexList1P1T1N1B *camspl = &scene->camspl.mesh->vl1p1t1n1b;
+  camspl->positions = (glm::vec3 *)arrays[0].data;
+  camspl->tangents = (glm::vec3 *)arrays[1].data;
+  camspl->normals = (glm::vec3 *)arrays[2].data;
+  camspl->binormals = (glm::vec3 *)arrays[3].data;
+  scene->left_rail.mesh->vl1p1c.positions = (glm::vec3 *)arrays[4].data;
+  scene->right_rail.mesh->vl1p1c.positions = (glm::vec3 *)arrays[5].data;
+  scene->left_rail.mesh->vl1p1c.colors = (glm::vec4 *)arrays[6].data;
+  scene->right_rail.mesh->vl1p1c.colors = (glm::vec4 *)arrays[7].data;
+  scene->left_rail.mesh->indices = (uint *)arrays[8].data;
+  scene->right_rail.mesh->indices = (uint *)arrays[9].data;
+  scene->crossties.mesh->vl1p1uv.positions = (glm::vec3 *)arrays[10].data;
+  scene->crossties.mesh->vl1p1uv.uv = (glm::vec2 *)arrays[11].data;
+}
+
+static std::uint64_t ArraysSize(const Scene *scene) {
+  assert(scene);
+
+  TrackArray arrays[TRACK_CACHE_ARRAY_COUNT];
+  ListArrays(scene, arrays);
+  std::uint64_t size = 0;
+  for (uint i = 0; i < TRACK_CACHE_ARRAY_COUNT; ++i) {
+    size += arrays[i].size;
+  }
+  return size;
+}
+
+Status OpenCachedTrack(const char *cache_dir, std::uint64_t key, Scene *scene,
+                       int *is_hit) {
+  assert(cache_dir);
+  assert(scene);
+  assert(is_hit);
+
+  *is_hit = 0;
+
+  char filepath[CACHE_FILEPATH_BUFFER_SIZE];
+  Status status = MakeCacheFilepath(cache_dir, key, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    // Not cached yet.
+    return errno == ENOENT ? kStatus_Ok : kStatus_IoError;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return kStatus_IoError;
+  }
+  std::size_t size = st.st_size;
+  if (size < sizeof(TrackCacheHeader)) {
+    close(fd);
+    return kStatus_Ok;
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  // Everything but the camera path is uploaded right away.
+  flags |= MAP_POPULATE;
+#endif
+  void *data = mmap(NULL, size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::fprintf(stderr, "Failed to map file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  const TrackCacheHeader *header = (const TrackCacheHeader *)data;
+  if (std::memcmp(header->magic, TRACK_CACHE_MAGIC, sizeof(header->magic)) !=
+          0 ||
+      header->version != TRACK_CACHE_VERSION || header->key != key ||
+      header->arrays_offset > size ||
+      header->arrays_size > size - header->arrays_offset) {
+    munmap(data, size);
+    return kStatus_Ok;
+  }
+
+  SetCounts(header, scene);
+  if (ArraysSize(scene) != header->arrays_size) {
+    munmap(data, size);
+    return kStatus_Ok;
+  }
+  SetArrays((uchar *)data + header->arrays_offset, scene);
+
+  scene->track_cache_data = data;
+  scene->track_cache_size = size;
+  *is_hit = 1;
+
+  return kStatus_Ok;
+}
+
+Status WriteCachedTrack(const char *cache_dir, std::uint64_t key,
+                        const Scene *scene) {
+  assert(cache_dir);
+  assert(scene);
+
+  TrackCacheHeader header = {};
+  std::memcpy(header.magic, TRACK_CACHE_MAGIC, sizeof(header.magic));
+  header.version = TRACK_CACHE_VERSION;
+  header.camspl_vertex_count = scene->camspl.mesh->vl1p1t1n1b.count;
+  header.left_rail_vertex_count = scene->left_rail.mesh->vl1p1c.count;
+  header.right_rail_vertex_count = scene->right_rail.mesh->vl1p1c.count;
+  header.left_rail_index_count = scene->left_rail.mesh->index_count;
+  header.right_rail_index_count = scene->right_rail.mesh->index_count;
+  header.crossties_vertex_count = scene->crossties.mesh->vl1p1uv.count;
+  header.key = key;
+  // Page aligned, so that the arrays are page aligned in the mapping.
+  header.arrays_offset = TRACK_CACHE_PAGE_SIZE;
+  header.arrays_size = ArraysSize(scene);
+
+  char filepath[CACHE_FILEPATH_BUFFER_SIZE];
+  Status status = MakeCacheFilepath(cache_dir, key, filepath);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  uchar page[TRACK_CACHE_PAGE_SIZE] = {};
+  std::memcpy(page, &header, sizeof(header));
+  TrackArray arrays[TRACK_CACHE_ARRAY_COUNT];
+  ListArrays(scene, arrays);
+  CacheFileChunk chunks[1 + TRACK_CACHE_ARRAY_COUNT];
+  chunks[0] = {page, sizeof(page)};
+  for (uint i = 0; i < TRACK_CACHE_ARRAY_COUNT; ++i) {
+    chunks[1 + i] = {arrays[i].data, arrays[i].size};
+  }
+
+  return WriteCacheFile(filepath, chunks, 1 + TRACK_CACHE_ARRAY_COUNT);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef RCOASTER_TRACK_CACHE_HPP
+#define RCOASTER_TRACK_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scene.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+#define TRACK_CACHE_MAGIC "RCTRKCAC"
+#define TRACK_CACHE_VERSION 2
+#define TRACK_CACHE_EXTENSION "rctk"
+
+/*
+The camera path, rails and crossties made from the splines of a track are
+cached on disk, so that later runs map them instead of making them.
+
+A cache file is named after its key, a hash of the parameters of the
+`SceneConfig` that shape the track, of its batch limit and of the absolute
+path, size and modification time of the track file and of each spline file. It
+starts with a `TrackCacheHeader`, followed by these arrays at `arrays_offset`,
+each laid out as it is uploaded:
+- positions, tangents, normals and binormals of the camera path
+- positions of the left then the right rail, then their colors
+- indices of the left then the right rail. Indices of the right rail are offset
+by the vertex count of the left rail
+- positions of the crossties, then their texture coordinates
+*/
+struct TrackCacheHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t padding;
+  std::uint64_t camspl_vertex_count;
+  std::uint64_t left_rail_vertex_count;
+  std::uint64_t right_rail_vertex_count;
+  std::uint64_t left_rail_index_count;
+  std::uint64_t right_rail_index_count;
+  std::uint64_t crossties_vertex_count;
+  std::uint64_t key;
+  std::uint64_t arrays_offset;
+  std::uint64_t arrays_size;
+};
+
+Status TrackCacheKey(const SceneConfig *cfg,
+                     const std::vector<std::string> *spline_filepaths,
+                     std::uint64_t *key);
+
+/*
+Maps the cache file of a track if it exists.
+
+The vertices and indices of the camera path, rails and crossties of the scene
+point into the mapping, which stays mapped for as long as the camera path is
+used. Their meshes must have been allocated.
+
+Output Parameters:
+- is_hit: whether the cache file exists and has been mapped
+*/
+Status OpenCachedTrack(const char *cache_dir, std::uint64_t key, Scene *scene,
+                       int *is_hit);
+
+// Writes the cache file of a track. The cache file is replaced atomically, so
+// concurrent readers see either the old or the new file.
+Status WriteCachedTrack(const char *cache_dir, std::uint64_t key,
+                        const Scene *scene);
+
+#endif  // RCOASTER_TRACK_CACHE_HPP
\ No newline at end of file
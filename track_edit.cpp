@@ -0,0 +1,507 @@
+#include "track_edit.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "cache_file.hpp"
+#include "profiler.hpp"
+#include "spline_io.hpp"
+#include "spline_simplify.hpp"
+
+// 6 faces of 2 triangles.
+static constexpr std::size_t kCrosstieVertexCount = 36;
+
+// Loads a spline file, and simplifies its control points as `MakeSceneTrack`
+// does.
+static Status LoadSpline(const SceneConfig *cfg, const char *filepath,
+                         Spline *spline) {
+  assert(cfg);
+  assert(filepath);
+  assert(spline);
+
+  Status status = LoadSplineFile(filepath, cfg->pool, spline);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+  if (cfg->spline_simplify_tolerance > 0) {
+    float max_deviation;
+    SimplifySplineCtrlPoints(cfg->spline_simplify_tolerance, cfg->pool,
+                             &spline->ctrl_points, &max_deviation);
+  }
+  return kStatus_Ok;
+}
+
+static uint SegmentCount(uint ctrl_point_count) {
+  return ctrl_point_count > 3 ? ctrl_point_count - 3 : 0;
+}
+
+// Appends the vertices of camera path vertices `[begin, end)` of a piece at
+// which crossties are placed, where `begin` is the first vertex of the piece
+// or a vertex with a crosstie.
+static void FindCrosstieVertices(const VertexList1P1T1N1B *camspl,
+                                 std::size_t begin, std::size_t end,
+                                 float separation_dist,
+                                 std::vector<std::size_t> *vertices) {
+  assert(camspl);
+  assert(vertices);
+
+  VertexList1P1T1N1B slice = SliceCameraPath(camspl, begin, end);
+  for (std::size_t i = NextCrosstieVertex(&slice, 0, separation_dist);
+       i < slice.count; i = NextCrosstieVertex(&slice, i, separation_dist)) {
+    vertices->push_back(begin + i);
+  }
+}
+
+static void FindAllCrosstieVertices(TrackEditor *editor) {
+  assert(editor);
+
+  const VertexList1P1T1N1B *camspl = &editor->scene->camspl.mesh->vl1p1t1n1b;
+  editor->crosstie_vertices.clear();
+  for (const TrackEditPiece &piece : editor->pieces) {
+    // Rails and crossties span at least two vertices.
+    if (piece.vertex_count < 2) {
+      continue;
+    }
+    FindCrosstieVertices(camspl, piece.vertex_begin,
+                         piece.vertex_begin + piece.vertex_count,
+                         editor->cfg->crossties_separation_dist,
+                         &editor->crosstie_vertices);
+  }
+}
+
+Status InitTrackEditor(const SceneConfig *cfg, Scene *scene,
+                       TrackEditor *editor) {
+  assert(cfg);
+  assert(scene);
+  assert(!scene->is_track_streamed);
+  assert(!scene->track_cache_data);
+  assert(editor);
+
+  editor->cfg = cfg;
+  editor->scene = scene;
+
+  std::vector<std::string> spline_filepaths;
+  Status status = ReadTrackFile(cfg->track_filepath, &spline_filepaths);
+  if (status != kStatus_Ok) {
+    return status;
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> tangents;
+  std::size_t vertex_begin = 0;
+  editor->pieces.resize(spline_filepaths.size());
+  for (uint i = 0; i < editor->pieces.size(); ++i) {
+    TrackEditPiece *piece = &editor->pieces[i];
+    piece->spline_filepath = spline_filepaths[i];
+
+    // Taken before loading, so that a modification while loading is reloaded.
+    struct stat st;
+    if (stat(piece->spline_filepath.c_str(), &st) != 0) {
+      std::fprintf(stderr, "Failed to get status of spline file %s.\n",
+                   piece->spline_filepath.c_str());
+      return kStatus_IoError;
+    }
+    piece->mtime_nsec = MtimeNsec(&st);
+
+    Spline spline;
+    status = LoadSpline(cfg, piece->spline_filepath.c_str(), &spline);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+    piece->ctrl_points.swap(spline.ctrl_points);
+
+    uint segment_count = SegmentCount(piece->ctrl_points.size());
+    piece->segment_vertex_counts.resize(segment_count);
+    piece->vertex_begin = vertex_begin;
+    piece->vertex_count = 0;
+    for (uint j = 0; j < segment_count; ++j) {
+      positions.clear();
+      tangents.clear();
+      AppendCatmullRomSegments(piece->ctrl_points.data(), j, j + 1,
+                               cfg->max_spline_segment_len, &positions,
+                               &tangents);
+      piece->segment_vertex_counts[j] = positions.size();
+      piece->vertex_count += positions.size();
+    }
+    vertex_begin += piece->vertex_count;
+  }
+
+  if (vertex_begin != scene->camspl.mesh->vl1p1t1n1b.count) {
+    std::fprintf(stderr,
+                 "Failed to edit track, whose splines have changed since it "
+                 "was made.\n");
+    return kStatus_UnspecifiedError;
+  }
+
+  FindAllCrosstieVertices(editor);
+
+  for (uint i = 0; i < 2; ++i) {
+    InitArena(ARENA_DEFAULT_BLOCK_SIZE, cfg->is_arena_huge_page_backed,
+              &editor->path_arenas[i]);
+  }
+  editor->next_path_arena = 0;
+  InitArena(ARENA_DEFAULT_BLOCK_SIZE, cfg->is_arena_huge_page_backed,
+            &editor->patch_arena);
+
+  return kStatus_Ok;
+}
+
+/*
+Replaces vertices `[begin, begin + old_count)` of the camera path by the given
+positions and tangents, in place if their counts are equal. The frames of the
+replaced vertices are left to be recomputed.
+*/
+static void SpliceCameraPath(TrackEditor *editor, std::size_t begin,
+                             std::size_t old_count,
+                             const std::vector<glm::vec3> *positions,
+                             const std::vector<glm::vec3> *tangents) {
+  assert(editor);
+  assert(positions);
+  assert(tangents);
+  assert(positions->size() == tangents->size());
+
+  VertexList1P1T1N1B *camspl = &editor->scene->camspl.mesh->vl1p1t1n1b;
+  std::size_t new_count = positions->size();
+  if (new_count == old_count) {
+    std::copy(positions->begin(), positions->end(), camspl->positions + begin);
+    std::copy(tangents->begin(), tangents->end(), camspl->tangents + begin);
+    return;
+  }
+
+  Arena *arena = &editor->path_arenas[editor->next_path_arena];
+  editor->next_path_arena ^= 1;
+  ResetArena(arena);
+
+  std::size_t old_end = begin + old_count;
+  std::size_t suffix_count = camspl->count - old_end;
+  VertexList1P1T1N1B path;
+  path.count = begin + new_count + suffix_count;
+  path.positions = ArenaAllocArray<glm::vec3>(arena, path.count);
+  path.tangents = ArenaAllocArray<glm::vec3>(arena, path.count);
+  path.normals = ArenaAllocArray<glm::vec3>(arena, path.count);
+  path.binormals = ArenaAllocArray<glm::vec3>(arena, path.count);
+
+  std::copy_n(camspl->positions, begin, path.positions);
+  std::copy_n(camspl->tangents, begin, path.tangents);
+  std::copy_n(camspl->normals, begin, path.normals);
+  std::copy_n(camspl->binormals, begin, path.binormals);
+  std::copy(positions->begin(), positions->end(), path.positions + begin);
+  std::copy(tangents->begin(), tangents->end(), path.tangents + begin);
+  std::copy_n(camspl->positions + old_end, suffix_count,
+              path.positions + begin + new_count);
+  std::copy_n(camspl->tangents + old_end, suffix_count,
+              path.tangents + begin + new_count);
+
+  *camspl = path;
+}
+
+// Makes the rails and crossties of the whole track again.
+static void RemakeTrackModels(TrackEditor *editor, TrackPatch *patch) {
+  assert(editor);
+  assert(patch);
+
+  std::vector<std::size_t> piece_vertex_counts;
+  for (const TrackEditPiece &piece : editor->pieces) {
+    piece_vertex_counts.push_back(piece.vertex_count);
+  }
+  RemakeSceneTrackModels(editor->cfg, piece_vertex_counts.data(),
+                         piece_vertex_counts.size(), &editor->patch_arena,
+                         editor->scene);
+  FindAllCrosstieVertices(editor);
+
+  *patch = {};
+  patch->is_resized = 1;
+}
+
+/*
+Makes the rails and crossties from camera path vertex `first_vertex` of a piece
+to the end of the track again, or the whole track if the number of crossties
+changed.
+
+The crossties of each piece are placed from its start, so the crossties from
+the last one of the piece before `first_vertex` on stay where they would be if
+the track were made again.
+*/
+static void PatchTrackModels(TrackEditor *editor, uint spline_index,
+                             std::size_t first_vertex, TrackPatch *patch) {
+  static constexpr std::size_t kRailCrossSectionVertexCount = 8;
+
+  assert(editor);
+  assert(spline_index < editor->pieces.size());
+  assert(patch);
+
+  const SceneConfig *cfg = editor->cfg;
+  Arena *arena = &editor->patch_arena;
+  const VertexList1P1T1N1B *camspl = &editor->scene->camspl.mesh->vl1p1t1n1b;
+  std::vector<std::size_t> *crosstie_vertices = &editor->crosstie_vertices;
+
+  // The rails of the pieces before are joined in order, without the pieces
+  // that have none.
+  std::size_t first_rail_vertex = 0;
+  for (uint i = 0; i < spline_index; ++i) {
+    const TrackEditPiece *piece = &editor->pieces[i];
+    if (piece->vertex_count >= 2) {
+      first_rail_vertex += piece->vertex_count * kRailCrossSectionVertexCount;
+    }
+  }
+  std::size_t first_crosstie =
+      std::lower_bound(crosstie_vertices->begin(), crosstie_vertices->end(),
+                       first_vertex) -
+      crosstie_vertices->begin();
+
+  std::vector<Mesh> left_rails;
+  std::vector<Mesh> right_rails;
+  std::vector<VertexList1P1UV> crossties;
+  std::vector<std::size_t> rest_crosstie_vertices;
+  std::size_t rail_vertex_count = 0;
+  std::size_t crosstie_vertex_count = 0;
+  for (uint i = spline_index; i < editor->pieces.size(); ++i) {
+    const TrackEditPiece *piece = &editor->pieces[i];
+    // Rails and crossties span at least two vertices.
+    if (piece->vertex_count < 2) {
+      continue;
+    }
+
+    std::size_t end = piece->vertex_begin + piece->vertex_count;
+    std::size_t rail_begin = piece->vertex_begin;
+    std::size_t crosstie_begin = piece->vertex_begin;
+    if (i == spline_index) {
+      rail_begin = first_vertex;
+      first_rail_vertex +=
+          (first_vertex - piece->vertex_begin) * kRailCrossSectionVertexCount;
+      if (first_crosstie > 0 &&
+          (*crosstie_vertices)[first_crosstie - 1] >= piece->vertex_begin) {
+        crosstie_begin = (*crosstie_vertices)[first_crosstie - 1];
+      }
+    }
+
+    VertexList1P1T1N1B slice = SliceCameraPath(camspl, rail_begin, end);
+    left_rails.emplace_back();
+    right_rails.emplace_back();
+    {
+      ProfileScope scope(kProfilePhase_Rails);
+      MakeRails(&slice, &cfg->rails_color, cfg->rails_head_w,
+                cfg->rails_head_h, cfg->rails_web_w, cfg->rails_web_h,
+                cfg->rails_gauge, cfg->rails_pos_offset_in_camspl_norm_dir,
+                arena, &left_rails.back(), &right_rails.back());
+    }
+    rail_vertex_count += left_rails.back().vl1p1c.count;
+
+    ProfileScope scope(kProfilePhase_Crossties);
+    slice = SliceCameraPath(camspl, crosstie_begin, end);
+    crossties.emplace_back();
+    MakeCrossties(&slice, cfg->crossties_separation_dist,
+                  cfg->crossties_pos_offset_in_camspl_norm_dir, arena, arena,
+                  &crossties.back());
+    crosstie_vertex_count += crossties.back().count;
+    FindCrosstieVertices(camspl, crosstie_begin, end,
+                         cfg->crossties_separation_dist,
+                         &rest_crosstie_vertices);
+  }
+
+  if (first_crosstie + rest_crosstie_vertices.size() !=
+      crosstie_vertices->size()) {
+    RemakeTrackModels(editor, patch);
+    return;
+  }
+  std::copy(rest_crosstie_vertices.begin(), rest_crosstie_vertices.end(),
+            crosstie_vertices->begin() + first_crosstie);
+
+  glm::vec3 *left_rail_positions =
+      ArenaAllocArray<glm::vec3>(arena, rail_vertex_count);
+  glm::vec3 *right_rail_positions =
+      ArenaAllocArray<glm::vec3>(arena, rail_vertex_count);
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < left_rails.size(); ++i) {
+    std::size_t count = left_rails[i].vl1p1c.count;
+    std::copy_n(left_rails[i].vl1p1c.positions, count,
+                left_rail_positions + offset);
+    std::copy_n(right_rails[i].vl1p1c.positions, count,
+                right_rail_positions + offset);
+    offset += count;
+  }
+
+  glm::vec3 *crosstie_positions =
+      ArenaAllocArray<glm::vec3>(arena, crosstie_vertex_count);
+  offset = 0;
+  for (const VertexList1P1UV &c : crossties) {
+    std::copy_n(c.positions, c.count, crosstie_positions + offset);
+    offset += c.count;
+  }
+
+  *patch = {};
+  patch->first_rail_vertex = first_rail_vertex;
+  patch->rail_vertex_count = rail_vertex_count;
+  patch->left_rail_positions = left_rail_positions;
+  patch->right_rail_positions = right_rail_positions;
+  patch->first_crosstie_vertex = first_crosstie * kCrosstieVertexCount;
+  patch->crosstie_vertex_count = crosstie_vertex_count;
+  patch->crosstie_positions = crosstie_positions;
+}
+
+Status EditTrackSpline(TrackEditor *editor, uint spline_index,
+                       const glm::vec3 *ctrl_points, uint ctrl_point_count,
+                       int *is_changed, TrackPatch *patch) {
+  assert(editor);
+  assert(spline_index < editor->pieces.size());
+  assert(ctrl_points || ctrl_point_count == 0);
+  assert(is_changed);
+  assert(patch);
+
+  *is_changed = 0;
+
+  TrackEditPiece *piece = &editor->pieces[spline_index];
+  const glm::vec3 *old_ctrl_points = piece->ctrl_points.data();
+  uint old_ctrl_point_count = piece->ctrl_points.size();
+
+  // Control points `[first_changed, count - unchanged_suffix_count)` changed.
+  uint min_count = std::min(old_ctrl_point_count, ctrl_point_count);
+  uint first_changed = 0;
+  while (first_changed < min_count &&
+         old_ctrl_points[first_changed] == ctrl_points[first_changed]) {
+    ++first_changed;
+  }
+  if (first_changed == min_count &&
+      old_ctrl_point_count == ctrl_point_count) {
+    return kStatus_Ok;
+  }
+  uint unchanged_suffix_count = 0;
+  while (unchanged_suffix_count < min_count - first_changed &&
+         old_ctrl_points[old_ctrl_point_count - 1 - unchanged_suffix_count] ==
+             ctrl_points[ctrl_point_count - 1 - unchanged_suffix_count]) {
+    ++unchanged_suffix_count;
+  }
+
+  // Segment `i` depends on control points `i` to `i + 3`, so segments
+  // `[segment_begin, end)` are evaluated again, where `end` differs between
+  // the old and new spline by the change in control point count.
+  uint old_segment_count = SegmentCount(old_ctrl_point_count);
+  uint segment_count = SegmentCount(ctrl_point_count);
+  uint segment_begin = first_changed > 3 ? first_changed - 3 : 0;
+  segment_begin = std::min({segment_begin, old_segment_count, segment_count});
+  uint old_segment_end = std::max(
+      segment_begin, std::min(old_segment_count,
+                              old_ctrl_point_count - unchanged_suffix_count));
+  uint segment_end = std::max(
+      segment_begin,
+      std::min(segment_count, ctrl_point_count - unchanged_suffix_count));
+  assert(old_segment_count - old_segment_end == segment_count - segment_end);
+
+  const std::vector<uint> *old_counts = &piece->segment_vertex_counts;
+  std::size_t first_vertex = piece->vertex_begin;
+  for (uint i = 0; i < segment_begin; ++i) {
+    first_vertex += (*old_counts)[i];
+  }
+  std::size_t old_vertex_count = 0;
+  for (uint i = segment_begin; i < old_segment_end; ++i) {
+    old_vertex_count += (*old_counts)[i];
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> tangents;
+  std::vector<uint> counts(segment_end - segment_begin);
+  {
+    ProfileScope scope(kProfilePhase_SplineEval);
+    for (uint i = segment_begin; i < segment_end; ++i) {
+      std::size_t size = positions.size();
+      AppendCatmullRomSegments(ctrl_points, i, i + 1,
+                               editor->cfg->max_spline_segment_len, &positions,
+                               &tangents);
+      counts[i - segment_begin] = positions.size() - size;
+    }
+  }
+
+  const VertexList1P1T1N1B *camspl = &editor->scene->camspl.mesh->vl1p1t1n1b;
+  if (camspl->count - old_vertex_count + positions.size() == 0) {
+    std::fprintf(stderr,
+                 "Failed to edit spline %s, without which the track would "
+                 "have no segments.\n",
+                 piece->spline_filepath.c_str());
+    return kStatus_UnspecifiedError;
+  }
+
+  SpliceCameraPath(editor, first_vertex, old_vertex_count, &positions,
+                   &tangents);
+  int is_resized = positions.size() != old_vertex_count;
+
+  piece->ctrl_points.assign(ctrl_points, ctrl_points + ctrl_point_count);
+  piece->segment_vertex_counts.erase(
+      piece->segment_vertex_counts.begin() + segment_begin,
+      piece->segment_vertex_counts.begin() + old_segment_end);
+  piece->segment_vertex_counts.insert(
+      piece->segment_vertex_counts.begin() + segment_begin, counts.begin(),
+      counts.end());
+  piece->vertex_count = piece->vertex_count - old_vertex_count +
+                        positions.size();
+  for (uint i = spline_index + 1; i < editor->pieces.size(); ++i) {
+    editor->pieces[i].vertex_begin =
+        editor->pieces[i - 1].vertex_begin + editor->pieces[i - 1].vertex_count;
+  }
+
+  // No vertices of the camera path changed.
+  if (!is_resized && positions.empty()) {
+    return kStatus_Ok;
+  }
+  *is_changed = 1;
+
+  {
+    ProfileScope scope(kProfilePhase_Frames);
+    CalcCameraOrientationFrom(camspl->tangents, camspl->count, first_vertex,
+                              camspl->normals, camspl->binormals);
+  }
+
+  ResetArena(&editor->patch_arena);
+  if (is_resized) {
+    RemakeTrackModels(editor, patch);
+  } else {
+    PatchTrackModels(editor, spline_index, first_vertex, patch);
+  }
+
+  return kStatus_Ok;
+}
+
+Status PollTrackEditor(TrackEditor *editor, int *is_changed,
+                       TrackPatch *patch) {
+  assert(editor);
+  assert(is_changed);
+  assert(patch);
+
+  *is_changed = 0;
+
+  for (uint i = 0; i < editor->pieces.size(); ++i) {
+    TrackEditPiece *piece = &editor->pieces[i];
+
+    // A spline file that is being replaced may briefly not exist.
+    struct stat st;
+    if (stat(piece->spline_filepath.c_str(), &st) != 0 ||
+        MtimeNsec(&st) == piece->mtime_nsec) {
+      continue;
+    }
+    piece->mtime_nsec = MtimeNsec(&st);
+
+    Spline spline;
+    Status status =
+        LoadSpline(editor->cfg, piece->spline_filepath.c_str(), &spline);
+    if (status != kStatus_Ok) {
+      return status;
+    }
+    return EditTrackSpline(editor, i, spline.ctrl_points.data(),
+                           spline.ctrl_points.size(), is_changed, patch);
+  }
+
+  return kStatus_Ok;
+}
+
+void FreeTrackEditor(TrackEditor *editor) {
+  assert(editor);
+
+  FreeArena(&editor->patch_arena);
+  for (uint i = 0; i < 2; ++i) {
+    FreeArena(&editor->path_arenas[i]);
+  }
+  editor->pieces.clear();
+  editor->crosstie_vertices.clear();
+}
\ No newline at end of file
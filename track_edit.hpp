@@ -0,0 +1,101 @@
+#ifndef RCOASTER_TRACK_EDIT_HPP
+#define RCOASTER_TRACK_EDIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+#include "meshes.hpp"
+#include "scene.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+// A spline of the track as it was last loaded.
+struct TrackEditPiece {
+  std::string spline_filepath;
+  // Of the spline file when it was last loaded.
+  std::int64_t mtime_nsec;
+  std::vector<glm::vec3> ctrl_points;
+  // Camera path vertices of each segment of the spline.
+  std::vector<uint> segment_vertex_counts;
+  // Camera path vertices `[vertex_begin, vertex_begin + vertex_count)`.
+  std::size_t vertex_begin;
+  std::size_t vertex_count;
+};
+
+/*
+The parts of the rails and crossties that an edit of the track changed, to be
+uploaded over the old ones.
+
+Unless the vertex counts of the rails or crossties changed, only positions
+change, from the first changed vertex to the end of the track.
+*/
+struct TrackPatch {
+  // Whether the vertex counts changed, in which case the rails and crossties
+  // of the scene have been made again whole and must be uploaded again.
+  int is_resized;
+  // Positions of the vertices of each rail from `first_rail_vertex` on.
+  std::size_t first_rail_vertex;
+  std::size_t rail_vertex_count;
+  const glm::vec3 *left_rail_positions;
+  const glm::vec3 *right_rail_positions;
+  // Positions of the vertices of the crossties from `first_crosstie_vertex`
+  // on. Their texture coordinates do not change.
+  std::size_t first_crosstie_vertex;
+  std::size_t crosstie_vertex_count;
+  const glm::vec3 *crosstie_positions;
+};
+
+/*
+Updates the track of a scene as the control points of its splines are edited,
+rather than making it again.
+
+A segment of a Catmull-Rom spline depends only on the four control points
+around it, so only the segments around the changed control points are
+evaluated again. The reference frames are propagated from the first changed
+vertex of the camera path to its end, so the rails and crossties are made again
+from there on.
+*/
+struct TrackEditor {
+  const SceneConfig *cfg;
+  Scene *scene;
+  std::vector<TrackEditPiece> pieces;
+  // Camera path vertices at which crossties are placed, in order.
+  std::vector<std::size_t> crosstie_vertices;
+  // An edit that changes the vertex count of the camera path makes it again in
+  // the arena that the current camera path is not in.
+  Arena path_arenas[2];
+  uint next_path_arena;
+  // The patch of the last edit.
+  Arena patch_arena;
+};
+
+// Loads the splines of the track of the scene, which must have been made from
+// them as they are, and must not be streamed or cached.
+Status InitTrackEditor(const SceneConfig *cfg, Scene *scene,
+                       TrackEditor *editor);
+
+/*
+Replaces the control points of a spline of the track, and updates the camera
+path, rails and crossties of the scene. The track is left unchanged if the edit
+would leave it without segments.
+
+Output Parameters:
+- is_changed: whether the track changed, in which case `patch` is set. It is
+valid until the next edit
+*/
+Status EditTrackSpline(TrackEditor *editor, uint spline_index,
+                       const glm::vec3 *ctrl_points, uint ctrl_point_count,
+                       int *is_changed, TrackPatch *patch);
+
+// Reloads the first spline file that has been modified since it was last
+// loaded, if any, and edits the track with it.
+Status PollTrackEditor(TrackEditor *editor, int *is_changed,
+                       TrackPatch *patch);
+
+void FreeTrackEditor(TrackEditor *editor);
+
+#endif  // RCOASTER_TRACK_EDIT_HPP
\ No newline at end of file
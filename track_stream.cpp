@@ -0,0 +1,605 @@
+#include "track_stream.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "profiler.hpp"
+
+#define BUFFER_OFFSET(offset) ((GLvoid *)(offset))
+
+// Camera path vertices of the largest chunk. Neighboring chunks share a
+// vertex, so that their rails meet.
+static std::size_t MaxChunkVertexCount(const TrackStream *stream) {
+  assert(stream);
+
+  return (std::size_t)stream->cfg.chunk_size + 1;
+}
+
+// Vertices of both rails of the largest chunk.
+static std::size_t RailVertexCapacity(const TrackStream *stream) {
+  return 16 * MaxChunkVertexCount(stream);
+}
+
+// Indices of both rails of the largest chunk.
+static std::size_t RailIndexCapacity(const TrackStream *stream) {
+  return 96 * (MaxChunkVertexCount(stream) - 1);
+}
+
+// Crossties of the last chunk may be placed at any of its vertices, including
+// the last vertex of the track.
+static std::size_t CrosstieVertexCapacity(const TrackStream *stream) {
+  return 36 * MaxChunkVertexCount(stream);
+}
+
+// Fits the largest chunk in one block. The crossties are laid out twice, in
+// scratch and then compacted.
+static std::size_t ChunkArenaBlockSize(const TrackStream *stream) {
+  static constexpr std::size_t kSlackSize = 4096;
+
+  return RailVertexCapacity(stream) * (sizeof(glm::vec3) + sizeof(glm::vec4)) +
+         RailIndexCapacity(stream) * sizeof(uint) +
+         2 * CrosstieVertexCapacity(stream) *
+             (sizeof(glm::vec3) + sizeof(glm::vec2)) +
+         kSlackSize;
+}
+
+// Joins the rails of the splines of a chunk in order into one pair of rails.
+static void JoinChunkRails(const std::vector<Mesh> *left_rails,
+                           const std::vector<Mesh> *right_rails, Arena *arena,
+                           Mesh *left_rail, Mesh *right_rail) {
+  assert(left_rails);
+  assert(right_rails);
+  assert(left_rails->size() == right_rails->size());
+  assert(arena);
+  assert(left_rail);
+  assert(right_rail);
+
+  *left_rail = {};
+  left_rail->vertex_list_type = kVertexListType_1P1C;
+  *right_rail = {};
+  right_rail->vertex_list_type = kVertexListType_1P1C;
+  if (left_rails->size() == 1) {
+    *left_rail = (*left_rails)[0];
+    *right_rail = (*right_rails)[0];
+    return;
+  }
+
+  const std::vector<Mesh> *pieces[] = {left_rails, right_rails};
+  Mesh *rails[] = {left_rail, right_rail};
+  for (uint r = 0; r < 2; ++r) {
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+    for (const Mesh &piece : *pieces[r]) {
+      vertex_count += piece.vl1p1c.count;
+      index_count += piece.index_count;
+    }
+
+    Mesh *rail = rails[r];
+    rail->vl1p1c.count = vertex_count;
+    rail->vl1p1c.positions = ArenaAllocArray<glm::vec3>(arena, vertex_count);
+    rail->vl1p1c.colors = ArenaAllocArray<glm::vec4>(arena, vertex_count);
+    rail->index_count = index_count;
+    rail->indices = ArenaAllocArray<uint>(arena, index_count);
+
+    std::size_t vertex_offset = 0;
+    std::size_t index_offset = 0;
+    for (const Mesh &piece : *pieces[r]) {
+      std::copy_n(piece.vl1p1c.positions, piece.vl1p1c.count,
+                  rail->vl1p1c.positions + vertex_offset);
+      std::copy_n(piece.vl1p1c.colors, piece.vl1p1c.count,
+                  rail->vl1p1c.colors + vertex_offset);
+      for (std::size_t i = 0; i < piece.index_count; ++i) {
+        rail->indices[index_offset + i] = piece.indices[i] + vertex_offset;
+      }
+      vertex_offset += piece.vl1p1c.count;
+      index_offset += piece.index_count;
+    }
+  }
+}
+
+// Joins the crossties of the splines of a chunk in order.
+static void JoinChunkCrossties(const std::vector<VertexList1P1UV> *pieces,
+                               Arena *arena, VertexList1P1UV *crossties) {
+  assert(pieces);
+  assert(arena);
+  assert(crossties);
+
+  *crossties = {};
+  if (pieces->size() == 1) {
+    *crossties = (*pieces)[0];
+    return;
+  }
+
+  for (const VertexList1P1UV &piece : *pieces) {
+    crossties->count += piece.count;
+  }
+  crossties->positions = ArenaAllocArray<glm::vec3>(arena, crossties->count);
+  crossties->uv = ArenaAllocArray<glm::vec2>(arena, crossties->count);
+
+  std::size_t offset = 0;
+  for (const VertexList1P1UV &piece : *pieces) {
+    std::copy_n(piece.positions, piece.count, crossties->positions + offset);
+    std::copy_n(piece.uv, piece.count, crossties->uv + offset);
+    offset += piece.count;
+  }
+}
+
+/*
+Makes the rails and crossties of a chunk along each spline that it spans, as
+`MakeTrackPieceModels` makes them along the whole spline.
+
+Neighboring chunks share a vertex, so that their rails meet, and a crosstie
+at that vertex belongs to the later chunk. The crosstie walk of a chunk starts
+from its crosstie origin, which is not a crosstie of the chunk, so that its
+crossties are those of the unstreamed track at or after its first vertex.
+
+Called on a worker thread.
+*/
+static void MakeChunk(void *arg) {
+  assert(arg);
+
+  TrackChunk *chunk = (TrackChunk *)arg;
+  TrackStream *stream = chunk->stream;
+  const SceneConfig *scene_cfg = stream->cfg.scene_cfg;
+  const VertexList1P1T1N1B *camspl = stream->cfg.camspl;
+  const std::vector<std::size_t> *piece_begins = &stream->piece_begins;
+
+  std::size_t begin = (std::size_t)chunk->index * stream->cfg.chunk_size;
+  std::size_t end =
+      std::min(begin + MaxChunkVertexCount(stream), camspl->count);
+  std::size_t crosstie_end =
+      chunk->index + 1 < stream->chunk_count ? end - 1 : end;
+  std::size_t crosstie_origin = stream->crosstie_origins[chunk->index];
+
+  std::vector<Mesh> left_rails;
+  std::vector<Mesh> right_rails;
+  std::vector<VertexList1P1UV> crossties;
+  // The last spline that starts at or before the first vertex of the chunk.
+  std::size_t piece =
+      std::upper_bound(piece_begins->begin(), piece_begins->end(), begin) -
+      piece_begins->begin() - 1;
+  for (; piece + 1 < piece_begins->size() && (*piece_begins)[piece] < end;
+       ++piece) {
+    std::size_t piece_begin = (*piece_begins)[piece];
+    std::size_t piece_end = (*piece_begins)[piece + 1];
+    // Rails and crossties span at least two vertices.
+    if (piece_end - piece_begin < 2) {
+      continue;
+    }
+
+    std::size_t rail_begin = std::max(begin, piece_begin);
+    std::size_t rail_end = std::min(end, piece_end);
+    if (rail_end - rail_begin >= 2) {
+      ProfileScope scope(kProfilePhase_Rails);
+      VertexList1P1T1N1B slice = SliceCameraPath(camspl, rail_begin, rail_end);
+      left_rails.emplace_back();
+      right_rails.emplace_back();
+      MakeRails(&slice, &scene_cfg->rails_color, scene_cfg->rails_head_w,
+                scene_cfg->rails_head_h, scene_cfg->rails_web_w,
+                scene_cfg->rails_web_h, scene_cfg->rails_gauge,
+                scene_cfg->rails_pos_offset_in_camspl_norm_dir, &chunk->arena,
+                &left_rails.back(), &right_rails.back());
+    }
+
+    std::size_t walk_begin = std::max(crosstie_origin, piece_begin);
+    std::size_t walk_end = std::min(crosstie_end, piece_end);
+    if (walk_end > walk_begin + 1) {
+      ProfileScope scope(kProfilePhase_Crossties);
+      VertexList1P1T1N1B slice = SliceCameraPath(camspl, walk_begin, walk_end);
+      crossties.emplace_back();
+      MakeCrossties(&slice, scene_cfg->crossties_separation_dist,
+                    scene_cfg->crossties_pos_offset_in_camspl_norm_dir,
+                    &chunk->arena, &chunk->arena, &crossties.back());
+    }
+  }
+
+  JoinChunkRails(&left_rails, &right_rails, &chunk->arena, &chunk->left_rail,
+                 &chunk->right_rail);
+  // The rails share their vertex and index buffers, left rail first.
+  for (std::size_t i = 0; i < chunk->right_rail.index_count; ++i) {
+    chunk->right_rail.indices[i] += chunk->left_rail.vl1p1c.count;
+  }
+  JoinChunkCrossties(&crossties, &chunk->arena, &chunk->crossties);
+
+  {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->made_chunks.push_back(chunk);
+  }
+  stream->chunk_made.notify_all();
+}
+
+static void FreeChunk(TrackChunk *chunk) {
+  assert(chunk);
+
+  FreeArena(&chunk->arena);
+  delete chunk;
+}
+
+static void UploadChunk(const TrackStream *stream, const TrackChunk *chunk,
+                        TrackStreamSlot *slot) {
+  assert(stream);
+  assert(chunk);
+  assert(slot);
+
+  const VertexList1P1C *left = &chunk->left_rail.vl1p1c;
+  const VertexList1P1C *right = &chunk->right_rail.vl1p1c;
+  assert(left->count + right->count <= RailVertexCapacity(stream));
+  assert(chunk->crossties.count <= CrosstieVertexCapacity(stream));
+
+  // Positions start at the beginning of the buffer and colors at the
+  // capacity, as the VAO of the slot expects.
+  GLintptr colors_offset = RailVertexCapacity(stream) * sizeof(glm::vec3);
+  glBindBuffer(GL_ARRAY_BUFFER, slot->rail_vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, left->count * sizeof(glm::vec3),
+                  left->positions);
+  glBufferSubData(GL_ARRAY_BUFFER, left->count * sizeof(glm::vec3),
+                  right->count * sizeof(glm::vec3), right->positions);
+  glBufferSubData(GL_ARRAY_BUFFER, colors_offset,
+                  left->count * sizeof(glm::vec4), left->colors);
+  glBufferSubData(GL_ARRAY_BUFFER,
+                  colors_offset + left->count * sizeof(glm::vec4),
+                  right->count * sizeof(glm::vec4), right->colors);
+
+  GLintptr uv_offset = CrosstieVertexCapacity(stream) * sizeof(glm::vec3);
+  glBindBuffer(GL_ARRAY_BUFFER, slot->crosstie_vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0,
+                  chunk->crossties.count * sizeof(glm::vec3),
+                  chunk->crossties.positions);
+  glBufferSubData(GL_ARRAY_BUFFER, uv_offset,
+                  chunk->crossties.count * sizeof(glm::vec2),
+                  chunk->crossties.uv);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  GLsizeiptr left_size = chunk->left_rail.index_count * sizeof(uint);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, slot->rail_index_buffer);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, left_size,
+                  chunk->left_rail.indices);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, left_size,
+                  chunk->right_rail.index_count * sizeof(uint),
+                  chunk->right_rail.indices);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  slot->chunk_index = chunk->index;
+  slot->rail_index_count =
+      chunk->left_rail.index_count + chunk->right_rail.index_count;
+  slot->crosstie_vertex_count = chunk->crossties.count;
+}
+
+static void MakeSlot(const TrackStream *stream, TrackStreamSlot *slot) {
+  assert(stream);
+  assert(slot);
+
+  const TrackStreamConfig *cfg = &stream->cfg;
+
+  glGenVertexArrays(1, &slot->rail_vao);
+  glGenVertexArrays(1, &slot->crosstie_vao);
+  glGenBuffers(1, &slot->rail_vertex_buffer);
+  glGenBuffers(1, &slot->rail_index_buffer);
+  glGenBuffers(1, &slot->crosstie_vertex_buffer);
+
+  std::size_t rail_vertex_capacity = RailVertexCapacity(stream);
+  glBindVertexArray(slot->rail_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, slot->rail_vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               rail_vertex_capacity * (sizeof(glm::vec3) + sizeof(glm::vec4)),
+               NULL, GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(cfg->rail_position_loc, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), BUFFER_OFFSET(0));
+  glVertexAttribPointer(
+      cfg->rail_color_loc, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+      BUFFER_OFFSET(rail_vertex_capacity * sizeof(glm::vec3)));
+  glEnableVertexAttribArray(cfg->rail_position_loc);
+  glEnableVertexAttribArray(cfg->rail_color_loc);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, slot->rail_index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               RailIndexCapacity(stream) * sizeof(uint), NULL,
+               GL_DYNAMIC_DRAW);
+
+  std::size_t crosstie_vertex_capacity = CrosstieVertexCapacity(stream);
+  glBindVertexArray(slot->crosstie_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, slot->crosstie_vertex_buffer);
+  glBufferData(
+      GL_ARRAY_BUFFER,
+      crosstie_vertex_capacity * (sizeof(glm::vec3) + sizeof(glm::vec2)),
+      NULL, GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(cfg->crosstie_position_loc, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), BUFFER_OFFSET(0));
+  glVertexAttribPointer(
+      cfg->crosstie_tex_coord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
+      BUFFER_OFFSET(crosstie_vertex_capacity * sizeof(glm::vec3)));
+  glEnableVertexAttribArray(cfg->crosstie_position_loc);
+  glEnableVertexAttribArray(cfg->crosstie_tex_coord_loc);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Uploads a chunk that has been made if it is still in the window.
+static void UseChunk(TrackStream *stream, TrackChunk *chunk) {
+  assert(stream);
+  assert(chunk);
+  assert(stream->chunk_states[chunk->index] == kTrackChunkState_Pending);
+
+  if (chunk->index < stream->first_chunk ||
+      chunk->index >= stream->end_chunk) {
+    stream->chunk_states[chunk->index] = kTrackChunkState_Absent;
+    FreeChunk(chunk);
+    return;
+  }
+
+  // A chunk of the window that is not resident has a free slot, since there
+  // are as many slots as chunks in the window.
+  assert(!stream->free_slots.empty());
+  TrackStreamSlot *slot = &stream->slots[stream->free_slots.back()];
+  stream->free_slots.pop_back();
+  if (slot->rail_vao == 0) {
+    MakeSlot(stream, slot);
+  }
+
+  UploadChunk(stream, chunk, slot);
+  stream->chunk_states[chunk->index] = kTrackChunkState_Resident;
+  FreeChunk(chunk);
+}
+
+// Whether the first `count` chunks of the window are resident.
+static int AreChunksResident(const TrackStream *stream, uint count) {
+  assert(stream);
+
+  uint end = std::min<std::uint64_t>((std::uint64_t)stream->first_chunk + count,
+                                     stream->end_chunk);
+  for (uint i = stream->first_chunk; i < end; ++i) {
+    if (stream->chunk_states[i] != kTrackChunkState_Resident) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+Moves the window and uploads the chunks that have been made.
+
+Input Parameters:
+- blocking_chunk_count: chunks from the start of the window to wait for
+*/
+static void UpdateWindow(TrackStream *stream, std::size_t camera_path_index,
+                         uint blocking_chunk_count) {
+  assert(stream);
+
+  std::int64_t start_nsec = ProfileNowNsec();
+
+  // A window of every chunk stays at the start of the track.
+  uint chunk_size = stream->cfg.chunk_size;
+  if (stream->cfg.window_size > 0) {
+    stream->first_chunk = std::min<std::size_t>(camera_path_index / chunk_size,
+                                                stream->chunk_count - 1);
+  }
+  stream->end_chunk = std::min<std::uint64_t>(
+      (std::uint64_t)stream->first_chunk + stream->slots.size(),
+      stream->chunk_count);
+
+  for (uint i = 0; i < stream->slots.size(); ++i) {
+    TrackStreamSlot *slot = &stream->slots[i];
+    if (slot->chunk_index != TRACK_STREAM_NO_CHUNK &&
+        (slot->chunk_index < stream->first_chunk ||
+         slot->chunk_index >= stream->end_chunk)) {
+      stream->chunk_states[slot->chunk_index] = kTrackChunkState_Absent;
+      slot->chunk_index = TRACK_STREAM_NO_CHUNK;
+      slot->rail_index_count = 0;
+      slot->crosstie_vertex_count = 0;
+      stream->free_slots.push_back(i);
+    }
+  }
+
+  for (uint i = stream->first_chunk; i < stream->end_chunk; ++i) {
+    if (stream->chunk_states[i] != kTrackChunkState_Absent) {
+      continue;
+    }
+    stream->chunk_states[i] = kTrackChunkState_Pending;
+
+    TrackChunk *chunk = new TrackChunk();
+    chunk->stream = stream;
+    chunk->index = i;
+    InitArena(ChunkArenaBlockSize(stream),
+              stream->cfg.scene_cfg->is_arena_huge_page_backed,
+              &chunk->arena);
+    {
+      std::lock_guard<std::mutex> lock(stream->mutex);
+      ++stream->pending_chunk_count;
+    }
+    SubmitTask(stream->cfg.pool, MakeChunk, chunk);
+  }
+
+  std::int64_t budget_nsec = stream->cfg.upload_budget_nsec;
+  for (;;) {
+    TrackChunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(stream->mutex);
+      if (!AreChunksResident(stream, blocking_chunk_count)) {
+        stream->chunk_made.wait(
+            lock, [stream] { return !stream->made_chunks.empty(); });
+      } else if (budget_nsec > 0 &&
+                 ProfileNowNsec() - start_nsec >= budget_nsec) {
+        break;
+      }
+      if (stream->made_chunks.empty()) {
+        break;
+      }
+      chunk = stream->made_chunks.front();
+      stream->made_chunks.pop_front();
+      --stream->pending_chunk_count;
+    }
+    UseChunk(stream, chunk);
+  }
+}
+
+/*
+Finds the crosstie origin of each chunk: the last crosstie before its first
+vertex along its spline, or else the first vertex of the spline, from which
+`MakeCrossties` walks the spline.
+*/
+static void FindCrosstieOrigins(TrackStream *stream) {
+  assert(stream);
+
+  ProfileScope scope(kProfilePhase_Crossties);
+
+  const VertexList1P1T1N1B *camspl = stream->cfg.camspl;
+  float separation_dist = stream->cfg.scene_cfg->crossties_separation_dist;
+  std::size_t chunk_size = stream->cfg.chunk_size;
+  stream->crosstie_origins.resize(stream->chunk_count);
+  uint chunk = 0;
+  for (std::size_t i = 0; i + 1 < stream->piece_begins.size(); ++i) {
+    std::size_t piece_begin = stream->piece_begins[i];
+    VertexList1P1T1N1B piece =
+        SliceCameraPath(camspl, piece_begin, stream->piece_begins[i + 1]);
+    std::size_t last = 0;
+    std::size_t next = NextCrosstieVertex(&piece, 0, separation_dist);
+    for (; chunk < stream->chunk_count &&
+           chunk * chunk_size < piece_begin + piece.count;
+         ++chunk) {
+      std::size_t chunk_begin = chunk * chunk_size - piece_begin;
+      while (next < chunk_begin) {
+        last = next;
+        next = NextCrosstieVertex(&piece, next, separation_dist);
+      }
+      stream->crosstie_origins[chunk] = piece_begin + last;
+    }
+  }
+  assert(chunk == stream->chunk_count);
+}
+
+Status InitTrackStream(const TrackStreamConfig *cfg, TrackStream *stream) {
+  assert(cfg);
+  assert(cfg->chunk_size > 0);
+  assert(16 * ((std::size_t)cfg->chunk_size + 1) <= MAX_INDEXED_VERTEX_COUNT);
+  assert(cfg->initial_chunk_count > 0);
+  assert(cfg->scene_cfg);
+  assert(cfg->camspl);
+  assert(cfg->piece_vertex_counts);
+  assert(cfg->pool);
+  assert(stream);
+
+  if (cfg->camspl->count < 2) {
+    std::fprintf(stderr, "Failed to stream track of %zu vertices.\n",
+                 cfg->camspl->count);
+    return kStatus_UnspecifiedError;
+  }
+
+  stream->cfg = *cfg;
+  stream->chunk_count = (cfg->camspl->count - 2) / cfg->chunk_size + 1;
+  stream->first_chunk = 0;
+  stream->end_chunk = 0;
+  stream->chunk_states.assign(stream->chunk_count, kTrackChunkState_Absent);
+  stream->piece_begins.assign(1, 0);
+  for (uint i = 0; i < cfg->piece_count; ++i) {
+    stream->piece_begins.push_back(stream->piece_begins.back() +
+                                   cfg->piece_vertex_counts[i]);
+  }
+  assert(stream->piece_begins.back() == cfg->camspl->count);
+  FindCrosstieOrigins(stream);
+  stream->made_chunks.clear();
+  stream->pending_chunk_count = 0;
+
+  uint slot_count = stream->chunk_count;
+  if (cfg->window_size > 0 && cfg->window_size < slot_count) {
+    slot_count = cfg->window_size;
+  }
+  // The buffers of a slot are made once it is first used, so that a window
+  // of every chunk does not delay the first chunk.
+  TrackStreamSlot free_slot = {};
+  free_slot.chunk_index = TRACK_STREAM_NO_CHUNK;
+  stream->slots.assign(slot_count, free_slot);
+  stream->free_slots.clear();
+  for (uint i = slot_count; i > 0; --i) {
+    stream->free_slots.push_back(i - 1);
+  }
+
+  UpdateWindow(stream, 0, cfg->initial_chunk_count);
+
+  return kStatus_Ok;
+}
+
+void UpdateTrackStream(TrackStream *stream, std::size_t camera_path_index,
+                       int is_blocking) {
+  assert(stream);
+
+  UpdateWindow(stream, camera_path_index,
+               is_blocking ? stream->slots.size() : 0);
+}
+
+int IsTrackStreamWindowResident(const TrackStream *stream) {
+  assert(stream);
+
+  return AreChunksResident(stream, stream->slots.size());
+}
+
+void DrawTrackStreamRails(const TrackStream *stream) {
+  assert(stream);
+
+  for (const TrackStreamSlot &slot : stream->slots) {
+    if (slot.chunk_index == TRACK_STREAM_NO_CHUNK) {
+      continue;
+    }
+    glBindVertexArray(slot.rail_vao);
+    glDrawElements(GL_TRIANGLES, slot.rail_index_count, GL_UNSIGNED_INT,
+                   BUFFER_OFFSET(0));
+  }
+  glBindVertexArray(0);
+}
+
+void DrawTrackStreamCrossties(const TrackStream *stream) {
+  assert(stream);
+
+  for (const TrackStreamSlot &slot : stream->slots) {
+    if (slot.chunk_index == TRACK_STREAM_NO_CHUNK) {
+      continue;
+    }
+    glBindVertexArray(slot.crosstie_vao);
+    glDrawArrays(GL_TRIANGLES, 0, slot.crosstie_vertex_count);
+  }
+  glBindVertexArray(0);
+}
+
+std::uint64_t TrackStreamTriangleCount(const TrackStream *stream) {
+  assert(stream);
+
+  std::uint64_t count = 0;
+  for (const TrackStreamSlot &slot : stream->slots) {
+    count += slot.rail_index_count / 3 + slot.crosstie_vertex_count / 3;
+  }
+  return count;
+}
+
+void FreeTrackStream(TrackStream *stream) {
+  assert(stream);
+
+  {
+    // Chunks being made still refer to the stream.
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->chunk_made.wait(lock, [stream] {
+      return stream->made_chunks.size() == stream->pending_chunk_count;
+    });
+    for (TrackChunk *chunk : stream->made_chunks) {
+      FreeChunk(chunk);
+    }
+    stream->made_chunks.clear();
+    stream->pending_chunk_count = 0;
+  }
+
+  for (TrackStreamSlot &slot : stream->slots) {
+    glDeleteVertexArrays(1, &slot.rail_vao);
+    glDeleteVertexArrays(1, &slot.crosstie_vao);
+    glDeleteBuffers(1, &slot.rail_vertex_buffer);
+    glDeleteBuffers(1, &slot.rail_index_buffer);
+    glDeleteBuffers(1, &slot.crosstie_vertex_buffer);
+  }
+  stream->slots.clear();
+  stream->free_slots.clear();
+  stream->chunk_states.clear();
+  stream->piece_begins.clear();
+  stream->crosstie_origins.clear();
+}
\ No newline at end of file
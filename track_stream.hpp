@@ -0,0 +1,146 @@
+#ifndef RCOASTER_TRACK_STREAM_HPP
+#define RCOASTER_TRACK_STREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "meshes.hpp"
+#include "opengl.hpp"
+#include "scene.hpp"
+#include "status.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+
+#define TRACK_STREAM_NO_CHUNK 0xFFFFFFFFu
+
+enum TrackChunkState {
+  kTrackChunkState_Absent,
+  // Being made on the thread pool.
+  kTrackChunkState_Pending,
+  kTrackChunkState_Resident,
+  kTrackChunkState__Count
+};
+
+struct TrackStream;
+
+// The rails and crossties along a range of the camera path.
+struct TrackChunk {
+  TrackStream *stream;
+  uint index;
+  // The rails and crossties, and the scratch of making them.
+  Arena arena;
+  Mesh left_rail;
+  Mesh right_rail;
+  VertexList1P1UV crossties;
+};
+
+// Buffers that hold one chunk at a time, reused for every chunk.
+struct TrackStreamSlot {
+  GLuint rail_vao;
+  GLuint crosstie_vao;
+  GLuint rail_vertex_buffer;
+  GLuint rail_index_buffer;
+  GLuint crosstie_vertex_buffer;
+  // `TRACK_STREAM_NO_CHUNK` if the slot is free.
+  uint chunk_index;
+  // Of both rails.
+  uint rail_index_count;
+  uint crosstie_vertex_count;
+};
+
+struct TrackStreamConfig {
+  // Camera path vertices per chunk. The rails of a chunk must fit 32-bit
+  // indices.
+  uint chunk_size;
+  // Chunks that are resident at once, from the chunk of the camera onwards.
+  // Zero keeps every chunk of the track resident once it has been uploaded.
+  uint window_size;
+  // Chunks from the start of the window that `InitTrackStream` waits for. The
+  // rest of the window is uploaded by later updates.
+  uint initial_chunk_count;
+  // Time that an update that does not block spends uploading chunks, of which
+  // it uploads at least one. Zero uploads every chunk that has been made.
+  std::int64_t upload_budget_nsec;
+  // The rails and crossties are made as `MakeSceneTrack` would make them,
+  // along each spline of the track on its own.
+  const SceneConfig *scene_cfg;
+  const VertexList1P1T1N1B *camspl;
+  // Camera path vertices of each spline of the track, which add up to those
+  // of the camera path.
+  const std::size_t *piece_vertex_counts;
+  uint piece_count;
+  ThreadPool *pool;
+  // Attribute locations of the programs that the chunks are drawn with.
+  GLuint rail_position_loc;
+  GLuint rail_color_loc;
+  GLuint crosstie_position_loc;
+  GLuint crosstie_tex_coord_loc;
+};
+
+/*
+Keeps the rails and crossties of only a window of chunks of the track in
+memory, so that memory use is bounded by the window rather than the length of
+the track. The camera path itself stays in memory.
+
+Chunks ahead of the camera are made on the thread pool and uploaded into a
+ring of buffer slots, one per chunk of the window. Chunks behind the camera are
+evicted, and their slots are reused.
+*/
+struct TrackStream {
+  TrackStreamConfig cfg;
+  uint chunk_count;
+  // Window of chunks `[first_chunk, end_chunk)`.
+  uint first_chunk;
+  uint end_chunk;
+  std::vector<TrackStreamSlot> slots;
+  // Indices of the slots without a chunk.
+  std::vector<uint> free_slots;
+  // A `TrackChunkState` per chunk.
+  std::vector<uchar> chunk_states;
+  // First camera path vertex of each spline, and the vertex count of the
+  // camera path.
+  std::vector<std::size_t> piece_begins;
+  // The camera path vertex that the crosstie walk of each chunk starts from,
+  // so that crossties are spaced across chunks as if they were not streamed.
+  std::vector<std::size_t> crosstie_origins;
+
+  std::mutex mutex;
+  std::condition_variable chunk_made;
+  std::deque<TrackChunk *> made_chunks;
+  uint pending_chunk_count;
+};
+
+// Makes the buffer slots, and makes and uploads the initial chunks of the first
+// window before returning.
+Status InitTrackStream(const TrackStreamConfig *cfg, TrackStream *stream);
+
+/*
+Moves the window to the chunk of the camera. Chunks that have left the window
+are evicted, chunks that have entered it start being made, and chunks that have
+been made are uploaded within the upload budget.
+
+Input Parameters:
+- is_blocking: waits until every chunk of the window has been uploaded
+*/
+void UpdateTrackStream(TrackStream *stream, std::size_t camera_path_index,
+                       int is_blocking);
+
+// Whether every chunk of the window is resident.
+int IsTrackStreamWindowResident(const TrackStream *stream);
+
+// Draws the rails of the resident chunks with the bound program.
+void DrawTrackStreamRails(const TrackStream *stream);
+
+// Draws the crossties of the resident chunks with the bound program.
+void DrawTrackStreamCrossties(const TrackStream *stream);
+
+std::uint64_t TrackStreamTriangleCount(const TrackStream *stream);
+
+// Waits for the chunks being made, then frees the chunks and slots.
+void FreeTrackStream(TrackStream *stream);
+
+#endif  // RCOASTER_TRACK_STREAM_HPP
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "video.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static constexpr uint kChannelCount = 4;
+
+// Full range BT.601 coefficients in 8-bit fixed point. Each row of the chroma
+// matrix sums to zero, so gray maps to 128.
+static constexpr int kLumaR = 77;
+static constexpr int kLumaG = 150;
+static constexpr int kLumaB = 29;
+static constexpr int kChromaUR = -43;
+static constexpr int kChromaUG = -85;
+static constexpr int kChromaVG = -107;
+static constexpr int kChromaVB = -21;
+
+// Chroma is calculated from the sums of 2 x 2 pixels, hence the shift by 10
+// instead of 8. The bias centers the result on 128 and rounds it.
+static constexpr int kChromaBias = (128 << 10) + (1 << 9);
+
+const char *const kVideoFormatStrings[kVideoFormat__Count] = {"y4m", "yuv"};
+
+const char *String(VideoFormat f) {
+  assert(f < kVideoFormat__Count);
+  return kVideoFormatStrings[f];
+}
+
+Status ParseVideoFormat(const char *s, VideoFormat *f) {
+  assert(s);
+  assert(f);
+
+  for (int i = 0; i < kVideoFormat__Count; ++i) {
+    if (std::strcmp(s, kVideoFormatStrings[i]) == 0) {
+      *f = (VideoFormat)i;
+      return kStatus_Ok;
+    }
+  }
+
+  std::fprintf(stderr, "Unknown video format \"%s\".\n", s);
+  return kStatus_UnspecifiedError;
+}
+
+static inline uchar Luma(const uchar *p) {
+  return (kLumaR * p[0] + kLumaG * p[1] + kLumaB * p[2] + 128) >> 8;
+}
+
+// `a`, `b` and `c` are sums of 2 x 2 pixels. The result is never negative.
+static inline uchar Chroma(int a, int b, int c, int ka, int kb) {
+  int chroma = (ka * a + kb * b + (c << 7) + kChromaBias) >> 10;
+  return std::min(chroma, 255);
+}
+
+static void ConvertRowPairScalar(const uchar *row0, const uchar *row1,
+                                 uint x_begin, uint w, uchar *y0, uchar *y1,
+                                 uchar *u, uchar *v) {
+  for (uint x = x_begin; x < w; x += 2) {
+    uint x1 = x + 1 < w ? x + 1 : x;
+    const uchar *p[4] = {row0 + x * kChannelCount, row0 + x1 * kChannelCount,
+                         row1 + x * kChannelCount, row1 + x1 * kChannelCount};
+
+    int sum[3] = {};
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        sum[j] += p[i][j];
+      }
+    }
+
+    y0[x] = Luma(p[0]);
+    if (x1 != x) {
+      y0[x1] = Luma(p[1]);
+    }
+    if (y1) {
+      y1[x] = Luma(p[2]);
+      if (x1 != x) {
+        y1[x1] = Luma(p[3]);
+      }
+    }
+
+    u[x / 2] = Chroma(sum[0], sum[1], sum[2], kChromaUR, kChromaUG);
+    v[x / 2] = Chroma(sum[1], sum[2], sum[0], kChromaVG, kChromaVB);
+  }
+}
+
+#if defined(__SSE2__)
+
+// Deinterleaves 8 RGBA pixels into 16-bit lanes.
+static inline void LoadRgb(const uchar *p, __m128i *r, __m128i *g,
+                           __m128i *b) {
+  __m128i lo = _mm_loadu_si128((const __m128i *)p);
+  __m128i hi = _mm_loadu_si128((const __m128i *)(p + 16));
+  __m128i mask = _mm_set1_epi32(0xFF);
+
+  *r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+  *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+                       _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+  *b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+                       _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+}
+
+static inline __m128i Luma(__m128i r, __m128i g, __m128i b) {
+  // The weighted sum is below 2^16, so the wrapping 16-bit products and sums
+  // are exact when treated as unsigned.
+  __m128i y = _mm_mullo_epi16(r, _mm_set1_epi16(kLumaR));
+  y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(kLumaG)));
+  y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(kLumaB)));
+  y = _mm_add_epi16(y, _mm_set1_epi16(128));
+  return _mm_srli_epi16(y, 8);
+}
+
+// Sums the 2 x 2 blocks of two rows of 8 pixels into four 32-bit lanes.
+static inline __m128i SumBlocks(__m128i row0, __m128i row1) {
+  return _mm_madd_epi16(_mm_add_epi16(row0, row1), _mm_set1_epi16(1));
+}
+
+static inline void StoreChroma(__m128i a, __m128i b, __m128i c, short ka,
+                               short kb, uchar *dst) {
+  __m128i ab =
+      _mm_unpacklo_epi16(_mm_packs_epi32(a, a), _mm_packs_epi32(b, b));
+  __m128i k = _mm_set_epi16(kb, ka, kb, ka, kb, ka, kb, ka);
+
+  __m128i chroma = _mm_madd_epi16(ab, k);
+  chroma = _mm_add_epi32(chroma, _mm_slli_epi32(c, 7));
+  chroma = _mm_add_epi32(chroma, _mm_set1_epi32(kChromaBias));
+  chroma = _mm_srai_epi32(chroma, 10);
+
+  chroma = _mm_packs_epi32(chroma, chroma);
+  chroma = _mm_packus_epi16(chroma, chroma);
+  int bits = _mm_cvtsi128_si32(chroma);
+  std::memcpy(dst, &bits, 4);
+}
+
+// Returns the first pixel not converted.
+static uint ConvertRowPairSimd(const uchar *row0, const uchar *row1, uint w,
+                               uchar *y0, uchar *y1, uchar *u, uchar *v) {
+  __m128i zero = _mm_setzero_si128();
+
+  uint x = 0;
+  for (; x + 8 <= w; x += 8) {
+    __m128i r0, g0, b0, r1, g1, b1;
+    LoadRgb(row0 + x * kChannelCount, &r0, &g0, &b0);
+    LoadRgb(row1 + x * kChannelCount, &r1, &g1, &b1);
+
+    _mm_storel_epi64((__m128i *)(y0 + x),
+                     _mm_packus_epi16(Luma(r0, g0, b0), zero));
+    if (y1) {
+      _mm_storel_epi64((__m128i *)(y1 + x),
+                       _mm_packus_epi16(Luma(r1, g1, b1), zero));
+    }
+
+    __m128i r = SumBlocks(r0, r1);
+    __m128i g = SumBlocks(g0, g1);
+    __m128i b = SumBlocks(b0, b1);
+    StoreChroma(r, g, b, kChromaUR, kChromaUG, u + x / 2);
+    StoreChroma(g, b, r, kChromaVG, kChromaVB, v + x / 2);
+  }
+  return x;
+}
+
+#elif defined(__ARM_NEON)
+
+static inline uint8x8_t Luma(uint8x8x4_t p) {
+  uint16x8_t y = vmull_u8(p.val[0], vdup_n_u8(kLumaR));
+  y = vmlal_u8(y, p.val[1], vdup_n_u8(kLumaG));
+  y = vmlal_u8(y, p.val[2], vdup_n_u8(kLumaB));
+  return vrshrn_n_u16(y, 8);
+}
+
+// Sums the 2 x 2 blocks of two rows of 8 pixels into four 32-bit lanes.
+static inline int32x4_t SumBlocks(uint8x8_t row0, uint8x8_t row1) {
+  return vreinterpretq_s32_u32(vpaddlq_u16(vaddl_u8(row0, row1)));
+}
+
+static inline void StoreChroma(int32x4_t a, int32x4_t b, int32x4_t c, int ka,
+                               int kb, uchar *dst) {
+  int32x4_t chroma = vmulq_n_s32(a, ka);
+  chroma = vmlaq_n_s32(chroma, b, kb);
+  chroma = vaddq_s32(chroma, vshlq_n_s32(c, 7));
+  chroma = vaddq_s32(chroma, vdupq_n_s32(kChromaBias));
+  chroma = vshrq_n_s32(chroma, 10);
+
+  uint16x4_t narrowed = vqmovun_s32(chroma);
+  uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrowed, narrowed));
+  uint32_t bits = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+  std::memcpy(dst, &bits, 4);
+}
+
+// Returns the first pixel not converted.
+static uint ConvertRowPairSimd(const uchar *row0, const uchar *row1, uint w,
+                               uchar *y0, uchar *y1, uchar *u, uchar *v) {
+  uint x = 0;
+  for (; x + 8 <= w; x += 8) {
+    uint8x8x4_t p0 = vld4_u8(row0 + x * kChannelCount);
+    uint8x8x4_t p1 = vld4_u8(row1 + x * kChannelCount);
+
+    vst1_u8(y0 + x, Luma(p0));
+    if (y1) {
+      vst1_u8(y1 + x, Luma(p1));
+    }
+
+    int32x4_t r = SumBlocks(p0.val[0], p1.val[0]);
+    int32x4_t g = SumBlocks(p0.val[1], p1.val[1]);
+    int32x4_t b = SumBlocks(p0.val[2], p1.val[2]);
+    StoreChroma(r, g, b, kChromaUR, kChromaUG, u + x / 2);
+    StoreChroma(g, b, r, kChromaVG, kChromaVB, v + x / 2);
+  }
+  return x;
+}
+
+#else
+
+static uint ConvertRowPairSimd(const uchar *, const uchar *, uint, uchar *,
+                               uchar *, uchar *, uchar *) {
+  return 0;
+}
+
+#endif
+
+void ConvertRgbaToI420(const uchar *rgba, std::ptrdiff_t stride, uint w,
+                       uint h, uchar *y, uchar *u, uchar *v) {
+  assert(rgba);
+  assert(y);
+  assert(u);
+  assert(v);
+
+  std::size_t chroma_w = (w + 1) / 2;
+
+  for (uint row = 0; row < h; row += 2) {
+    int has_row1 = row + 1 < h;
+
+    const uchar *row0 = rgba + (std::ptrdiff_t)row * stride;
+    const uchar *row1 = has_row1 ? row0 + stride : row0;
+    uchar *y0 = y + (std::size_t)row * w;
+    uchar *y1 = has_row1 ? y0 + w : NULL;
+    uchar *u_row = u + row / 2 * chroma_w;
+    uchar *v_row = v + row / 2 * chroma_w;
+
+    uint x = ConvertRowPairSimd(row0, row1, w, y0, y1, u_row, v_row);
+    ConvertRowPairScalar(row0, row1, x, w, y0, y1, u_row, v_row);
+  }
+}
+
+Status OpenVideoWriter(const char *filepath, VideoFormat format, float fps,
+                       VideoWriter *writer) {
+  assert(filepath);
+  assert(format < kVideoFormat__Count);
+  assert(fps > 0);
+  assert(writer);
+
+  *writer = {};
+  writer->format = format;
+  writer->fps = fps;
+
+  if (std::strcmp(filepath, "-") == 0) {
+    // Keeps the stream clean of everything else printed to `stdout`.
+    std::fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+      std::fprintf(stderr, "Failed to redirect stdout.\n");
+      return kStatus_IoError;
+    }
+    writer->file = fdopen(fd, "wb");
+  } else {
+    writer->file = std::fopen(filepath, "wb");
+  }
+
+  if (!writer->file) {
+    std::fprintf(stderr, "Failed to open file %s.\n", filepath);
+    return kStatus_IoError;
+  }
+
+  return kStatus_Ok;
+}
+
+Status WriteVideoFrame(const CapturedFrame *frame, VideoWriter *writer) {
+  assert(frame);
+  assert(writer);
+  assert(writer->file);
+
+  if (writer->frame_count == 0) {
+    writer->w = frame->w;
+    writer->h = frame->h;
+
+    if (writer->format == kVideoFormat_Y4m) {
+      long fps_milli = std::lround(writer->fps * 1000);
+      int rc = std::fprintf(writer->file,
+                            "YUV4MPEG2 W%u H%u F%ld:1000 Ip A1:1 C420jpeg "
+                            "XCOLORRANGE=FULL\n",
+                            writer->w, writer->h, fps_milli);
+      if (rc < 0) {
+        std::fprintf(stderr, "Failed to write video stream header.\n");
+        return kStatus_IoError;
+      }
+    }
+  } else if (frame->w != writer->w || frame->h != writer->h) {
+    std::fprintf(stderr, "Video frame size changed from %u x %u to %u x %u.\n",
+                 writer->w, writer->h, frame->w, frame->h);
+    return kStatus_UnspecifiedError;
+  }
+
+  std::size_t luma_size = (std::size_t)frame->w * frame->h;
+  std::size_t chroma_size =
+      (std::size_t)((frame->w + 1) / 2) * ((frame->h + 1) / 2);
+  std::size_t size = luma_size + 2 * chroma_size;
+
+  if (writer->yuv_capacity < size) {
+    delete[] writer->yuv;
+    writer->yuv = new uchar[size];
+    writer->yuv_capacity = size;
+  }
+
+  uchar *y = writer->yuv;
+  uchar *u = y + luma_size;
+  uchar *v = u + chroma_size;
+  ConvertRgbaToI420(CapturedFrameTopRow(frame), CapturedFrameStride(frame),
+                    frame->w, frame->h, y, u, v);
+
+  if (writer->format == kVideoFormat_Y4m &&
+      std::fputs("FRAME\n", writer->file) < 0) {
+    std::fprintf(stderr, "Failed to write video frame header.\n");
+    return kStatus_IoError;
+  }
+
+  if (std::fwrite(writer->yuv, 1, size, writer->file) != size) {
+    std::fprintf(stderr, "Failed to write video frame.\n");
+    return kStatus_IoError;
+  }
+
+  ++writer->frame_count;
+
+  return kStatus_Ok;
+}
+
+Status CloseVideoWriter(VideoWriter *writer) {
+  assert(writer);
+
+  Status status = kStatus_Ok;
+  if (writer->file && std::fclose(writer->file) != 0) {
+    std::fprintf(stderr, "Failed to close video stream.\n");
+    status = kStatus_IoError;
+  }
+
+  delete[] writer->yuv;
+  *writer = {};
+
+  return status;
+}
\ No newline at end of file
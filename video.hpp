@@ -0,0 +1,73 @@
+#ifndef RCOASTER_VIDEO_HPP
+#define RCOASTER_VIDEO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "capture.hpp"
+#include "status.hpp"
+#include "types.hpp"
+
+enum VideoFormat {
+  // YUV4MPEG2 stream of full range I420 frames.
+  kVideoFormat_Y4m,
+  // Headerless I420 frames.
+  kVideoFormat_Yuv,
+  kVideoFormat__Count
+};
+
+const char *String(VideoFormat f);
+
+Status ParseVideoFormat(const char *s, VideoFormat *f);
+
+struct VideoWriter {
+  std::FILE *file;
+  VideoFormat format;
+  float fps;
+
+  // Set by the first frame. All frames must have the same size.
+  uint w;
+  uint h;
+
+  uchar *yuv;
+  std::size_t yuv_capacity;
+  std::uint64_t frame_count;
+};
+
+/*
+Opens a video stream.
+
+Input Parameters:
+- filepath: path of a file or named pipe, or "-" for `stdout`. When the stream
+is written to `stdout`, everything else written to `stdout` goes to `stderr`
+instead
+- fps: frame rate recorded in the stream header
+*/
+Status OpenVideoWriter(const char *filepath, VideoFormat format, float fps,
+                       VideoWriter *writer);
+
+// Converts the frame to I420 and appends it to the stream. Frames must be
+// written in order, so call from a single thread.
+Status WriteVideoFrame(const CapturedFrame *frame, VideoWriter *writer);
+
+Status CloseVideoWriter(VideoWriter *writer);
+
+/*
+Converts RGBA pixels to I420 with the full range BT.601 matrix. Chroma is the
+average of each 2 x 2 block. Odd widths and heights replicate the last column
+and row.
+
+Input Parameters:
+- rgba: first pixel of the top row
+- stride: signed distance in bytes from a row to the row below it. A negative
+stride flips the image vertically at no cost
+
+Output Parameters:
+- y: `w` x `h` luma plane
+- u, v: `(w + 1) / 2` x `(h + 1) / 2` chroma planes
+*/
+void ConvertRgbaToI420(const uchar *rgba, std::ptrdiff_t stride, uint w,
+                       uint h, uchar *y, uchar *u, uchar *v);
+
+#endif  // RCOASTER_VIDEO_HPP
\ No newline at end of file